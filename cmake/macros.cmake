@@ -214,6 +214,19 @@ MACRO (enable_metal)
   SET (ENABLE_METAL 1)
   SET (METAL_SOURCE_DIR ${CMAKE_SOURCE_DIR}/metal)
   INCLUDE_DIRECTORIES (${METAL_SOURCE_DIR}/include)
+  IF ( METAL_LOCK_STATS )
+    # Instrument metal locks w/ contention and hold time statistics
+    ADD_DEFINITIONS (-DMETAL_LOCK_STATS)
+  ENDIF ()
+ENDMACRO ()
+
+#-----------------------------------------------------------------------------
+# Build and use SiFive HCA crypto driver
+#-----------------------------------------------------------------------------
+MACRO (enable_hca)
+  SET (ENABLE_HCA 1)
+  SET (HCA_SOURCE_DIR ${CMAKE_SOURCE_DIR}/hca)
+  INCLUDE_DIRECTORIES (${HCA_SOURCE_DIR}/include)
 ENDMACRO ()
 
 #-----------------------------------------------------------------------------
@@ -253,6 +266,9 @@ ENDMACRO ()
 MACRO (link_application app ldscript)
   # libraries
   LIST (INSERT PROJECT_LINK_LIBRARIES 0 c clang_rt.builtins-riscv${XLEN})
+  IF ( ENABLE_HCA )
+    LIST (APPEND PROJECT_LINK_LIBRARIES hca)
+  ENDIF ()
   IF ( ENABLE_METAL )
     LIST (APPEND PROJECT_LINK_LIBRARIES metal metal-gloss)
   ENDIF ()
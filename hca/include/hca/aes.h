@@ -0,0 +1,239 @@
+/**
+ * @file aes.h
+ * @brief HCA crypto engine driver: AES ciphering
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_AES_H
+#define HCA_AES_H
+
+#include "hca/hca.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define HCA_AES_BLOCK_SIZE       16u   // bytes
+#define HCA_AES_GCM_IV_SIZE      12u   // bytes
+#define HCA_AES_GCM_TAG_SIZE     16u   // bytes
+
+#define HCA_AES_MAX_KEY_SIZE     32u   // bytes
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** AES chaining modes, values match the AES_CR MODE field */
+enum hca_aes_mode {
+    HCA_AES_ECB = 0x0u,
+    HCA_AES_CBC = 0x1u,
+    HCA_AES_CTR = 0x4u,
+    HCA_AES_GCM = 0x5u,
+};
+
+/** AES processing direction, values match the AES_CR PROCESS field */
+enum hca_aes_process {
+    HCA_AES_ENCRYPT = 0x0u,
+    HCA_AES_DECRYPT = 0x1u,
+};
+
+/**
+ * AES session, i.e. an imported key.
+ *
+ * The engine keeps the key of the last session it ran, so switching
+ * between a few long-lived sessions only reloads the key registers when
+ * the session changes.
+ */
+struct hca_aes_session {
+    /** Key, as 32-bit words ready for the key registers */
+    uint32_t as_key[HCA_AES_MAX_KEY_SIZE/sizeof(uint32_t)];
+    size_t as_key_len;   /**< Key size in bytes */
+    uint32_t as_key_id;  /**< Identifier of the imported key, never 0 */
+};
+
+/** Streaming AES-GCM context */
+struct hca_aes_gcm_context {
+    /** Bytes which do not fill an AES block yet */
+    uint8_t gc_carry[HCA_AES_BLOCK_SIZE] HCA_DMA_ALIGN;
+    size_t gc_carry_len;        /**< Count of bytes in the carry */
+    size_t gc_aad_left;         /**< Count of AAD bytes still expected */
+    size_t gc_payload_left;     /**< Count of payload bytes still expected */
+    bool gc_payload;            /**< Whether the AAD phase is over */
+};
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Initialize an AES session.
+ *
+ * The key is converted once into its register layout. A session may be
+ * initialized again to import another key.
+ *
+ * @param as the session to initialize
+ * @param key the AES key, no alignment constraint
+ * @param key_len the length of the key: 16, 24 or 32 bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -ENODEV if the AES
+ *         engine is not present
+ */
+int hca_aes_init(struct hca_aes_session * as, const uint8_t * key,
+                 size_t key_len);
+
+/**
+ * Encrypt or decrypt a buffer in ECB mode.
+ *
+ * DMA is used whenever the destination buffer is DMA-aligned, otherwise
+ * blocks are pushed and popped from the CPU. Source and destination may
+ * be the same buffer.
+ *
+ * @param as the session
+ * @param proc the processing direction
+ * @param dst the output buffer
+ * @param src the input buffer
+ * @param length the length of the buffers in bytes, a multiple of the AES
+ *               block size
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is busy, -EIO on DMA error
+ */
+int hca_aes_ecb(struct hca_aes_session * as, enum hca_aes_process proc,
+                uint8_t * dst, const uint8_t * src, size_t length);
+
+/**
+ * Encrypt or decrypt a buffer in CBC mode.
+ *
+ * The IV is updated on return, so that a message may be processed as a
+ * sequence of calls. Source and destination may be the same buffer.
+ *
+ * @param as the session
+ * @param proc the processing direction
+ * @param dst the output buffer
+ * @param src the input buffer
+ * @param length the length of the buffers in bytes, a multiple of the AES
+ *               block size
+ * @param iv the 128-bit initialization vector, updated w/ the IV of the
+ *           next block
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is busy, -EIO on DMA error
+ */
+int hca_aes_cbc(struct hca_aes_session * as, enum hca_aes_process proc,
+                uint8_t * dst, const uint8_t * src, size_t length,
+                uint8_t * iv);
+
+/**
+ * Encrypt or decrypt a buffer in CTR mode.
+ *
+ * The counter block is updated on return, so that a message may be
+ * processed as a sequence of calls. Only the last call of a sequence may
+ * use a length which is not a multiple of the AES block size, as the key
+ * stream of an incomplete block is not kept. Source and destination may be
+ * the same buffer.
+ *
+ * @param as the session
+ * @param dst the output buffer
+ * @param src the input buffer
+ * @param length the length of the buffers, in bytes
+ * @param ctr the 128-bit big-endian initial counter block, updated w/ the
+ *            counter of the next block
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is busy, -EIO on DMA error
+ */
+int hca_aes_ctr(struct hca_aes_session * as, uint8_t * dst,
+                const uint8_t * src, size_t length, uint8_t * ctr);
+
+/**
+ * Encrypt or decrypt a buffer in GCM mode.
+ *
+ * The computed authentication tag is always returned; on decryption, the
+ * caller should compare it against the received tag.
+ *
+ * @param as the session
+ * @param proc the processing direction
+ * @param dst the output buffer
+ * @param tag the output authentication tag (#HCA_AES_GCM_TAG_SIZE bytes)
+ * @param iv the 96-bit initialization vector
+ * @param src the input buffer
+ * @param length the length of the input buffer, in bytes
+ * @param aad the additional authenticated data, may be NULL
+ * @param aad_len the length of the additional authenticated data, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is busy, -EIO on DMA error
+ */
+int hca_aes_gcm(struct hca_aes_session * as, enum hca_aes_process proc,
+                uint8_t * dst, uint8_t * tag, const uint8_t * iv,
+                const uint8_t * src, size_t length,
+                const uint8_t * aad, size_t aad_len);
+
+/**
+ * Start a streaming GCM operation.
+ *
+ * The engine needs the total AAD and payload lengths before any data is
+ * processed. The AES engine is reserved for the context until
+ * #hca_aes_gcm_finish is called or an error occurs.
+ *
+ * @param gc the context to initialize
+ * @param as the session
+ * @param proc the processing direction
+ * @param iv the 96-bit initialization vector
+ * @param aad_len the total length of the additional authenticated data
+ * @param length the total length of the payload
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is busy
+ */
+int hca_aes_gcm_start(struct hca_aes_gcm_context * gc,
+                      struct hca_aes_session * as, enum hca_aes_process proc,
+                      const uint8_t * iv, size_t aad_len, size_t length);
+
+/**
+ * Feed a chunk of additional authenticated data.
+ *
+ * All the AAD should be fed before the first payload chunk.
+ *
+ * @param gc the context
+ * @param aad the AAD chunk, no alignment constraint
+ * @param aad_len the length of the chunk, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter or if the total AAD
+ *         length is exceeded, -EBUSY if the engine is busy, -EIO on DMA
+ *         error
+ */
+int hca_aes_gcm_aad_update(struct hca_aes_gcm_context * gc,
+                           const uint8_t * aad, size_t aad_len);
+
+/**
+ * Encrypt or decrypt a chunk of payload.
+ *
+ * Only complete AES blocks are output, the remaining bytes are kept in the
+ * context and output on a subsequent call. The destination buffer should
+ * therefore have room for the chunk length plus an AES block minus one
+ * byte. DMA is used in place whenever the destination is DMA-aligned, or
+ * through an internal aligned buffer otherwise.
+ *
+ * @param gc the context
+ * @param dst the output buffer
+ * @param src the input chunk
+ * @param length the length of the chunk, in bytes
+ * @param out_len updated with the count of bytes written into @a dst
+ * @return 0 on success, -EINVAL on invalid parameter or if the total
+ *         payload length is exceeded, -EBUSY if the engine is busy, -EIO on
+ *         DMA error
+ */
+int hca_aes_gcm_update(struct hca_aes_gcm_context * gc, uint8_t * dst,
+                       const uint8_t * src, size_t length, size_t * out_len);
+
+/**
+ * Complete a streaming GCM operation, output the last payload bytes and the
+ * authentication tag, and release the AES engine.
+ *
+ * @param gc the context
+ * @param dst the output buffer, room for an AES block minus one byte
+ * @param out_len updated with the count of bytes written into @a dst
+ * @param tag the output authentication tag (#HCA_AES_GCM_TAG_SIZE bytes)
+ * @return 0 on success, -EINVAL on invalid parameter or if some AAD or
+ *         payload bytes are missing, -EBUSY if the engine is busy
+ */
+int hca_aes_gcm_finish(struct hca_aes_gcm_context * gc, uint8_t * dst,
+                       size_t * out_len, uint8_t * tag);
+
+#endif // HCA_AES_H
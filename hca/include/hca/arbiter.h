@@ -0,0 +1,94 @@
+/**
+ * @file arbiter.h
+ * @brief HCA crypto engine driver: multi-hart engine arbitration
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_ARBITER_H
+#define HCA_ARBITER_H
+
+#include "hca/hca.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+/** Owner value when the HCA is not owned by any hart */
+#define HCA_ARBITER_NO_OWNER  (-1)
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Initialize the HCA arbiter.
+ *
+ * Should be called once from a single hart, before any other hart requests
+ * the HCA.
+ *
+ * @return 0 on success, -EBUSY if the HCA is owned, -ENOTSUP if the
+ *         arbiter lock cannot be placed in atomic-capable memory
+ */
+int hca_arbiter_init(void);
+
+/**
+ * Release the HCA arbiter.
+ *
+ * @return 0 on success, -EBUSY if the HCA is owned or requested
+ */
+int hca_arbiter_fini(void);
+
+/**
+ * Request exclusive ownership of the HCA for the current hart.
+ *
+ * If the HCA is owned by another hart, the request is queued in arrival
+ * order and the current hart sleeps until the owner hands the HCA over,
+ * which is signalled with a software interrupt (IPI). The hart sleeps w/
+ * machine interrupts masked; the IPI is consumed by the arbiter and never
+ * reaches a handler.
+ *
+ * Requests do not nest: a hart should release the HCA before requesting it
+ * again.
+ *
+ * The driver state is shared by all harts and is only safe to use under the
+ * arbiter: the engine configuration shadow, the SHA engine owner, the
+ * loaded AES key and the pending DMA destination are not protected against
+ * concurrent use. Harts which share the HCA should only call the driver,
+ * and submit queue jobs, while they own it.
+ *
+ * @return 0 on success, -ENODEV if the arbiter is not initialized,
+ *         -EDEADLK if the current hart already owns the HCA
+ */
+int hca_arbiter_acquire(void);
+
+/**
+ * Request ownership of the HCA w/o waiting.
+ *
+ * @return 0 on success, -ENODEV if the arbiter is not initialized,
+ *         -EDEADLK if the current hart already owns the HCA, -EBUSY if the
+ *         HCA is owned or requested by another hart
+ */
+int hca_arbiter_try_acquire(void);
+
+/**
+ * Give up ownership of the HCA.
+ *
+ * Ownership is transferred to the oldest pending request, if any, whose
+ * hart is woken up. This may be called from the HCA IRQ handler of the
+ * owner hart, e.g. on the completion of its last queued job.
+ *
+ * @return 0 on success, -ENODEV if the arbiter is not initialized, -EPERM
+ *         if the current hart does not own the HCA
+ */
+int hca_arbiter_release(void);
+
+/**
+ * Report the current owner of the HCA.
+ *
+ * @return the hart identifier of the owner, or #HCA_ARBITER_NO_OWNER
+ */
+int hca_arbiter_owner(void);
+
+#endif // HCA_ARBITER_H
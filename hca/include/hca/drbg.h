@@ -0,0 +1,101 @@
+/**
+ * @file drbg.h
+ * @brief HCA crypto engine driver: AES-128 CTR_DRBG (NIST SP 800-90A)
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_DRBG_H
+#define HCA_DRBG_H
+
+#include "hca/aes.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+/** Seed length: key and counter block, no derivation function */
+#define HCA_DRBG_SEED_SIZE       32u   // bytes
+
+/** Largest request, i.e. 2^19 bits */
+#define HCA_DRBG_MAX_REQUEST     65536u  // bytes
+
+#ifndef HCA_DRBG_RESEED_INTERVAL
+/** Count of requests before the DRBG reseeds itself from the TRNG */
+#define HCA_DRBG_RESEED_INTERVAL (1ull << 20u)
+#endif // HCA_DRBG_RESEED_INTERVAL
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** CTR_DRBG internal state */
+struct hca_drbg {
+    struct hca_aes_session dr_aes;       /**< Key */
+    uint8_t dr_ctr[HCA_AES_BLOCK_SIZE];  /**< Next counter block, i.e. V+1 */
+    uint64_t dr_reseed_counter;          /**< Requests since last reseed */
+};
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Instantiate a DRBG.
+ *
+ * @param dr the DRBG to instantiate
+ * @param entropy #HCA_DRBG_SEED_SIZE bytes of entropy input, or NULL to
+ *                draw them from the TRNG entropy pool
+ * @param pers the personalization string, may be NULL
+ * @param pers_len the length of the personalization string, up to
+ *                 #HCA_DRBG_SEED_SIZE bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the AES
+ *         engine is busy, or the TRNG pool error
+ */
+int hca_drbg_init(struct hca_drbg * dr, const uint8_t * entropy,
+                  const uint8_t * pers, size_t pers_len);
+
+/**
+ * Reseed a DRBG.
+ *
+ * @param dr the DRBG
+ * @param entropy #HCA_DRBG_SEED_SIZE bytes of entropy input, or NULL to
+ *                draw them from the TRNG entropy pool
+ * @param add the additional input, may be NULL
+ * @param add_len the length of the additional input, up to
+ *                #HCA_DRBG_SEED_SIZE bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the AES
+ *         engine is busy, or the TRNG pool error
+ */
+int hca_drbg_reseed(struct hca_drbg * dr, const uint8_t * entropy,
+                    const uint8_t * add, size_t add_len);
+
+/**
+ * Generate random bytes.
+ *
+ * The output is produced as a single AES-CTR request, so it is DMA-driven
+ * whenever @a out is DMA-aligned. The DRBG reseeds itself from the TRNG
+ * entropy pool every #HCA_DRBG_RESEED_INTERVAL requests.
+ *
+ * @param dr the DRBG
+ * @param out the output buffer
+ * @param length the count of bytes to generate, up to
+ *               #HCA_DRBG_MAX_REQUEST
+ * @param add the additional input, may be NULL
+ * @param add_len the length of the additional input, up to
+ *                #HCA_DRBG_SEED_SIZE bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the AES
+ *         engine is busy, -EIO on DMA error, or the TRNG pool error
+ */
+int hca_drbg_generate(struct hca_drbg * dr, uint8_t * out, size_t length,
+                      const uint8_t * add, size_t add_len);
+
+/**
+ * Clear the internal state of a DRBG.
+ *
+ * @param dr the DRBG
+ */
+void hca_drbg_fini(struct hca_drbg * dr);
+
+#endif // HCA_DRBG_H
@@ -0,0 +1,111 @@
+/**
+ * @file etm.h
+ * @brief HCA crypto engine driver: chained AES and SHA (encrypt-then-MAC)
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_ETM_H
+#define HCA_ETM_H
+
+#include "hca/aes.h"
+#include "hca/queue.h"
+#include "hca/sha.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#ifndef HCA_ETM_SEGMENT_SIZE
+/** Default size of the segments AES and SHA jobs alternate on */
+#define HCA_ETM_SEGMENT_SIZE     1024u  // bytes
+#endif // HCA_ETM_SEGMENT_SIZE
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/**
+ * Encrypt-then-MAC context.
+ *
+ * Binds an AES session, a SHA session which hashes the ciphertext, and the
+ * job queue which runs both engines.
+ *
+ * The HCA has a single DMA channel and no path from the AES output to the
+ * SHA input: the AES and SHA jobs run one after the other, never
+ * concurrently, and the ciphertext is read back from memory to be hashed.
+ * Memory traffic is the same as w/ separate AES and SHA requests; the gain
+ * is that the CPU neither polls nor reprograms the engines in between.
+ */
+struct hca_etm {
+    struct hca_queue * em_queue;     /**< Active job queue */
+    struct hca_aes_session * em_aes; /**< Cipher key */
+    struct hca_sha_session * em_sha; /**< Ciphertext hash */
+    enum hca_aes_mode em_mode;       /**< Chaining mode, CBC or CTR */
+    size_t em_segment;               /**< Segment size, in bytes */
+};
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Initialize an encrypt-then-MAC context.
+ *
+ * The SHA session may already hold a message prefix, e.g. a HMAC inner key
+ * block, as long as the prefix fills whole DMA blocks. The caller
+ * retrieves the MAC w/ #hca_sha_final once the whole ciphertext is hashed.
+ *
+ * @param em the context to initialize
+ * @param hq an initialized job queue
+ * @param as the AES session
+ * @param mode the AES chaining mode, either HCA_AES_CBC or HCA_AES_CTR
+ * @param ss the SHA session
+ * @return 0 on success, -EINVAL on invalid parameter
+ */
+int hca_etm_init(struct hca_etm * em, struct hca_queue * hq,
+                 struct hca_aes_session * as, enum hca_aes_mode mode,
+                 struct hca_sha_session * ss);
+
+/**
+ * Encrypt a buffer and hash the resulting ciphertext.
+ *
+ * The buffer is split into segments: each AES job is followed by the SHA
+ * job which reads its output back from memory, and the HCA IRQ handler
+ * starts each job once the previous one is complete. The CPU only sleeps
+ * until the last job completes.
+ *
+ * @param em the context
+ * @param dst the ciphertext, DMA-aligned, may be the plaintext buffer
+ * @param src the plaintext, DMA-aligned
+ * @param length the length of the plaintext, a multiple of the AES block
+ *               size
+ * @param iv the CBC IV or CTR counter block, updated for the next request
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if an engine,
+ *         the DMA or the queue is in use, -EIO on DMA error, in which case
+ *         the hash is lost
+ */
+int hca_etm_encrypt(struct hca_etm * em, uint8_t * dst, const uint8_t * src,
+                    size_t length, uint8_t * iv);
+
+/**
+ * Hash a ciphertext and decrypt it.
+ *
+ * Each segment is hashed before it is decrypted, so the buffer may be
+ * decrypted in place.
+ *
+ * @param em the context
+ * @param dst the plaintext, DMA-aligned, may be the ciphertext buffer
+ * @param src the ciphertext, DMA-aligned
+ * @param length the length of the ciphertext, a multiple of the AES block
+ *               size
+ * @param iv the CBC IV or CTR counter block, updated for the next request
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if an engine,
+ *         the DMA or the queue is in use, -EIO on DMA error, in which case
+ *         the hash is lost
+ */
+int hca_etm_decrypt(struct hca_etm * em, uint8_t * dst, const uint8_t * src,
+                    size_t length, uint8_t * iv);
+
+#endif // HCA_ETM_H
@@ -0,0 +1,67 @@
+/**
+ * @file hca.h
+ * @brief HCA crypto engine driver: common definitions
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_HCA_H
+#define HCA_HCA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <metal/machine/platform.h>
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define HCA_BASE             (METAL_SIFIVE_HCA_0_BASE_ADDRESS)
+#define HCA_ASD_IRQ_CHANNEL  52u
+#define HCA_TRNG_IRQ_CHANNEL 53u
+
+#define HCA_DMA_ALIGNMENT    32u   // bytes
+#define HCA_DMA_BLOCK_SIZE   16u   // bytes
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+/**
+ * Attribute to place a buffer on a DMA boundary.
+ *
+ * A DMA boundary may be smaller than a L1 data cache line: data sharing a
+ * line w/ a DMA destination buffer should not be written to while a request
+ * is on-going, as the line is invalidated once the DMA completes.
+ */
+#define HCA_DMA_ALIGN __attribute__((aligned(HCA_DMA_ALIGNMENT)))
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Check the HCA engine is present and idle.
+ *
+ * The driver caches the engine configuration to skip redundant register
+ * writes; this should also be called whenever the HCA registers have been
+ * programmed outside of this driver.
+ *
+ * @return 0 on success, -ENODEV if the HCA is not present, -EBUSY if the
+ *         engine has an on-going operation
+ */
+int hca_init(void);
+
+/**
+ * Raise or clear the software interrupt (IPI) of a hart.
+ *
+ * The arbiter and the job queue wake up sleeping harts w/ this signal.
+ *
+ * @param hartid the hart to signal
+ * @param enable whether to raise or clear the interrupt
+ */
+void hca_ipi_signal(int hartid, bool enable);
+
+#endif // HCA_HCA_H
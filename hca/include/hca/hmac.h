@@ -0,0 +1,86 @@
+/**
+ * @file hmac.h
+ * @brief HCA crypto engine driver: HMAC w/ SHA-2
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_HMAC_H
+#define HCA_HMAC_H
+
+#include "hca/sha.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#ifndef HCA_HMAC_INLINE_SIZE
+/**
+ * Default length up to which a message is copied after the inner key block,
+ * so that the whole inner hash is sent w/ a single DMA request
+ */
+#define HCA_HMAC_INLINE_SIZE     128u  // bytes
+#endif // HCA_HMAC_INLINE_SIZE
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/**
+ * HMAC context.
+ *
+ * The key blocks are prepared once per key. The outer message, i.e. the
+ * outer key block, the inner digest and the SHA-2 padding, always spans two
+ * blocks, so only the inner digest changes from one message to the next.
+ */
+struct hca_hmac {
+    /** Inner key block, followed by short messages and their padding */
+    uint8_t hm_inner[3u*HCA_SHA512_BLOCK_SIZE + HCA_HMAC_INLINE_SIZE]
+        HCA_DMA_ALIGN;
+    /** Outer key block, inner digest and padding */
+    uint8_t hm_outer[2u*HCA_SHA512_BLOCK_SIZE] HCA_DMA_ALIGN;
+    struct hca_sha_session hm_sha;  /**< Session for both hashes */
+    size_t hm_block_size;           /**< SHA-2 block size, in bytes */
+};
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Initialize a HMAC context w/ a key.
+ *
+ * @param hm the context to initialize
+ * @param mode the SHA-2 flavour
+ * @param key the key, no alignment constraint, hashed first if it is
+ *            longer than a SHA-2 block
+ * @param key_len the length of the key, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -ENODEV if the SHA
+ *         engine is not present, -EBUSY if the engine is used, -EIO on DMA
+ *         error
+ */
+int hca_hmac_init(struct hca_hmac * hm, enum hca_sha_mode mode,
+                  const uint8_t * key, size_t key_len);
+
+/**
+ * Compute the MAC of a message.
+ *
+ * Messages up to #HCA_HMAC_INLINE_SIZE bytes are copied after the inner key
+ * block and padded, so that the inner hash is sent w/ a single DMA request;
+ * longer messages are streamed from the caller buffer. The outer hash is
+ * always sent w/ a single DMA request.
+ *
+ * @param hm the context
+ * @param mac the output MAC buffer, no alignment constraint
+ * @param mac_len the size of the MAC buffer, in bytes, at least the digest
+ *                size
+ * @param src the message, no alignment constraint
+ * @param length the length of the message, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is used, -EIO on DMA error
+ */
+int hca_hmac_digest(struct hca_hmac * hm, uint8_t * mac, size_t mac_len,
+                    const uint8_t * src, size_t length);
+
+#endif // HCA_HMAC_H
@@ -0,0 +1,168 @@
+/**
+ * @file queue.h
+ * @brief HCA crypto engine driver: DMA job queue
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_QUEUE_H
+#define HCA_QUEUE_H
+
+#include "hca/aes.h"
+#include "hca/hca.h"
+#include "hca/sha.h"
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** Engine fed by a job, values match the CR IFIFOTGT field */
+enum hca_job_target {
+    HCA_JOB_AES = 0u,
+    HCA_JOB_SHA = 1u,
+};
+
+/** A DMA job, i.e. a segment of a scatter-gather operation */
+struct hca_job {
+    const uint8_t * hj_src;         /**< DMA-aligned source */
+    uint8_t * hj_dst;               /**< DMA-aligned destination, or NULL */
+    size_t hj_count;                /**< Size in DMA block count */
+    enum hca_job_target hj_target;  /**< Engine to feed */
+};
+
+/**
+ * Job queue.
+ *
+ * Jobs are run back to back: the HCA IRQ handler starts the next job as
+ * soon as the DMA completes the current one. Other harts than the one the
+ * HCA IRQ is routed to may submit jobs and wait for their completion, which
+ * is signalled with a software interrupt (IPI).
+ */
+struct hca_queue {
+    struct hca_job * hq_jobs;   /**< Ring storage */
+    size_t hq_size;             /**< Ring capacity, a power of 2 */
+    volatile size_t hq_head;    /**< Index of the running job */
+    volatile size_t hq_tail;    /**< Index of the next free slot */
+    volatile size_t hq_offset;  /**< DMA blocks of the head job started */
+    volatile size_t hq_segment; /**< DMA blocks of the running segment */
+    volatile size_t hq_done;    /**< Count of completed jobs */
+    volatile int hq_error;      /**< First error, sticky until reinit */
+    volatile bool hq_running;   /**< Whether a DMA request is on-going */
+    size_t hq_synced;           /**< First job not synced on other harts */
+    volatile unsigned long hq_waiters; /**< Waiting harts, as a mask */
+    int hq_hart;                /**< Hart the HCA IRQ is routed to */
+};
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Initialize a job queue and route the HCA IRQ to it.
+ *
+ * Only one queue may be active at a time, and the HCA IRQ is routed to the
+ * current hart. The crypto engines should be configured w/
+ * #hca_queue_aes_setup or #hca_queue_sha_start before jobs are submitted.
+ *
+ * @param hq the queue to initialize
+ * @param jobs the ring storage
+ * @param size the count of jobs in the ring, a power of 2
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if a queue is
+ *         already active, -ENOTSUP if the queue lock cannot be placed in
+ *         atomic-capable memory, -ENODEV if the HCA IRQ cannot be routed
+ */
+int hca_queue_init(struct hca_queue * hq, struct hca_job * jobs, size_t size);
+
+/**
+ * Wait for all submitted jobs, then release the HCA IRQ.
+ *
+ * @param hq the queue
+ * @return 0 on success, -EINVAL on invalid parameter, or the first job
+ *         error
+ */
+int hca_queue_fini(struct hca_queue * hq);
+
+/**
+ * Submit a job; the DMA is started right away if the queue is idle.
+ *
+ * Jobs larger than what a single DMA request can describe are split into
+ * several segments.
+ *
+ * The HCA IRQ handler only maintains the L1 data cache of its own hart.
+ * When submitted from any other hart, the job buffers are written back and
+ * discarded from the cache of the current hart, and the job output is only
+ * valid on this hart once #hca_queue_wait returns.
+ *
+ * @param hq the queue
+ * @param job the job to copy into the queue
+ * @return 0 on success, -EINVAL on invalid parameter, -EAGAIN if the queue
+ *         is full, -EBUSY if the DMA is used by another request, -EIO if a
+ *         previous job failed
+ */
+int hca_queue_submit(struct hca_queue * hq, const struct hca_job * job);
+
+/**
+ * Wait for the completion of all submitted jobs.
+ *
+ * On the hart the HCA IRQ is routed to, the hart sleeps until the HCA IRQ
+ * handler completes the last job, and this should be called w/ machine
+ * interrupts enabled. Any other hart sleeps w/ machine interrupts masked
+ * until the handler signals a job completion w/ a software interrupt (IPI),
+ * which is consumed by the queue and never reaches a handler, then discards
+ * the output of the completed jobs from its L1 data cache.
+ *
+ * @param hq the queue
+ * @return 0 on success, -EINVAL on invalid parameter, -EIO on DMA error
+ */
+int hca_queue_wait(struct hca_queue * hq);
+
+/**
+ * Configure the AES engine for the AES jobs submitted next.
+ *
+ * The configuration is kept until the engine is used by another request,
+ * and jobs are processed as a single request: CBC and CTR chain across
+ * jobs.
+ *
+ * @param hq the queue, w/o pending job
+ * @param as the AES session
+ * @param mode the mode, either HCA_AES_ECB, HCA_AES_CBC or HCA_AES_CTR
+ * @param proc the processing direction, ignored in CTR mode
+ * @param iv the CBC IV or CTR counter block, ignored in ECB mode
+ * @return 0 on success, -EINVAL on invalid parameter, -ENOTSUP in GCM mode,
+ *         -EBUSY if jobs are pending, or if the AES engine or the DMA is in
+ *         use
+ */
+int hca_queue_aes_setup(struct hca_queue * hq,
+                        const struct hca_aes_session * as,
+                        enum hca_aes_mode mode, enum hca_aes_process proc,
+                        const uint8_t * iv);
+
+/**
+ * Start or resume the hash of a session w/ the SHA jobs submitted next.
+ *
+ * The jobs should only contain whole SHA blocks. Once they are complete,
+ * #hca_queue_sha_done accounts for them in the session, which may then be
+ * updated or finalized as usual.
+ *
+ * @param hq the queue, w/o pending job
+ * @param ss the SHA session, which should not hold any carry bytes
+ * @return 0 on success, -EINVAL on invalid parameter or if the session
+ *         holds carry bytes, -EBUSY if jobs are pending or if the engine is
+ *         used by another session, -EIO on DMA error
+ */
+int hca_queue_sha_start(struct hca_queue * hq, struct hca_sha_session * ss);
+
+/**
+ * Account for the message bytes hashed by the completed SHA jobs.
+ *
+ * @param hq the queue, whose jobs are complete
+ * @param ss the SHA session
+ * @param length the count of bytes hashed by the jobs
+ * @return 0 on success, -EINVAL on invalid parameter, or the first job
+ *         error, in which case the session message is dropped
+ */
+int hca_queue_sha_done(struct hca_queue * hq, struct hca_sha_session * ss,
+                       size_t length);
+
+#endif // HCA_QUEUE_H
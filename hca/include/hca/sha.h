@@ -0,0 +1,238 @@
+/**
+ * @file sha.h
+ * @brief HCA crypto engine driver: SHA-2 hashing
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_SHA_H
+#define HCA_SHA_H
+
+#include "hca/hca.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define HCA_SHA256_BLOCK_SIZE    64u   // bytes
+#define HCA_SHA256_LEN_SIZE      8u    // bytes
+#define HCA_SHA512_BLOCK_SIZE    128u  // bytes
+#define HCA_SHA512_LEN_SIZE      16u   // bytes
+
+#define HCA_SHA_MAX_DIGEST_SIZE  64u   // bytes
+
+/** Size of a trail buffer: carry, worst case padding and alignment room */
+#define HCA_SHA_TRAIL_SIZE       (2u*HCA_SHA512_BLOCK_SIZE)
+
+#ifndef HCA_SHA_SW_THRESHOLD
+/** Default length below which #hca_sha_digest hashes in software */
+#define HCA_SHA_SW_THRESHOLD     64u   // bytes
+#endif // HCA_SHA_SW_THRESHOLD
+
+/** Longest message length tried by #hca_sha_calibrate */
+#define HCA_SHA_CALIBRATE_MAX    1024u  // bytes
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** SHA-2 flavours, values match the SHA_CR MODE field */
+enum hca_sha_mode {
+    HCA_SHA224 = 0x0u,
+    HCA_SHA256 = 0x1u,
+    HCA_SHA384 = 0x2u,
+    HCA_SHA512 = 0x3u,
+};
+
+/** A message to hash in a batch */
+struct hca_sha_record {
+    const uint8_t * sr_data;    /**< Message, no alignment constraint */
+    size_t sr_length;           /**< Size in bytes */
+};
+
+/** SHA session */
+struct hca_sha_session {
+    /**
+     * Double trail buffers: carry of the bytes which do not fill a DMA
+     * block, followed by the padding on finalization. One buffer may be
+     * in-flight while the next message is assembled in the other one.
+     */
+    uint8_t ss_trail[2u][HCA_SHA_TRAIL_SIZE] HCA_DMA_ALIGN;
+    uint64_t ss_length;         /**< Count of hashed bytes */
+    uint8_t * ss_hash;          /**< Pending digest destination */
+    size_t ss_carry_len;        /**< Count of bytes in the carry */
+    unsigned int ss_trail_ix;   /**< Index of the trail buffer in use */
+    enum hca_sha_mode ss_mode;  /**< SHA-2 flavour */
+    bool ss_started;            /**< Whether the engine has been started */
+    bool ss_inflight;           /**< Whether a DMA request is on-going */
+    bool ss_pipeline;           /**< Whether completion is deferred */
+};
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Initialize a SHA session.
+ *
+ * A session may be used either with the #hca_sha_update/#hca_sha_final
+ * streaming API, or with the one-shot #hca_sha_digest API. The SHA engine
+ * holds the intermediate hash, so only one session may be in progress at a
+ * time, although AES requests may be interleaved between updates.
+ *
+ * @param ss the session to initialize
+ * @param mode the SHA-2 flavour
+ * @return 0 on success, -EINVAL on invalid parameter, -ENODEV if the SHA
+ *         engine is not present
+ */
+int hca_sha_init(struct hca_sha_session * ss, enum hca_sha_mode mode);
+
+/**
+ * Enable or disable the pipelined mode of a session.
+ *
+ * In pipelined mode, #hca_sha_update and #hca_sha_final return as soon as
+ * their DMA request is started, so that the CPU may prepare the next chunk
+ * or message while the engine runs. Each request is completed on the next
+ * call on the session, or with #hca_sha_sync. Source buffers should not be
+ * modified and the digest is not available before then.
+ *
+ * @param ss the session
+ * @param enable whether to enable the pipelined mode
+ * @return 0 on success, -EINVAL on invalid parameter, -EIO on DMA error
+ *         while completing a pending request
+ */
+int hca_sha_set_pipeline(struct hca_sha_session * ss, bool enable);
+
+/**
+ * Wait for the completion of the pending requests of a session, and store
+ * any pending digest.
+ *
+ * @param ss the session
+ * @return 0 on success, -EINVAL on invalid parameter, -EIO on DMA error
+ */
+int hca_sha_sync(struct hca_sha_session * ss);
+
+/**
+ * Hash a chunk of a message.
+ *
+ * DMA-aligned runs of the chunk are sent with DMA straight from the caller
+ * buffer; only the bytes which do not fill a DMA block are kept in the
+ * session, to be sent along with the next chunk.
+ *
+ * @param ss the session
+ * @param src the message chunk, no alignment constraint
+ * @param length the length of the chunk, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is used by another session, -EIO on DMA error
+ */
+int hca_sha_update(struct hca_sha_session * ss, const uint8_t * src,
+                   size_t length);
+
+/**
+ * Pad the message, retrieve its digest and reset the session so that it
+ * can be used for a new message.
+ *
+ * @param ss the session
+ * @param hash the output digest buffer, no alignment constraint
+ * @param hash_len the size of the digest buffer, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is used by another session, -EIO on DMA error
+ */
+int hca_sha_final(struct hca_sha_session * ss, uint8_t * hash,
+                  size_t hash_len);
+
+/**
+ * Hash a whole message.
+ *
+ * The aligned part of the message is sent with DMA, unaligned head and tail
+ * bytes are pushed from the CPU. Messages shorter than the software
+ * threshold are hashed in software, as setting up the engine costs more
+ * than hashing them.
+ *
+ * @param ss the session
+ * @param hash the output digest buffer, no alignment constraint
+ * @param hash_len the size of the digest buffer, in bytes
+ * @param src the message, no alignment constraint
+ * @param length the length of the message, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is used by another session, -EIO on DMA error
+ */
+int hca_sha_digest(struct hca_sha_session * ss, uint8_t * hash,
+                   size_t hash_len, const uint8_t * src, size_t length);
+
+/**
+ * Hash a batch of independent messages.
+ *
+ * The engine is configured once for the whole batch, then messages are
+ * hashed back to back, each digest being retrieved as soon as its message
+ * is complete. This is the fastest way to hash many small messages.
+ *
+ * The session should not have a message in progress. Digests are stored
+ * contiguously, in record order.
+ *
+ * @param ss the session
+ * @param records the messages to hash
+ * @param count the count of records
+ * @param digests the output digest buffer, no alignment constraint
+ * @param digests_len the size of the digest buffer, in bytes, at least
+ *                    count times the digest size
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is used or the session has a message in progress, -EIO on DMA
+ *         error
+ */
+int hca_sha_hash_many(struct hca_sha_session * ss,
+                      const struct hca_sha_record * records, size_t count,
+                      uint8_t * digests, size_t digests_len);
+
+/**
+ * Set the length below which #hca_sha_digest hashes in software, leaving
+ * the SHA engine free for bulk requests.
+ *
+ * @param mode the SHA-2 flavour
+ * @param threshold the length in bytes, 0 to always use the SHA engine
+ * @return 0 on success, -EINVAL on invalid parameter
+ */
+int hca_sha_set_sw_threshold(enum hca_sha_mode mode, size_t threshold);
+
+/**
+ * Get the length below which #hca_sha_digest hashes in software.
+ *
+ * @param mode the SHA-2 flavour
+ * @return the length in bytes
+ */
+size_t hca_sha_get_sw_threshold(enum hca_sha_mode mode);
+
+/**
+ * Measure the crossover length between software and SHA engine hashing on
+ * this platform, and use it as the software threshold.
+ *
+ * @param mode the SHA-2 flavour
+ * @param threshold updated with the measured threshold, may be NULL
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if the engine
+ *         is used, -ENODEV if the engine is not present, -EIO on DMA error
+ */
+int hca_sha_calibrate(enum hca_sha_mode mode, size_t * threshold);
+
+/**
+ * Hash a message in software, w/o using the SHA engine.
+ *
+ * @param mode the SHA-2 flavour
+ * @param hash the output digest buffer, no alignment constraint
+ * @param hash_len the size of the digest buffer, in bytes
+ * @param src the message, no alignment constraint
+ * @param length the length of the message, in bytes
+ * @return 0 on success, -EINVAL on invalid parameter
+ */
+int hca_sha_sw_digest(enum hca_sha_mode mode, uint8_t * hash,
+                      size_t hash_len, const uint8_t * src, size_t length);
+
+/**
+ * Get the size of the digest for a SHA-2 flavour.
+ *
+ * @param mode the SHA-2 flavour
+ * @return the size of the digest in bytes, or 0 for an invalid mode
+ */
+size_t hca_sha_digest_size(enum hca_sha_mode mode);
+
+#endif // HCA_SHA_H
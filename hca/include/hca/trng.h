@@ -0,0 +1,75 @@
+/**
+ * @file trng.h
+ * @brief HCA crypto engine driver: TRNG entropy pool
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_TRNG_H
+#define HCA_TRNG_H
+
+#include "hca/hca.h"
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/**
+ * Entropy pool.
+ *
+ * The pool is refilled from the TRNG IRQ handler, and drained by
+ * #hca_getrandom. Refill stops once the pool is full, and resumes as soon
+ * as the pool falls below half of its capacity.
+ */
+struct hca_trng {
+    uint32_t * tr_pool;         /**< Ring storage */
+    size_t tr_size;             /**< Ring capacity in words, a power of 2 */
+    volatile size_t tr_head;    /**< Index of the next word to deliver */
+    volatile size_t tr_tail;    /**< Index of the next word to collect */
+    volatile bool tr_refill;    /**< Whether the TRNG IRQ is enabled */
+    volatile int tr_error;      /**< Health test failure, sticky */
+};
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+/**
+ * Run the TRNG startup health test, then start filling the entropy pool.
+ *
+ * Only one pool may be active at a time.
+ *
+ * @param tr the pool to initialize
+ * @param pool the ring storage
+ * @param size the count of words in the ring, a power of 2
+ * @param burst whether to enable the TRNG burst mode
+ * @return 0 on success, -EINVAL on invalid parameter, -EBUSY if a pool is
+ *         already active, -ENODEV if the TRNG is not present or its IRQ
+ *         cannot be routed, -EIO if the health test fails
+ */
+int hca_trng_init(struct hca_trng * tr, uint32_t * pool, size_t size,
+                  bool burst);
+
+/**
+ * Stop the TRNG and clear the entropy pool.
+ *
+ * @param tr the pool
+ * @return 0 on success, -EINVAL on invalid parameter
+ */
+int hca_trng_fini(struct hca_trng * tr);
+
+/**
+ * Fill a buffer with random bytes.
+ *
+ * Bytes are taken from the entropy pool; only when the pool runs dry is
+ * the TRNG polled directly.
+ *
+ * @param buf the buffer to fill
+ * @param len the count of bytes to generate
+ * @return 0 on success, -EINVAL on invalid parameter, -ENODEV if no pool
+ *         is active, -EIO on TRNG health test failure
+ */
+int hca_getrandom(void * buf, size_t len);
+
+#endif // HCA_TRNG_H
@@ -0,0 +1,833 @@
+/**
+ * @file aes.c
+ * @brief HCA crypto engine driver: AES ciphering
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <limits.h>
+#include <string.h>
+#include "hca/aes.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+/** AES_CR KEYSZ values */
+#define HCA_AES_KEYSZ_128 0u
+#define HCA_AES_KEYSZ_192 1u
+#define HCA_AES_KEYSZ_256 2u
+
+/** AES_CR DTYPE values */
+#define HCA_AES_DTYPE_AAD     0u
+#define HCA_AES_DTYPE_PAYLOAD 1u
+
+#ifndef HCA_AES_BOUNCE_SIZE
+/** Size of the aligned buffer used when the GCM output is not DMA-aligned */
+#define HCA_AES_BOUNCE_SIZE   256u  // bytes
+#endif // HCA_AES_BOUNCE_SIZE
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+/** Streaming context which reserves the AES engine, if any */
+static const struct hca_aes_gcm_context * _hca_aes_owner;
+
+/** Identifier of the key loaded into the engine, 0 if unknown */
+static uint32_t _hca_aes_loaded_key;
+
+/** Last assigned key identifier */
+static uint32_t _hca_aes_key_serial;
+
+/** Aligned output buffer for misaligned streaming GCM payload */
+static uint8_t _hca_aes_bounce[HCA_AES_BOUNCE_SIZE] HCA_DMA_ALIGN;
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+/**
+ * Load the session key, unless the engine already holds it.
+ *
+ * The most significant key word is stored at the highest register address,
+ * whatever the key size.
+ */
+static void
+_hca_aes_load_key(const struct hca_aes_session * as)
+{
+    if ( _hca_aes_loaded_key == as->as_key_id ) {
+        return;
+    }
+
+    uint32_t offset = METAL_SIFIVE_HCA_AES_KEY + HCA_AES_MAX_KEY_SIZE;
+    for (unsigned int ix=0; ix<as->as_key_len/sizeof(uint32_t); ix++) {
+        offset -= sizeof(uint32_t);
+        METAL_REG32(HCA_BASE, offset) = as->as_key[ix];
+    }
+
+    _hca_aes_loaded_key = as->as_key_id;
+}
+
+static void
+_hca_aes_set_iv96(const uint8_t * iv)
+{
+    uint32_t dwiv[HCA_AES_GCM_IV_SIZE/sizeof(uint32_t)];
+
+    // IV may not be aligned
+    memcpy(dwiv, iv, sizeof(dwiv));
+
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_INITV+0x0cu) =
+        __builtin_bswap32(dwiv[0u]);
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_INITV+0x08u) =
+        __builtin_bswap32(dwiv[1u]);
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_INITV+0x04u) =
+        __builtin_bswap32(dwiv[2u]);
+}
+
+static void
+_hca_aes_set_iv128(const uint8_t * iv)
+{
+    uint32_t dwiv[HCA_AES_BLOCK_SIZE/sizeof(uint32_t)];
+
+    // IV may not be aligned
+    memcpy(dwiv, iv, sizeof(dwiv));
+
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_INITV+0x0cu) =
+        __builtin_bswap32(dwiv[0u]);
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_INITV+0x08u) =
+        __builtin_bswap32(dwiv[1u]);
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_INITV+0x04u) =
+        __builtin_bswap32(dwiv[2u]);
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_INITV+0x00u) =
+        __builtin_bswap32(dwiv[3u]);
+
+    // AES init: restart the chaining from the IV
+    _hca_cfg_trigger(HCA_CFG_AES_CR, _hca_cfg_value(HCA_CFG_AES_CR),
+                     HCA_REGISTER_AES_CR_INIT_MASK <<
+                     HCA_REGISTER_AES_CR_INIT_OFFSET);
+}
+
+/**
+ * Add a block count to a 128-bit big-endian counter block.
+ */
+static void
+_hca_aes_ctr_add(uint8_t * ctr, size_t count)
+{
+    uint64_t carry = (uint64_t)count;
+    for (unsigned int ix=HCA_AES_BLOCK_SIZE; carry && ix--; ) {
+        carry += ctr[ix];
+        ctr[ix] = (uint8_t)carry;
+        carry >>= CHAR_BIT;
+    }
+}
+
+static void
+_hca_aes_get_tag(uint8_t * tag)
+{
+    uint32_t dwtag[HCA_AES_GCM_TAG_SIZE/sizeof(uint32_t)];
+
+    for (unsigned int ix=0; ix<HCA_AES_GCM_TAG_SIZE; ix+=sizeof(uint32_t)) {
+        dwtag[(HCA_AES_GCM_TAG_SIZE - sizeof(uint32_t) - ix)/
+              sizeof(uint32_t)] =
+            __builtin_bswap32(
+                METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_AUTH+ix));
+    }
+
+    memcpy(tag, dwtag, sizeof(dwtag));
+}
+
+static uint32_t
+_hca_aes_keysz(const struct hca_aes_session * as)
+{
+    switch ( as->as_key_len ) {
+        case 192u/8u:
+            return HCA_AES_KEYSZ_192;
+        case 256u/8u:
+            return HCA_AES_KEYSZ_256;
+        default:
+            return HCA_AES_KEYSZ_128;
+    }
+}
+
+static void
+_hca_aes_setup(const struct hca_aes_session * as, enum hca_aes_mode mode,
+               enum hca_aes_process proc, uint32_t dtype)
+{
+    _hca_setup(HCA_FIFO_TARGET_AES);
+
+    // AES mode, key size, process and data type, w/o init request
+    uint32_t aes_cr =
+        (((uint32_t)mode & HCA_REGISTER_AES_CR_MODE_MASK) <<
+         HCA_REGISTER_AES_CR_MODE_OFFSET) |
+        ((_hca_aes_keysz(as) & HCA_REGISTER_AES_CR_KEYSZ_MASK) <<
+         HCA_REGISTER_AES_CR_KEYSZ_OFFSET) |
+        (((uint32_t)proc & HCA_REGISTER_AES_CR_PROCESS_MASK) <<
+         HCA_REGISTER_AES_CR_PROCESS_OFFSET) |
+        ((dtype & HCA_REGISTER_AES_CR_DTYPE_MASK) <<
+         HCA_REGISTER_AES_CR_DTYPE_OFFSET);
+    _hca_cfg_write(HCA_CFG_AES_CR, aes_cr);
+
+    _hca_aes_load_key(as);
+}
+
+/**
+ * Feed data to the AES engine and retrieve the processed blocks.
+ *
+ * When the destination is DMA-aligned, the non-aligned start of the source
+ * is pushed from the CPU, the aligned part is processed w/ DMA, then the
+ * remaining bytes are pushed, and the output blocks not yet written by the
+ * DMA are popped from the output FIFO.
+ *
+ * @param dst the output buffer
+ * @param src the input buffer
+ * @param length the count of bytes, a multiple of the AES block size
+ */
+static int
+_hca_aes_run(uint8_t * dst, const uint8_t * src, size_t length)
+{
+    if ( ! length ) {
+        return 0;
+    }
+
+    if ( ! HCA_IS_DMA_ALIGNED(dst) ) {
+        const uint8_t * end = src + length;
+        while ( src < end ) {
+            _hca_fifo_in_push(src, HCA_AES_BLOCK_SIZE);
+            while ( _hca_fifo_out_is_empty() ) {
+                // busy loop
+            }
+            _hca_fifo_out_pop(dst, HCA_AES_BLOCK_SIZE);
+            src += HCA_AES_BLOCK_SIZE;
+            dst += HCA_AES_BLOCK_SIZE;
+        }
+        return 0;
+    }
+
+    struct hca_buf_desc desc;
+    _hca_build_desc(&desc, src, length);
+
+    if ( desc.bd_prolog_len ) {
+        _hca_fifo_in_push(desc.bd_prolog, desc.bd_prolog_len);
+    }
+
+    if ( desc.bd_main_count ) {
+        int rc = _hca_dma_run(dst, desc.bd_main, desc.bd_main_count);
+        if ( rc ) {
+            return rc;
+        }
+    }
+
+    if ( desc.bd_epilog_len ) {
+        _hca_fifo_in_push(desc.bd_epilog, desc.bd_epilog_len);
+    }
+
+    size_t rem = desc.bd_prolog_len + desc.bd_epilog_len;
+    if ( rem ) {
+        _hca_aes_wait();
+        _hca_fifo_out_pop(&dst[desc.bd_main_count * HCA_DMA_BLOCK_SIZE],
+                          rem);
+    }
+
+    return 0;
+}
+
+/**
+ * Process AES blocks w/ DMA whatever the alignment of the output buffer.
+ *
+ * A misaligned output buffer would make _hca_aes_run fall back to the CPU
+ * FIFO loop, which is what most streaming GCM calls would end up with once
+ * a carry block has been emitted. In this case, the blocks are processed
+ * into an aligned buffer, then copied out.
+ *
+ * @param dst the output buffer
+ * @param src the input buffer
+ * @param length the count of bytes, a multiple of the AES block size
+ */
+static int
+_hca_aes_run_bounce(uint8_t * dst, const uint8_t * src, size_t length)
+{
+    if ( HCA_IS_DMA_ALIGNED(dst) ) {
+        return _hca_aes_run(dst, src, length);
+    }
+
+    while ( length ) {
+        size_t chunk = MIN(length, sizeof(_hca_aes_bounce));
+        int rc = _hca_aes_run(_hca_aes_bounce, src, chunk);
+        if ( rc ) {
+            return rc;
+        }
+        memcpy(dst, _hca_aes_bounce, chunk);
+        src += chunk;
+        dst += chunk;
+        length -= chunk;
+    }
+
+    return 0;
+}
+
+/**
+ * Feed data to the AES engine, w/o any output, e.g. GCM AAD.
+ */
+static int
+_hca_aes_feed(const uint8_t * src, size_t length)
+{
+    struct hca_buf_desc desc;
+    _hca_build_desc(&desc, src, length);
+
+    if ( desc.bd_prolog_len ) {
+        _hca_fifo_in_push(desc.bd_prolog, desc.bd_prolog_len);
+    }
+
+    if ( desc.bd_main_count ) {
+        int rc = _hca_dma_run(NULL, desc.bd_main, desc.bd_main_count);
+        if ( rc ) {
+            return rc;
+        }
+    }
+
+    if ( desc.bd_epilog_len ) {
+        _hca_fifo_in_push(desc.bd_epilog, desc.bd_epilog_len);
+    }
+
+    while ( ! _hca_fifo_in_is_empty() ) {
+        // busy loop
+    }
+
+    return 0;
+}
+
+/**
+ * Process the last, incomplete block of a GCM payload.
+ */
+static void
+_hca_aes_gcm_tail(uint8_t * dst, const uint8_t * src, size_t length)
+{
+    uint32_t block[HCA_AES_BLOCK_SIZE/sizeof(uint32_t)];
+
+    _hca_fifo_in_push(src, length);
+    _hca_aes_wait();
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(block); ix++) {
+        if ( _hca_fifo_out_is_empty() ) {
+            break;
+        }
+        block[ix] = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_FIFO_OUT);
+    }
+
+    memcpy(dst, block, length);
+}
+
+static void
+_hca_aes_set_dtype(uint32_t dtype)
+{
+    _hca_cfg_update(HCA_CFG_AES_CR, dtype,
+                    HCA_REGISTER_AES_CR_DTYPE_OFFSET,
+                    HCA_REGISTER_AES_CR_DTYPE_MASK);
+}
+
+/**
+ * Configure the engine for a GCM operation, ready to receive the AAD.
+ */
+static void
+_hca_aes_gcm_setup(const struct hca_aes_session * as,
+                   enum hca_aes_process proc, const uint8_t * iv,
+                   size_t aad_len, size_t length)
+{
+    // AES set AAD
+    _hca_aes_setup(as, HCA_AES_GCM, proc, HCA_AES_DTYPE_AAD);
+    _hca_aes_set_iv96(iv);
+
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_ALEN+0u) = (uint32_t)aad_len;
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_ALEN+4u) =
+        (uint32_t)((uint64_t)aad_len >> 32u);
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_PDLEN+0u) = (uint32_t)length;
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_PDLEN+4u) =
+        (uint32_t)((uint64_t)length >> 32u);
+}
+
+/**
+ * Resume a streaming GCM operation.
+ *
+ * The input FIFO may have been retargeted by a SHA request since the
+ * previous call on the context.
+ */
+static int
+_hca_aes_gcm_resume(const struct hca_aes_gcm_context * gc)
+{
+    if ( _hca_aes_owner != gc ) {
+        // context not started, or already completed
+        return -EINVAL;
+    }
+
+    if ( _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_setup(HCA_FIFO_TARGET_AES);
+
+    return 0;
+}
+
+/**
+ * Push the last, incomplete AAD block if any and switch to the payload.
+ */
+static int
+_hca_aes_gcm_to_payload(struct hca_aes_gcm_context * gc)
+{
+    if ( gc->gc_payload ) {
+        return 0;
+    }
+
+    if ( gc->gc_aad_left ) {
+        return -EINVAL;
+    }
+
+    if ( gc->gc_carry_len ) {
+        _hca_fifo_in_push(gc->gc_carry, gc->gc_carry_len);
+        gc->gc_carry_len = 0u;
+        while ( ! _hca_fifo_in_is_empty() ) {
+            // busy loop
+        }
+    }
+
+    // AES set Payload
+    _hca_aes_set_dtype(HCA_AES_DTYPE_PAYLOAD);
+    gc->gc_payload = true;
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Internal API
+//-----------------------------------------------------------------------------
+
+void
+_hca_aes_key_invalidate(void)
+{
+    _hca_aes_loaded_key = 0u;
+}
+
+int
+_hca_aes_chain_setup(const struct hca_aes_session * as,
+                     enum hca_aes_mode mode, enum hca_aes_process proc,
+                     const uint8_t * iv)
+{
+    if ( _hca_aes_owner || _hca_aes_is_busy() || _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    if ( mode == HCA_AES_CTR ) {
+        // CTR is symmetric, the engine always encrypts the counter blocks
+        proc = HCA_AES_ENCRYPT;
+    }
+
+    _hca_aes_setup(as, mode, proc, HCA_AES_DTYPE_PAYLOAD);
+    if ( mode != HCA_AES_ECB ) {
+        _hca_aes_set_iv128(iv);
+    }
+
+    return 0;
+}
+
+void
+_hca_aes_chain_next_iv(enum hca_aes_mode mode, uint8_t * iv,
+                       const uint8_t * last, size_t count)
+{
+    if ( mode == HCA_AES_CTR ) {
+        _hca_aes_ctr_add(iv, count);
+    } else {
+        memcpy(iv, last, HCA_AES_BLOCK_SIZE);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_aes_init(struct hca_aes_session * as, const uint8_t * key,
+             size_t key_len)
+{
+    if ( ! as || ! key ) {
+        return -EINVAL;
+    }
+
+    switch ( key_len ) {
+        case 128u/8u:
+        case 192u/8u:
+        case 256u/8u:
+            break;
+        default:
+            return -EINVAL;
+    }
+
+    if ( ! METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_REV) ) {
+        return -ENODEV;
+    }
+
+    // key may not be aligned
+    memcpy(as->as_key, key, key_len);
+    for (unsigned int ix=0; ix<key_len/sizeof(uint32_t); ix++) {
+        as->as_key[ix] = __builtin_bswap32(as->as_key[ix]);
+    }
+    as->as_key_len = key_len;
+
+    // a new identifier, so that a session initialized again w/ another key
+    // is not mistaken for the loaded one
+    uint32_t key_id;
+    do {
+        key_id = __atomic_add_fetch(&_hca_aes_key_serial, 1u,
+                                    __ATOMIC_RELAXED);
+    } while ( ! key_id );
+    as->as_key_id = key_id;
+
+    return 0;
+}
+
+int
+hca_aes_ecb(struct hca_aes_session * as, enum hca_aes_process proc,
+            uint8_t * dst, const uint8_t * src, size_t length)
+{
+    if ( ! as || ! dst || ! src ) {
+        return -EINVAL;
+    }
+
+    if ( length & (HCA_AES_BLOCK_SIZE - 1u) ) {
+        return -EINVAL;
+    }
+
+    if ( _hca_aes_owner || _hca_aes_is_busy() || _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_aes_setup(as, HCA_AES_ECB, proc, HCA_AES_DTYPE_PAYLOAD);
+
+    int rc = _hca_aes_run(dst, src, length);
+    if ( rc ) {
+        return rc;
+    }
+
+    _hca_aes_wait();
+
+    return 0;
+}
+
+int
+hca_aes_cbc(struct hca_aes_session * as, enum hca_aes_process proc,
+            uint8_t * dst, const uint8_t * src, size_t length, uint8_t * iv)
+{
+    if ( ! as || ! dst || ! src || ! iv ) {
+        return -EINVAL;
+    }
+
+    if ( length & (HCA_AES_BLOCK_SIZE - 1u) ) {
+        return -EINVAL;
+    }
+
+    if ( ! length ) {
+        return 0;
+    }
+
+    if ( _hca_aes_owner || _hca_aes_is_busy() || _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_aes_setup(as, HCA_AES_CBC, proc, HCA_AES_DTYPE_PAYLOAD);
+    _hca_aes_set_iv128(iv);
+
+    // the next IV is the last ciphertext block, which is overwritten if
+    // decrypting in place
+    uint8_t next_iv[HCA_AES_BLOCK_SIZE];
+    if ( proc == HCA_AES_DECRYPT ) {
+        memcpy(next_iv, &src[length - HCA_AES_BLOCK_SIZE], sizeof(next_iv));
+    }
+
+    int rc = _hca_aes_run(dst, src, length);
+    if ( rc ) {
+        return rc;
+    }
+
+    _hca_aes_wait();
+
+    if ( proc == HCA_AES_DECRYPT ) {
+        memcpy(iv, next_iv, sizeof(next_iv));
+    } else {
+        memcpy(iv, &dst[length - HCA_AES_BLOCK_SIZE], HCA_AES_BLOCK_SIZE);
+    }
+
+    return 0;
+}
+
+int
+hca_aes_ctr(struct hca_aes_session * as, uint8_t * dst,
+            const uint8_t * src, size_t length, uint8_t * ctr)
+{
+    if ( ! as || ! dst || ! src || ! ctr ) {
+        return -EINVAL;
+    }
+
+    if ( ! length ) {
+        return 0;
+    }
+
+    if ( _hca_aes_owner || _hca_aes_is_busy() || _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    // CTR is symmetric, the engine always encrypts the counter blocks
+    _hca_aes_setup(as, HCA_AES_CTR, HCA_AES_ENCRYPT, HCA_AES_DTYPE_PAYLOAD);
+    _hca_aes_set_iv128(ctr);
+
+    size_t full = length & ~(HCA_AES_BLOCK_SIZE - 1u);
+    int rc = _hca_aes_run(dst, src, full);
+    if ( rc ) {
+        return rc;
+    }
+    _hca_aes_ctr_add(ctr, full / HCA_AES_BLOCK_SIZE);
+
+    if ( length > full ) {
+        // pad the last block, only keep the requested bytes
+        uint32_t block[HCA_AES_BLOCK_SIZE/sizeof(uint32_t)];
+        memset(block, 0, sizeof(block));
+        memcpy(block, &src[full], length - full);
+        rc = _hca_aes_run((uint8_t *)block, (const uint8_t *)block,
+                          sizeof(block));
+        if ( rc ) {
+            return rc;
+        }
+        memcpy(&dst[full], block, length - full);
+        _hca_aes_ctr_add(ctr, 1u);
+    }
+
+    _hca_aes_wait();
+
+    return 0;
+}
+
+int
+hca_aes_gcm(struct hca_aes_session * as, enum hca_aes_process proc,
+            uint8_t * dst, uint8_t * tag, const uint8_t * iv,
+            const uint8_t * src, size_t length,
+            const uint8_t * aad, size_t aad_len)
+{
+    if ( ! as || ! tag || ! iv ) {
+        return -EINVAL;
+    }
+
+    if ( (length && (! src || ! dst)) || (aad_len && ! aad) ) {
+        return -EINVAL;
+    }
+
+    if ( _hca_aes_owner || _hca_aes_is_busy() || _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_aes_gcm_setup(as, proc, iv, aad_len, length);
+
+    int rc;
+
+    if ( aad_len ) {
+        rc = _hca_aes_feed(aad, aad_len);
+        if ( rc ) {
+            return rc;
+        }
+    }
+
+    // AES set Payload
+    _hca_aes_set_dtype(HCA_AES_DTYPE_PAYLOAD);
+
+    size_t full = length & ~(HCA_AES_BLOCK_SIZE - 1u);
+    rc = _hca_aes_run(dst, src, full);
+    if ( rc ) {
+        return rc;
+    }
+
+    if ( length > full ) {
+        _hca_aes_gcm_tail(&dst[full], &src[full], length - full);
+    }
+
+    _hca_aes_wait();
+    _hca_aes_get_tag(tag);
+
+    return 0;
+}
+
+int
+hca_aes_gcm_start(struct hca_aes_gcm_context * gc,
+                  struct hca_aes_session * as, enum hca_aes_process proc,
+                  const uint8_t * iv, size_t aad_len, size_t length)
+{
+    if ( ! gc || ! as || ! iv ) {
+        return -EINVAL;
+    }
+
+    if ( _hca_aes_owner && (_hca_aes_owner != gc) ) {
+        return -EBUSY;
+    }
+
+    if ( _hca_aes_is_busy() || _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_aes_gcm_setup(as, proc, iv, aad_len, length);
+
+    gc->gc_carry_len = 0u;
+    gc->gc_aad_left = aad_len;
+    gc->gc_payload_left = length;
+    gc->gc_payload = false;
+
+    _hca_aes_owner = gc;
+
+    return 0;
+}
+
+int
+hca_aes_gcm_aad_update(struct hca_aes_gcm_context * gc,
+                       const uint8_t * aad, size_t aad_len)
+{
+    if ( ! gc || (aad_len && ! aad) ) {
+        return -EINVAL;
+    }
+
+    if ( gc->gc_payload || (aad_len > gc->gc_aad_left) ) {
+        return -EINVAL;
+    }
+
+    int rc = _hca_aes_gcm_resume(gc);
+    if ( rc ) {
+        return rc;
+    }
+
+    gc->gc_aad_left -= aad_len;
+
+    if ( gc->gc_carry_len ) {
+        size_t fill = MIN(HCA_AES_BLOCK_SIZE - gc->gc_carry_len, aad_len);
+        memcpy(&gc->gc_carry[gc->gc_carry_len], aad, fill);
+        gc->gc_carry_len += fill;
+        aad += fill;
+        aad_len -= fill;
+        if ( gc->gc_carry_len == HCA_AES_BLOCK_SIZE ) {
+            _hca_fifo_in_push(gc->gc_carry, HCA_AES_BLOCK_SIZE);
+            gc->gc_carry_len = 0u;
+        }
+    }
+
+    size_t full = aad_len & ~(HCA_AES_BLOCK_SIZE - 1u);
+    if ( full ) {
+        rc = _hca_aes_feed(aad, full);
+        if ( rc ) {
+            _hca_aes_owner = NULL;
+            return rc;
+        }
+    }
+
+    memcpy(&gc->gc_carry[gc->gc_carry_len], &aad[full], aad_len - full);
+    gc->gc_carry_len += aad_len - full;
+
+    return 0;
+}
+
+int
+hca_aes_gcm_update(struct hca_aes_gcm_context * gc, uint8_t * dst,
+                   const uint8_t * src, size_t length, size_t * out_len)
+{
+    if ( ! gc || ! out_len || (length && (! src || ! dst)) ) {
+        return -EINVAL;
+    }
+
+    if ( length > gc->gc_payload_left ) {
+        return -EINVAL;
+    }
+
+    int rc = _hca_aes_gcm_resume(gc);
+    if ( rc ) {
+        return rc;
+    }
+
+    rc = _hca_aes_gcm_to_payload(gc);
+    if ( rc ) {
+        return rc;
+    }
+
+    *out_len = 0u;
+    size_t total = length;
+
+    if ( gc->gc_carry_len ) {
+        size_t fill = MIN(HCA_AES_BLOCK_SIZE - gc->gc_carry_len, length);
+        memcpy(&gc->gc_carry[gc->gc_carry_len], src, fill);
+        gc->gc_carry_len += fill;
+        src += fill;
+        length -= fill;
+        if ( gc->gc_carry_len < HCA_AES_BLOCK_SIZE ) {
+            gc->gc_payload_left -= total;
+            return 0;
+        }
+        // the carry block is emitted on its own, the output buffer may not
+        // be DMA-aligned anymore for the complete blocks
+        rc = _hca_aes_run(dst, gc->gc_carry, HCA_AES_BLOCK_SIZE);
+        if ( rc ) {
+            _hca_aes_owner = NULL;
+            return rc;
+        }
+        gc->gc_carry_len = 0u;
+        dst += HCA_AES_BLOCK_SIZE;
+        *out_len += HCA_AES_BLOCK_SIZE;
+    }
+
+    // process the complete blocks w/ DMA, in place when the output buffer
+    // is aligned
+    size_t full = length & ~(HCA_AES_BLOCK_SIZE - 1u);
+    rc = _hca_aes_run_bounce(dst, src, full);
+    if ( rc ) {
+        _hca_aes_owner = NULL;
+        return rc;
+    }
+    *out_len += full;
+
+    memcpy(gc->gc_carry, &src[full], length - full);
+    gc->gc_carry_len = length - full;
+    gc->gc_payload_left -= total;
+
+    return 0;
+}
+
+int
+hca_aes_gcm_finish(struct hca_aes_gcm_context * gc, uint8_t * dst,
+                   size_t * out_len, uint8_t * tag)
+{
+    if ( ! gc || ! out_len || ! tag ) {
+        return -EINVAL;
+    }
+
+    int rc = _hca_aes_gcm_resume(gc);
+    if ( rc ) {
+        return rc;
+    }
+
+    // whatever the outcome, the context is completed
+    _hca_aes_owner = NULL;
+
+    rc = _hca_aes_gcm_to_payload(gc);
+    if ( rc || gc->gc_payload_left ) {
+        return -EINVAL;
+    }
+
+    *out_len = 0u;
+
+    if ( gc->gc_carry_len ) {
+        if ( ! dst ) {
+            return -EINVAL;
+        }
+        _hca_aes_gcm_tail(dst, gc->gc_carry, gc->gc_carry_len);
+        *out_len = gc->gc_carry_len;
+        gc->gc_carry_len = 0u;
+    }
+
+    _hca_aes_wait();
+    _hca_aes_get_tag(tag);
+
+    return 0;
+}
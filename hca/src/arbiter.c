@@ -0,0 +1,237 @@
+/**
+ * @file arbiter.c
+ * @brief HCA crypto engine driver: multi-hart engine arbitration
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <metal/cpu.h>
+#include <metal/lock.h>
+#include <metal/machine.h>
+#include "hca/arbiter.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define HCA_ARBITER_MAX_HARTS (__METAL_DT_MAX_HARTS)
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+METAL_LOCK_DECLARE(_hca_arbiter_lock);
+
+/** Hart which owns the HCA */
+static volatile int _hca_arbiter_owner = HCA_ARBITER_NO_OWNER;
+/** Per-hart ownership transfer flag, set by the previous owner */
+static volatile bool _hca_arbiter_granted[HCA_ARBITER_MAX_HARTS];
+/** Pending requests, in arrival order; a hart is queued at most once */
+static int _hca_arbiter_waiters[HCA_ARBITER_MAX_HARTS];
+static size_t _hca_arbiter_head;
+static size_t _hca_arbiter_tail;
+static bool _hca_arbiter_ready;
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+/**
+ * Take the arbiter lock.
+ *
+ * Machine interrupts are masked while the lock is held, so that the owner
+ * may release the HCA from its IRQ handler.
+ *
+ * @return the previous mstatus, to give back to #_hca_arbiter_unlock
+ */
+static unsigned long
+_hca_arbiter_lock_take(void)
+{
+    unsigned long mstatus = _hca_irq_save();
+    metal_lock_take(&_hca_arbiter_lock);
+    return mstatus;
+}
+
+static void
+_hca_arbiter_lock_give(unsigned long mstatus)
+{
+    metal_lock_give(&_hca_arbiter_lock);
+    _hca_irq_restore(mstatus);
+}
+
+/**
+ * Sleep until the HCA is handed over to the current hart.
+ *
+ * Called w/ machine interrupts masked: WFI still resumes on the pending
+ * IPI, which is then cleared w/o ever being taken.
+ */
+static void
+_hca_arbiter_wait(int hartid)
+{
+    unsigned long mie;
+    __asm__ volatile ("csrrs %0, mie, %1" : "=r"(mie)
+                      : "r"(HCA_MIE_MSIE) : "memory");
+
+    while ( ! _hca_arbiter_granted[hartid] ) {
+        __asm__ volatile ("wfi");
+    }
+
+    // the previous owner raises the IPI w/ the lock held: once the lock is
+    // available, the IPI cannot be raised after it is cleared
+    metal_lock_take(&_hca_arbiter_lock);
+    hca_ipi_signal(hartid, false);
+    metal_lock_give(&_hca_arbiter_lock);
+
+    if ( ! (mie & HCA_MIE_MSIE) ) {
+        __asm__ volatile ("csrc mie, %0" :: "r"(HCA_MIE_MSIE) : "memory");
+    }
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_arbiter_init(void)
+{
+    if ( _hca_arbiter_ready &&
+         (_hca_arbiter_owner != HCA_ARBITER_NO_OWNER) ) {
+        return -EBUSY;
+    }
+
+    if ( metal_lock_init(&_hca_arbiter_lock) ) {
+        return -ENOTSUP;
+    }
+
+    _hca_arbiter_owner = HCA_ARBITER_NO_OWNER;
+    _hca_arbiter_head = 0u;
+    _hca_arbiter_tail = 0u;
+    for (unsigned int ix=0; ix<HCA_ARBITER_MAX_HARTS; ix++) {
+        _hca_arbiter_granted[ix] = false;
+    }
+    _hca_arbiter_ready = true;
+
+    return 0;
+}
+
+int
+hca_arbiter_fini(void)
+{
+    if ( ! _hca_arbiter_ready ) {
+        return 0;
+    }
+
+    unsigned long mstatus = _hca_arbiter_lock_take();
+    int rc = 0;
+    if ( (_hca_arbiter_owner != HCA_ARBITER_NO_OWNER) ||
+         (_hca_arbiter_head != _hca_arbiter_tail) ) {
+        rc = -EBUSY;
+    } else {
+        _hca_arbiter_ready = false;
+    }
+    _hca_arbiter_lock_give(mstatus);
+
+    return rc;
+}
+
+int
+hca_arbiter_acquire(void)
+{
+    int hartid = metal_cpu_get_current_hartid();
+
+    if ( ! _hca_arbiter_ready || (hartid >= HCA_ARBITER_MAX_HARTS) ) {
+        return -ENODEV;
+    }
+
+    unsigned long mstatus = _hca_arbiter_lock_take();
+
+    if ( _hca_arbiter_owner == hartid ) {
+        _hca_arbiter_lock_give(mstatus);
+        return -EDEADLK;
+    }
+
+    if ( _hca_arbiter_owner == HCA_ARBITER_NO_OWNER ) {
+        // ownership is handed over on release, so there is no pending
+        // request whenever the HCA is not owned
+        _hca_arbiter_owner = hartid;
+        _hca_arbiter_lock_give(mstatus);
+        return 0;
+    }
+
+    _hca_arbiter_granted[hartid] = false;
+    _hca_arbiter_waiters[_hca_arbiter_tail % HCA_ARBITER_MAX_HARTS] = hartid;
+    _hca_arbiter_tail += 1u;
+
+    // keep interrupts masked while sleeping
+    metal_lock_give(&_hca_arbiter_lock);
+    _hca_arbiter_wait(hartid);
+    _hca_irq_restore(mstatus);
+
+    return 0;
+}
+
+int
+hca_arbiter_try_acquire(void)
+{
+    int hartid = metal_cpu_get_current_hartid();
+
+    if ( ! _hca_arbiter_ready || (hartid >= HCA_ARBITER_MAX_HARTS) ) {
+        return -ENODEV;
+    }
+
+    unsigned long mstatus = _hca_arbiter_lock_take();
+    int rc = 0;
+    if ( _hca_arbiter_owner == hartid ) {
+        rc = -EDEADLK;
+    } else if ( _hca_arbiter_owner != HCA_ARBITER_NO_OWNER ) {
+        rc = -EBUSY;
+    } else {
+        _hca_arbiter_owner = hartid;
+    }
+    _hca_arbiter_lock_give(mstatus);
+
+    return rc;
+}
+
+int
+hca_arbiter_release(void)
+{
+    int hartid = metal_cpu_get_current_hartid();
+
+    if ( ! _hca_arbiter_ready ) {
+        return -ENODEV;
+    }
+
+    unsigned long mstatus = _hca_arbiter_lock_take();
+
+    if ( _hca_arbiter_owner != hartid ) {
+        _hca_arbiter_lock_give(mstatus);
+        return -EPERM;
+    }
+
+    if ( _hca_arbiter_head != _hca_arbiter_tail ) {
+        int next =
+            _hca_arbiter_waiters[_hca_arbiter_head % HCA_ARBITER_MAX_HARTS];
+        _hca_arbiter_head += 1u;
+        _hca_arbiter_owner = next;
+        _hca_arbiter_granted[next] = true;
+        // the engine registers written by the previous owner should be
+        // visible before the next owner is woken up
+        __asm__ volatile ("fence iorw, iorw" ::: "memory");
+        hca_ipi_signal(next, true);
+    } else {
+        _hca_arbiter_owner = HCA_ARBITER_NO_OWNER;
+    }
+
+    _hca_arbiter_lock_give(mstatus);
+
+    return 0;
+}
+
+int
+hca_arbiter_owner(void)
+{
+    return _hca_arbiter_owner;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file drbg.c
+ * @brief HCA crypto engine driver: AES-128 CTR_DRBG (NIST SP 800-90A)
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "hca/drbg.h"
+#include "hca/trng.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define HCA_DRBG_KEY_SIZE  16u   // bytes
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+/**
+ * Build a seed material, i.e. XOR an optional entropy input with an input
+ * string padded w/ zeroes.
+ */
+static void
+_hca_drbg_seed_material(uint8_t * seed, const uint8_t * entropy,
+                        const uint8_t * str, size_t str_len)
+{
+    if ( entropy ) {
+        memcpy(seed, entropy, HCA_DRBG_SEED_SIZE);
+    } else {
+        memset(seed, 0, HCA_DRBG_SEED_SIZE);
+    }
+    for (unsigned int ix=0; ix<str_len; ix++) {
+        seed[ix] ^= str[ix];
+    }
+}
+
+static void
+_hca_drbg_ctr_inc(uint8_t * ctr)
+{
+    for (unsigned int ix=HCA_AES_BLOCK_SIZE; ix--; ) {
+        if ( ++ctr[ix] ) {
+            break;
+        }
+    }
+}
+
+/**
+ * CTR_DRBG_Update: derive a new key and counter block from the next two
+ * key stream blocks, XORed w/ the provided data.
+ */
+static int
+_hca_drbg_update(struct hca_drbg * dr, const uint8_t * data)
+{
+    uint32_t temp[HCA_DRBG_SEED_SIZE/sizeof(uint32_t)];
+
+    int rc = hca_aes_ctr(&dr->dr_aes, (uint8_t *)temp, data,
+                         HCA_DRBG_SEED_SIZE, dr->dr_ctr);
+    if ( ! rc ) {
+        const uint8_t * bytes = (const uint8_t *)temp;
+        rc = hca_aes_init(&dr->dr_aes, bytes, HCA_DRBG_KEY_SIZE);
+        memcpy(dr->dr_ctr, &bytes[HCA_DRBG_KEY_SIZE], HCA_AES_BLOCK_SIZE);
+        _hca_drbg_ctr_inc(dr->dr_ctr);
+    }
+    memset(temp, 0, sizeof(temp));
+
+    if ( rc ) {
+        // state is no longer consistent, force a reseed on next request
+        dr->dr_reseed_counter = HCA_DRBG_RESEED_INTERVAL + 1u;
+    }
+
+    return rc;
+}
+
+static int
+_hca_drbg_reseed(struct hca_drbg * dr, const uint8_t * entropy,
+                 const uint8_t * add, size_t add_len)
+{
+    uint8_t seed[HCA_DRBG_SEED_SIZE];
+
+    int rc = 0;
+    if ( ! entropy ) {
+        rc = hca_getrandom(seed, sizeof(seed));
+        entropy = seed;
+    }
+    if ( ! rc ) {
+        _hca_drbg_seed_material(seed, entropy, add, add_len);
+        rc = _hca_drbg_update(dr, seed);
+    }
+    memset(seed, 0, sizeof(seed));
+
+    if ( ! rc ) {
+        dr->dr_reseed_counter = 1u;
+    }
+
+    return rc;
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_drbg_init(struct hca_drbg * dr, const uint8_t * entropy,
+              const uint8_t * pers, size_t pers_len)
+{
+    if ( ! dr || (pers_len && ! pers) || (pers_len > HCA_DRBG_SEED_SIZE) ) {
+        return -EINVAL;
+    }
+
+    static const uint8_t zero_key[HCA_DRBG_KEY_SIZE];
+
+    int rc = hca_aes_init(&dr->dr_aes, zero_key, sizeof(zero_key));
+    if ( rc ) {
+        return rc;
+    }
+    memset(dr->dr_ctr, 0, sizeof(dr->dr_ctr));
+    _hca_drbg_ctr_inc(dr->dr_ctr);
+
+    return _hca_drbg_reseed(dr, entropy, pers, pers_len);
+}
+
+int
+hca_drbg_reseed(struct hca_drbg * dr, const uint8_t * entropy,
+                const uint8_t * add, size_t add_len)
+{
+    if ( ! dr || (add_len && ! add) || (add_len > HCA_DRBG_SEED_SIZE) ) {
+        return -EINVAL;
+    }
+
+    return _hca_drbg_reseed(dr, entropy, add, add_len);
+}
+
+int
+hca_drbg_generate(struct hca_drbg * dr, uint8_t * out, size_t length,
+                  const uint8_t * add, size_t add_len)
+{
+    if ( ! dr || ! out || (length > HCA_DRBG_MAX_REQUEST) ) {
+        return -EINVAL;
+    }
+
+    if ( (add_len && ! add) || (add_len > HCA_DRBG_SEED_SIZE) ) {
+        return -EINVAL;
+    }
+
+    uint8_t data[HCA_DRBG_SEED_SIZE];
+    int rc;
+
+    if ( dr->dr_reseed_counter > HCA_DRBG_RESEED_INTERVAL ) {
+        // additional input is consumed by the reseed
+        rc = _hca_drbg_reseed(dr, NULL, add, add_len);
+        if ( rc ) {
+            return rc;
+        }
+        add_len = 0;
+    }
+
+    _hca_drbg_seed_material(data, NULL, add, add_len);
+
+    if ( add_len ) {
+        rc = _hca_drbg_update(dr, data);
+        if ( rc ) {
+            return rc;
+        }
+    }
+
+    // key stream only: encrypt zeroes, using as many counter blocks as
+    // needed in a single request
+    memset(out, 0, length);
+    rc = hca_aes_ctr(&dr->dr_aes, out, out, length, dr->dr_ctr);
+    if ( rc ) {
+        memset(out, 0, length);
+        dr->dr_reseed_counter = HCA_DRBG_RESEED_INTERVAL + 1u;
+        return rc;
+    }
+
+    rc = _hca_drbg_update(dr, data);
+    if ( rc ) {
+        // do not deliver an output whose state has not been refreshed
+        memset(out, 0, length);
+        return rc;
+    }
+
+    dr->dr_reseed_counter += 1u;
+
+    return 0;
+}
+
+void
+hca_drbg_fini(struct hca_drbg * dr)
+{
+    if ( dr ) {
+        memset(dr, 0, sizeof(*dr));
+    }
+}
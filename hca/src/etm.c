@@ -0,0 +1,176 @@
+/**
+ * @file etm.c
+ * @brief HCA crypto engine driver: chained AES and SHA (encrypt-then-MAC)
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "hca/etm.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+/**
+ * Submit a job, sleeping until the queue has room for it.
+ */
+static int
+_hca_etm_submit(struct hca_queue * hq, const struct hca_job * job)
+{
+    for(;;) {
+        int rc = hca_queue_submit(hq, job);
+        if ( rc != -EAGAIN ) {
+            return rc;
+        }
+        _hca_queue_wait_room(hq);
+    }
+}
+
+/**
+ * Queue alternating AES and SHA jobs, segment by segment, and wait for
+ * their completion.
+ *
+ * The ciphertext is hashed once the AES engine has written it when
+ * encrypting, and before it is overwritten when decrypting in place.
+ */
+static int
+_hca_etm_run(struct hca_etm * em, enum hca_aes_process proc, uint8_t * dst,
+             const uint8_t * src, size_t length, uint8_t * iv)
+{
+    if ( ! em || ! dst || ! src || ! iv ) {
+        return -EINVAL;
+    }
+
+    if ( (length & (HCA_AES_BLOCK_SIZE - 1u)) ||
+         ! HCA_IS_DMA_ALIGNED(dst) || ! HCA_IS_DMA_ALIGNED(src) ) {
+        return -EINVAL;
+    }
+
+    if ( ! length ) {
+        return 0;
+    }
+
+    struct hca_queue * hq = em->em_queue;
+    if ( hq->hq_running ) {
+        return -EBUSY;
+    }
+
+    // the last ciphertext block is the next CBC IV, which is overwritten
+    // if decrypting in place
+    uint8_t last[HCA_AES_BLOCK_SIZE];
+    if ( proc == HCA_AES_DECRYPT ) {
+        memcpy(last, &src[length - HCA_AES_BLOCK_SIZE], sizeof(last));
+    }
+
+    int rc = _hca_sha_chain_start(em->em_sha);
+    if ( rc ) {
+        return rc;
+    }
+
+    rc = _hca_aes_chain_setup(em->em_aes, em->em_mode, proc, iv);
+    if ( rc ) {
+        // nothing has been hashed, give the SHA engine back if it was
+        // acquired for this request
+        _hca_sha_chain_done(em->em_sha, 0u, 0);
+        return rc;
+    }
+
+    const uint8_t * cipher = (proc == HCA_AES_DECRYPT) ? src : dst;
+    size_t hashed = 0;
+    for (size_t pos=0; ! rc && (pos<length); pos+=em->em_segment) {
+        size_t size = MIN(em->em_segment, length - pos);
+        size_t count = size / HCA_DMA_BLOCK_SIZE;
+        struct hca_job aes_job = {
+            .hj_src = &src[pos],
+            .hj_dst = &dst[pos],
+            .hj_count = count,
+            .hj_target = HCA_JOB_AES,
+        };
+        struct hca_job sha_job = {
+            .hj_src = &cipher[pos],
+            .hj_dst = NULL,
+            .hj_count = count,
+            .hj_target = HCA_JOB_SHA,
+        };
+        if ( proc == HCA_AES_DECRYPT ) {
+            rc = _hca_etm_submit(hq, &sha_job);
+            if ( ! rc ) {
+                hashed += size;
+                rc = _hca_etm_submit(hq, &aes_job);
+            }
+        } else {
+            rc = _hca_etm_submit(hq, &aes_job);
+            if ( ! rc ) {
+                rc = _hca_etm_submit(hq, &sha_job);
+            }
+            if ( ! rc ) {
+                hashed += size;
+            }
+        }
+    }
+
+    // wait for the submitted jobs, even on error
+    int xrc = hca_queue_wait(hq);
+    if ( ! rc ) {
+        rc = xrc;
+    }
+
+    // the message is only lost if part of it has been sent to the engine
+    _hca_sha_chain_done(em->em_sha, hashed, hashed ? rc : 0);
+    if ( rc ) {
+        return rc;
+    }
+
+    _hca_aes_wait();
+
+    if ( proc != HCA_AES_DECRYPT ) {
+        memcpy(last, &dst[length - HCA_AES_BLOCK_SIZE], sizeof(last));
+    }
+    _hca_aes_chain_next_iv(em->em_mode, iv, last,
+                           length / HCA_AES_BLOCK_SIZE);
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_etm_init(struct hca_etm * em, struct hca_queue * hq,
+             struct hca_aes_session * as, enum hca_aes_mode mode,
+             struct hca_sha_session * ss)
+{
+    if ( ! em || ! hq || ! as || ! ss ) {
+        return -EINVAL;
+    }
+
+    if ( (mode != HCA_AES_CBC) && (mode != HCA_AES_CTR) ) {
+        return -EINVAL;
+    }
+
+    em->em_queue = hq;
+    em->em_aes = as;
+    em->em_sha = ss;
+    em->em_mode = mode;
+    em->em_segment = HCA_ETM_SEGMENT_SIZE;
+
+    return 0;
+}
+
+int
+hca_etm_encrypt(struct hca_etm * em, uint8_t * dst, const uint8_t * src,
+                size_t length, uint8_t * iv)
+{
+    return _hca_etm_run(em, HCA_AES_ENCRYPT, dst, src, length, iv);
+}
+
+int
+hca_etm_decrypt(struct hca_etm * em, uint8_t * dst, const uint8_t * src,
+                size_t length, uint8_t * iv)
+{
+    return _hca_etm_run(em, HCA_AES_DECRYPT, dst, src, length, iv);
+}
@@ -0,0 +1,527 @@
+/**
+ * @file hca.c
+ * @brief HCA crypto engine driver: common implementation
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <limits.h>
+#include <metal/cache.h>
+#include <metal/cpu.h>
+#include <metal/machine.h>
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define HCA_IRQ_PRIORITY 2
+
+#define HCA_FIFO_WORD_SIZE (sizeof(hca_fifo_word_t))
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+#if __riscv_xlen >= 64
+# define HCA_FIFO_IN_WORD  METAL_REG64(HCA_BASE, METAL_SIFIVE_HCA_FIFO_IN)
+# define HCA_FIFO_OUT_WORD METAL_REG64(HCA_BASE, METAL_SIFIVE_HCA_FIFO_OUT)
+#else // __riscv_xlen >= 64
+# define HCA_FIFO_IN_WORD  METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_FIFO_IN)
+# define HCA_FIFO_OUT_WORD METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_FIFO_OUT)
+#endif // __riscv_xlen < 64
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** Widest FIFO access */
+#if __riscv_xlen >= 64
+typedef uint64_t hca_fifo_word_t;
+#else // __riscv_xlen >= 64
+typedef uint32_t hca_fifo_word_t;
+#endif // __riscv_xlen < 64
+
+/** Shadow of the configuration registers */
+struct hca_cfg_shadow {
+    uint32_t cs_values[HCA_CFG_COUNT];  /**< Configuration fields */
+    uint32_t cs_known;   /**< Registers whose fields are cached */
+    uint32_t cs_clean;   /**< Registers which match their cached fields */
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+/** Register offsets of the shadowed registers */
+static const uint32_t _hca_cfg_regs[HCA_CFG_COUNT] = {
+    [HCA_CFG_CR] = METAL_SIFIVE_HCA_CR,
+    [HCA_CFG_AES_CR] = METAL_SIFIVE_HCA_AES_CR,
+    [HCA_CFG_SHA_CR] = METAL_SIFIVE_HCA_SHA_CR,
+};
+
+/** Configuration fields of the shadowed registers */
+static const uint32_t _hca_cfg_fields[HCA_CFG_COUNT] = {
+    [HCA_CFG_CR] =
+        (HCA_REGISTER_CR_IFIFOTGT_MASK << HCA_REGISTER_CR_IFIFOTGT_OFFSET) |
+        (HCA_REGISTER_CR_ENDIANNESS_MASK <<
+         HCA_REGISTER_CR_ENDIANNESS_OFFSET) |
+        (HCA_REGISTER_CR_CRYPTODIE_MASK <<
+         HCA_REGISTER_CR_CRYPTODIE_OFFSET) |
+        (HCA_REGISTER_CR_OFIFOIE_MASK << HCA_REGISTER_CR_OFIFOIE_OFFSET) |
+        (HCA_REGISTER_CR_DMADIE_MASK << HCA_REGISTER_CR_DMADIE_OFFSET),
+    [HCA_CFG_AES_CR] =
+        (HCA_REGISTER_AES_CR_MODE_MASK << HCA_REGISTER_AES_CR_MODE_OFFSET) |
+        (HCA_REGISTER_AES_CR_KEYSZ_MASK << HCA_REGISTER_AES_CR_KEYSZ_OFFSET) |
+        (HCA_REGISTER_AES_CR_PROCESS_MASK <<
+         HCA_REGISTER_AES_CR_PROCESS_OFFSET) |
+        (HCA_REGISTER_AES_CR_DTYPE_MASK << HCA_REGISTER_AES_CR_DTYPE_OFFSET) |
+        (HCA_REGISTER_AES_CR_CCMT_MASK << HCA_REGISTER_AES_CR_CCMT_OFFSET) |
+        (HCA_REGISTER_AES_CR_CCMQ_MASK << HCA_REGISTER_AES_CR_CCMQ_OFFSET),
+    [HCA_CFG_SHA_CR] =
+        (HCA_REGISTER_SHA_CR_MODE_MASK << HCA_REGISTER_SHA_CR_MODE_OFFSET),
+};
+
+// like the other driver globals, e.g. the SHA engine owner or the loaded
+// AES key, the shadow is not protected against concurrent use: harts which
+// share the HCA should only call the driver while they own it, see
+// #hca_arbiter_acquire
+static struct hca_cfg_shadow _hca_cfg;
+
+/** Destination of the current DMA transfer, to discard on completion */
+static uint8_t * _hca_dma_dst;
+static size_t _hca_dma_size;
+
+/** Hart the ASD IRQ is routed to, -1 if no handler is attached */
+static int _hca_asd_hart = -1;
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+/**
+ * Push the first bytes of a word, less than a FIFO word.
+ */
+static void
+_hca_fifo_in_push_tail(hca_fifo_word_t word, size_t length)
+{
+    #if __riscv_xlen >= 64
+    if ( length >= sizeof(uint32_t) ) {
+        METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_FIFO_IN) = (uint32_t)word;
+        word >>= 32u;
+        length -= sizeof(uint32_t);
+    }
+    #endif // __riscv_xlen >= 64
+    if ( length >= sizeof(uint16_t) ) {
+        METAL_REG16(HCA_BASE, METAL_SIFIVE_HCA_FIFO_IN) = (uint16_t)word;
+        word >>= 16u;
+        length -= sizeof(uint16_t);
+    }
+    if ( length ) {
+        METAL_REG8(HCA_BASE, METAL_SIFIVE_HCA_FIFO_IN) = (uint8_t)word;
+    }
+}
+
+/**
+ * Pop less than a FIFO word, using the widest access the alignment of the
+ * destination buffer permits.
+ */
+static void
+_hca_fifo_out_pop_tail(uint8_t * dst, size_t length)
+{
+    const uint8_t * end = dst+length;
+    while ( dst < end ) {
+        if ( ! (((uintptr_t)dst) & (sizeof(uint32_t)-1u)) &&
+                (length >= sizeof(uint32_t))) {
+            *(uint32_t *)dst =
+                METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_FIFO_OUT);
+            dst += sizeof(uint32_t);
+            length -= sizeof(uint32_t);
+            continue;
+        }
+        if ( ! (((uintptr_t)dst) & (sizeof(uint16_t)-1u)) &&
+                (length >= sizeof(uint16_t))) {
+            *(uint16_t *)dst =
+                METAL_REG16(HCA_BASE, METAL_SIFIVE_HCA_FIFO_OUT);
+            dst += sizeof(uint16_t);
+            length -= sizeof(uint16_t);
+            continue;
+        }
+        *dst = METAL_REG8(HCA_BASE, METAL_SIFIVE_HCA_FIFO_OUT);
+        dst += sizeof(uint8_t);
+        length -= sizeof(uint8_t);
+    }
+}
+
+static bool
+_hca_dma_is_done(void)
+{
+    return ! _hca_dma_is_busy();
+}
+
+static inline void
+_hca_store_bytes(uint8_t * dst, hca_fifo_word_t word, size_t count)
+{
+    while ( count-- ) {
+        *dst++ = (uint8_t)word;
+        word >>= CHAR_BIT;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Internal API
+//-----------------------------------------------------------------------------
+
+void
+_hca_fifo_retarget(enum hca_fifo_target target)
+{
+    uint32_t cr = _hca_cfg_value(HCA_CFG_CR);
+    uint32_t current = (cr >> HCA_REGISTER_CR_IFIFOTGT_OFFSET) &
+                       HCA_REGISTER_CR_IFIFOTGT_MASK;
+
+    if ( (current != HCA_FIFO_TARGET_SHA) ||
+         (target == HCA_FIFO_TARGET_SHA) ) {
+        return;
+    }
+
+    // at most a FIFO worth of blocks is left, hence a short wait
+    while ( ! _hca_fifo_in_is_empty() || _hca_sha_is_busy() ) {
+        // busy loop
+    }
+}
+
+void
+_hca_setup(enum hca_fifo_target target)
+{
+    _hca_fifo_retarget(target);
+
+    // natural FIFO order, no IRQ on crypto done, or output FIFO not empty;
+    // IRQ on DMA done while a handler acknowledges it, see _hca_dma_wait
+    uint32_t irqs = (_hca_asd_hart >= 0) ? HCA_CR_DMA_IRQ_ENABLE_BIT : 0u;
+    _hca_cfg_write(HCA_CFG_CR, _hca_cr_config(target, irqs));
+}
+
+void
+_hca_cfg_invalidate(void)
+{
+    _hca_cfg.cs_known = 0u;
+    _hca_cfg.cs_clean = 0u;
+}
+
+uint32_t
+_hca_cfg_value(enum hca_cfg_reg reg)
+{
+    uint32_t bit = 1u << reg;
+    if ( ! (_hca_cfg.cs_known & bit) ) {
+        _hca_cfg.cs_values[reg] =
+            METAL_REG32(HCA_BASE, _hca_cfg_regs[reg]) & _hca_cfg_fields[reg];
+        _hca_cfg.cs_known |= bit;
+    }
+
+    return _hca_cfg.cs_values[reg];
+}
+
+void
+_hca_cfg_write(enum hca_cfg_reg reg, uint32_t value)
+{
+    uint32_t bit = 1u << reg;
+    if ( (_hca_cfg.cs_clean & bit) && (_hca_cfg.cs_values[reg] == value) ) {
+        return;
+    }
+
+    METAL_REG32(HCA_BASE, _hca_cfg_regs[reg]) = value;
+    _hca_cfg.cs_values[reg] = value;
+    _hca_cfg.cs_known |= bit;
+    _hca_cfg.cs_clean |= bit;
+}
+
+void
+_hca_cfg_update(enum hca_cfg_reg reg, uint32_t value, size_t offset,
+                uint32_t mask)
+{
+    uint32_t fields = _hca_cfg_value(reg);
+    fields &= ~(mask << offset);
+    fields |= ((value & mask) << offset);
+    _hca_cfg_write(reg, fields);
+}
+
+void
+_hca_cfg_trigger(enum hca_cfg_reg reg, uint32_t value, uint32_t action)
+{
+    uint32_t bit = 1u << reg;
+
+    METAL_REG32(HCA_BASE, _hca_cfg_regs[reg]) = value | action;
+    _hca_cfg.cs_values[reg] = value;
+    _hca_cfg.cs_known |= bit;
+    // the register may still report the action bits
+    _hca_cfg.cs_clean &= ~bit;
+}
+
+void
+_hca_build_desc(struct hca_buf_desc * desc, const uint8_t * src,
+                size_t length)
+{
+    size_t unaligned_size = (uintptr_t)src & (HCA_DMA_ALIGNMENT - 1u);
+
+    desc->bd_prolog = src;
+    desc->bd_prolog_len = 0u;
+    if ( unaligned_size ) {
+        desc->bd_prolog_len = MIN(HCA_DMA_ALIGNMENT - unaligned_size, length);
+        src += desc->bd_prolog_len;
+        length -= desc->bd_prolog_len;
+    }
+
+    desc->bd_main = src;
+    desc->bd_main_count = length / HCA_DMA_BLOCK_SIZE;
+    size_t main_length = desc->bd_main_count * HCA_DMA_BLOCK_SIZE;
+    src += main_length;
+    length -= main_length;
+
+    desc->bd_epilog = src;
+    desc->bd_epilog_len = length;
+}
+
+void
+_hca_fifo_in_push(const uint8_t * src, size_t length)
+{
+    if ( ! length ) {
+        return;
+    }
+
+    size_t misalign = ((uintptr_t)src) & (HCA_FIFO_WORD_SIZE-1u);
+    // only load the words which contain at least one byte of the buffer, so
+    // that no access goes beyond its protection granule
+    const hca_fifo_word_t * words =
+        (const hca_fifo_word_t *)(src - misalign);
+
+    if ( ! misalign ) {
+        for (; length >= HCA_FIFO_WORD_SIZE; length -= HCA_FIFO_WORD_SIZE) {
+            HCA_FIFO_IN_WORD = *words++;
+        }
+        if ( length ) {
+            _hca_fifo_in_push_tail(*words, length);
+        }
+        return;
+    }
+
+    // merge two consecutive aligned words into each FIFO word
+    size_t rshift = misalign * CHAR_BIT;
+    size_t lshift = HCA_FIFO_WORD_SIZE * CHAR_BIT - rshift;
+    size_t avail = HCA_FIFO_WORD_SIZE - misalign;
+    hca_fifo_word_t word = *words++ >> rshift;
+    for (; length >= HCA_FIFO_WORD_SIZE; length -= HCA_FIFO_WORD_SIZE) {
+        hca_fifo_word_t next = *words++;
+        HCA_FIFO_IN_WORD = word | (next << lshift);
+        word = next >> rshift;
+    }
+    if ( length > avail ) {
+        word |= *words << lshift;
+    }
+    if ( length ) {
+        _hca_fifo_in_push_tail(word, length);
+    }
+}
+
+void
+_hca_fifo_out_pop(uint8_t * dst, size_t length)
+{
+    size_t misalign = ((uintptr_t)dst) & (HCA_FIFO_WORD_SIZE-1u);
+
+    if ( misalign && (length >= HCA_FIFO_WORD_SIZE) ) {
+        // split each FIFO word across two consecutive aligned words; only
+        // the bytes of the buffer are written, hence the byte stores at
+        // both ends
+        size_t head = HCA_FIFO_WORD_SIZE - misalign;
+        hca_fifo_word_t word = HCA_FIFO_OUT_WORD;
+        length -= HCA_FIFO_WORD_SIZE;
+        _hca_store_bytes(dst, word, head);
+        hca_fifo_word_t carry = word >> (head * CHAR_BIT);
+        hca_fifo_word_t * words = (hca_fifo_word_t *)(dst + head);
+        for (; length >= HCA_FIFO_WORD_SIZE; length -= HCA_FIFO_WORD_SIZE) {
+            word = HCA_FIFO_OUT_WORD;
+            *words++ = carry | (word << (misalign * CHAR_BIT));
+            carry = word >> (head * CHAR_BIT);
+        }
+        dst = (uint8_t *)words;
+        _hca_store_bytes(dst, carry, misalign);
+        dst += misalign;
+    } else if ( ! misalign ) {
+        hca_fifo_word_t * words = (hca_fifo_word_t *)dst;
+        for (; length >= HCA_FIFO_WORD_SIZE; length -= HCA_FIFO_WORD_SIZE) {
+            *words++ = HCA_FIFO_OUT_WORD;
+        }
+        dst = (uint8_t *)words;
+    }
+
+    // less than a FIFO word: do not pop more bytes than requested
+    _hca_fifo_out_pop_tail(dst, length);
+}
+
+void
+_hca_dma_start(uint8_t * dst, const uint8_t * src, size_t count)
+{
+    int hartid = metal_cpu_get_current_hartid();
+    size_t size = count*HCA_DMA_BLOCK_SIZE;
+
+    // the DMA reads from memory: write back any pending source data, and
+    // make sure no dirty destination line is evicted over the DMA output
+    metal_dcache_l1_flush_range(hartid, (uintptr_t)src, size);
+    if ( dst ) {
+        metal_dcache_l1_discard_range(hartid, (uintptr_t)dst, size);
+    }
+    _hca_dma_dst = dst;
+    _hca_dma_size = size;
+
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_DMA_SRC) = (uintptr_t)src;
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_DMA_DEST) = (uintptr_t)dst;
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_DMA_LEN) = (uint32_t)count;
+
+    // DMA start
+    _hca_updreg32(METAL_SIFIVE_HCA_DMA_CR, 1u,
+                  HCA_REGISTER_DMA_CR_START_OFFSET,
+                  HCA_REGISTER_DMA_CR_START_MASK);
+}
+
+int
+_hca_dma_wait(void)
+{
+    if ( (_hca_asd_hart == (int)metal_cpu_get_current_hartid()) &&
+         (_hca_cfg_value(HCA_CFG_CR) & HCA_CR_DMA_IRQ_ENABLE_BIT) ) {
+        // the attached handler acknowledges the DMA done IRQ, which wakes
+        // the hart up
+        _hca_irq_wait(&_hca_dma_is_done);
+    } else {
+        while ( _hca_dma_is_busy() ) {
+            // busy loop
+        }
+    }
+
+    // drop the destination lines the CPU may have speculatively reloaded,
+    // edge lines included: they were written back on start, and should not
+    // be written to during the transfer
+    if ( _hca_dma_dst ) {
+        metal_dcache_l1_invalidate_range(metal_cpu_get_current_hartid(),
+                                         (uintptr_t)_hca_dma_dst,
+                                         _hca_dma_size);
+        _hca_dma_dst = NULL;
+    }
+
+    uint32_t dma_cr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_DMA_CR);
+    if ( dma_cr & HCA_DMA_CR_ERROR_BITS ) {
+        // as there is not HCA reset for now, invalidate the FIFOs so that
+        // the next request does not start with stale data
+        uint32_t cr = _hca_cfg_value(HCA_CFG_CR);
+        _hca_cfg_trigger(HCA_CFG_CR, cr,
+                         HCA_REGISTER_CR_INVLDFIFOS_MASK <<
+                         HCA_REGISTER_CR_INVLDFIFOS_OFFSET);
+        _hca_cfg_write(HCA_CFG_CR, cr);
+        return -EIO;
+    }
+
+    return 0;
+}
+
+int
+_hca_dma_run(uint8_t * dst, const uint8_t * src, size_t count)
+{
+    _hca_dma_start(dst, src, count);
+
+    return _hca_dma_wait();
+}
+
+static struct metal_interrupt *
+_hca_irq_plic(void)
+{
+    return metal_interrupt_get_controller(METAL_PLIC_CONTROLLER, 0);
+}
+
+int
+_hca_irq_attach(unsigned int channel, metal_interrupt_handler_t handler,
+                void * opaque)
+{
+    struct metal_cpu * cpu = metal_cpu_get(metal_cpu_get_current_hartid());
+    struct metal_interrupt * cpu_intr = cpu ?
+        metal_cpu_interrupt_controller(cpu) : NULL;
+    struct metal_interrupt * plic = _hca_irq_plic();
+    if ( ! cpu_intr || ! plic ) {
+        return -ENODEV;
+    }
+
+    metal_interrupt_init(cpu_intr);
+    metal_interrupt_init(plic);
+
+    if ( metal_interrupt_register_handler(plic, (int)channel, handler,
+                                          opaque) ) {
+        return -ENODEV;
+    }
+
+    metal_interrupt_set_threshold(plic, 1);
+    metal_interrupt_set_priority(plic, (int)channel, HCA_IRQ_PRIORITY);
+    if ( metal_interrupt_enable(plic, (int)channel) ) {
+        return -ENODEV;
+    }
+    metal_interrupt_enable(cpu_intr, 0);
+
+    if ( channel == HCA_ASD_IRQ_CHANNEL ) {
+        _hca_asd_hart = (int)metal_cpu_get_current_hartid();
+    }
+
+    return 0;
+}
+
+void
+_hca_irq_detach(unsigned int channel)
+{
+    struct metal_interrupt * plic = _hca_irq_plic();
+    if ( plic ) {
+        metal_interrupt_disable(plic, (int)channel);
+    }
+
+    if ( channel == HCA_ASD_IRQ_CHANNEL ) {
+        _hca_asd_hart = -1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_init(void)
+{
+    if ( ! METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_HCA_REV) ) {
+        return -ENODEV;
+    }
+
+    if ( _hca_dma_is_busy() || _hca_aes_is_busy() || _hca_sha_is_busy() ) {
+        return -EBUSY;
+    }
+
+    // the registers may have been programmed outside of this driver
+    _hca_cfg_invalidate();
+    _hca_aes_key_invalidate();
+
+    return 0;
+}
+
+void
+hca_ipi_signal(int hartid, bool enable)
+{
+    uintptr_t msip_base;
+
+    #ifdef __METAL_DT_RISCV_CLINT0_HANDLE
+    msip_base = __metal_driver_sifive_clint0_control_base(
+        __METAL_DT_RISCV_CLINT0_HANDLE);
+    msip_base += METAL_RISCV_CLINT0_MSIP_BASE;
+    #elif defined(__METAL_DT_RISCV_CLIC0_HANDLE)
+    msip_base = __metal_driver_sifive_clic0_control_base(
+        __METAL_DT_RISCV_CLIC0_HANDLE);
+    msip_base += METAL_RISCV_CLIC0_MSIP_BASE;
+    #else
+    # error "MSIP not available"
+    #endif
+
+    // there is no Metal API to set, only to get
+    METAL_REG32(msip_base, ((unsigned int)hartid) << 2u) = enable ? 1u : 0u;
+}
@@ -0,0 +1,521 @@
+/**
+ * @file hca_priv.h
+ * @brief HCA crypto engine driver: private definitions
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#ifndef HCA_PRIV_H
+#define HCA_PRIV_H
+
+#include <errno.h>
+#include <metal/interrupt.h>
+#include "hca/hca.h"
+#include "hca/aes.h"
+#include "hca/sha.h"
+#include "hca/sifive_hca-0.5.x.h"
+#include "hca/hca_macro.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#ifdef SIFIVE_HCA_0_5_X_H
+// this does not exist in HCA v0.5, but we do need it to recover from
+// explicitly invalid requests, so QEMU v0.5 does support it
+#define HCA_REGISTER_CR_INVLDFIFOS_OFFSET 6u
+#define HCA_REGISTER_CR_INVLDFIFOS_MASK   1u
+#endif // SIFIVE_HCA_0_5_X_H
+
+// alias
+#define METAL_SIFIVE_HCA_FIFO_OUT (METAL_SIFIVE_HCA_AES_OUT)
+
+/** Input FIFO targets */
+enum hca_fifo_target {
+    HCA_FIFO_TARGET_AES = 0u,
+    HCA_FIFO_TARGET_SHA = 1u,
+};
+
+/** Shadowed configuration registers */
+enum hca_cfg_reg {
+    HCA_CFG_CR,
+    HCA_CFG_AES_CR,
+    HCA_CFG_SHA_CR,
+    HCA_CFG_COUNT,
+};
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+#ifndef METAL_REG16
+# define METAL_REG16(base, offset) \
+    (__METAL_ACCESS_ONCE((uint16_t *)((base) + (offset))))
+#endif
+
+#ifndef METAL_REG8
+# define METAL_REG8(base, offset) \
+    (__METAL_ACCESS_ONCE((uint8_t *)((base) + (offset))))
+#endif
+
+#define HCA_DMA_CR_ERROR_BITS                    \
+    ((HCA_REGISTER_DMA_CR_RDALIGNERR_MASK <<     \
+        HCA_REGISTER_DMA_CR_RDALIGNERR_OFFSET) | \
+     (HCA_REGISTER_DMA_CR_WRALIGNERR_MASK <<     \
+        HCA_REGISTER_DMA_CR_WRALIGNERR_OFFSET) | \
+     (HCA_REGISTER_DMA_CR_RESPERR_MASK <<        \
+        HCA_REGISTER_DMA_CR_RESPERR_OFFSET) |    \
+     (HCA_REGISTER_DMA_CR_LEGALERR_MASK <<       \
+        HCA_REGISTER_DMA_CR_LEGALERR_OFFSET))
+
+#define HCA_CR_IFIFO_EMPTY_BIT \
+    (HCA_REGISTER_CR_IFIFOEMPTY_MASK << HCA_REGISTER_CR_IFIFOEMPTY_OFFSET)
+#define HCA_CR_OFIFO_EMPTY_BIT \
+    (HCA_REGISTER_CR_OFIFOEMPTY_MASK << HCA_REGISTER_CR_OFIFOEMPTY_OFFSET)
+#define HCA_CR_IFIFO_FULL_BIT \
+    (HCA_REGISTER_CR_IFIFOFULL_MASK << HCA_REGISTER_CR_IFIFOFULL_OFFSET)
+#define HCA_CR_OFIFO_FULL_BIT \
+    (HCA_REGISTER_CR_OFIFOFULL_MASK << HCA_REGISTER_CR_OFIFOFULL_OFFSET)
+
+#define HCA_CR_DMA_DONE_BIT \
+    (HCA_REGISTER_CR_DMADIS_MASK << HCA_REGISTER_CR_DMADIS_OFFSET)
+#define HCA_CR_CRYPTO_DONE_BIT \
+    (HCA_REGISTER_CR_CRYPTODIS_MASK << HCA_REGISTER_CR_CRYPTODIS_OFFSET)
+#define HCA_CR_OFIFO_IRQ_BIT \
+    (HCA_REGISTER_CR_OFIFOIS_MASK << HCA_REGISTER_CR_OFIFOIS_OFFSET)
+#define HCA_CR_DMA_IRQ_ENABLE_BIT \
+    (HCA_REGISTER_CR_DMADIE_MASK << HCA_REGISTER_CR_DMADIE_OFFSET)
+/** Write-1-to-clear status bits of the CR register */
+#define HCA_CR_IRQ_STATUS_BITS \
+    (HCA_CR_DMA_DONE_BIT | HCA_CR_CRYPTO_DONE_BIT | HCA_CR_OFIFO_IRQ_BIT)
+
+/** Largest DMA request, in DMA blocks */
+#define HCA_DMA_MAX_COUNT (HCA_REGISTER_DMA_LEN_LEN_MASK)
+
+/** Machine interrupt enable bit of mstatus */
+#define HCA_MSTATUS_MIE   (1u << 3u)
+
+/** Machine software interrupt enable bit of mie */
+#define HCA_MIE_MSIE      (1u << 3u)
+
+#define HCA_IS_DMA_ALIGNED(_p_) \
+    (!(((uintptr_t)(_p_)) & (HCA_DMA_ALIGNMENT - 1u)))
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(_a_) (sizeof((_a_))/sizeof((_a_)[0]))
+#endif // ARRAY_SIZE
+
+#ifndef MIN
+# define MIN(_a_, _b_) ((_a_) < (_b_) ? (_a_) : (_b_))
+#endif // MIN
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+struct hca_queue;
+
+/** A buffer split into a CPU-fed head, a DMA-fed body and a CPU-fed tail */
+struct hca_buf_desc {
+    const uint8_t * bd_prolog;  /**< Non-aligned start bytes */
+    size_t bd_prolog_len;       /**< Size in bytes */
+    const uint8_t * bd_main;    /**< DMA-aligned payload */
+    size_t bd_main_count;       /**< Size in DMA block count */
+    const uint8_t * bd_epilog;  /**< Non-aligned end bytes */
+    size_t bd_epilog_len;       /**< Size in bytes */
+};
+
+//-----------------------------------------------------------------------------
+// Internal API
+//-----------------------------------------------------------------------------
+
+/**
+ * Wait for the SHA engine to consume the input FIFO before it is retargeted.
+ *
+ * DMA done, or the end of a CPU push, only tells the input FIFO has been
+ * filled: the last blocks of a SHA request may still be queued, and would
+ * be fed to the AES engine. An AES request does not need this, as it only
+ * completes once the output blocks have been read.
+ *
+ * @param target the next input FIFO target
+ */
+void _hca_fifo_retarget(enum hca_fifo_target target);
+
+/**
+ * Configure the global HCA control register for a new request.
+ *
+ * The input FIFO is drained first, see #_hca_fifo_retarget.
+ *
+ * @param target the input FIFO target
+ */
+void _hca_setup(enum hca_fifo_target target);
+
+/**
+ * Forget the shadowed configuration registers, so that the next
+ * configuration is written whatever the cached values.
+ */
+void _hca_cfg_invalidate(void);
+
+/**
+ * Retrieve the configuration fields of a register.
+ *
+ * The register is only read if its shadow is not known yet.
+ *
+ * @param reg the register
+ * @return the configuration fields, w/o any status or action bit
+ */
+uint32_t _hca_cfg_value(enum hca_cfg_reg reg);
+
+/**
+ * Write all the configuration fields of a register w/ a single store.
+ *
+ * The store is skipped if the register already holds these fields.
+ *
+ * @param reg the register
+ * @param value the configuration fields
+ */
+void _hca_cfg_write(enum hca_cfg_reg reg, uint32_t value);
+
+/**
+ * Update a single configuration field of a register, w/o reading it back.
+ *
+ * @param reg the register
+ * @param value the field value
+ * @param offset the field offset
+ * @param mask the field mask
+ */
+void _hca_cfg_update(enum hca_cfg_reg reg, uint32_t value, size_t offset,
+                     uint32_t mask);
+
+/**
+ * Write the configuration fields of a register along w/ action bits, e.g.
+ * an engine init request, w/ a single store.
+ *
+ * The store is never skipped, nor is the next configuration write.
+ *
+ * @param reg the register
+ * @param value the configuration fields
+ * @param action the action bits
+ */
+void _hca_cfg_trigger(enum hca_cfg_reg reg, uint32_t value, uint32_t action);
+
+/**
+ * Forget which key is loaded into the AES engine, so that the next AES
+ * request reloads its key.
+ */
+void _hca_aes_key_invalidate(void);
+
+/**
+ * Configure the AES engine for an ECB, CBC or CTR request whose blocks are
+ * fed by the caller, e.g. w/ queued DMA jobs, and restart the chaining from
+ * an IV.
+ *
+ * @param as the AES session
+ * @param mode the mode, either HCA_AES_ECB, HCA_AES_CBC or HCA_AES_CTR
+ * @param proc the processing direction, ignored in CTR mode
+ * @param iv the CBC IV or CTR counter block, ignored in ECB mode
+ * @return 0 on success, -EBUSY if the AES engine or the DMA is in use
+ */
+int _hca_aes_chain_setup(const struct hca_aes_session * as,
+                         enum hca_aes_mode mode, enum hca_aes_process proc,
+                         const uint8_t * iv);
+
+/**
+ * Update the IV once a chained request is complete.
+ *
+ * @param mode the chaining mode, either HCA_AES_CBC or HCA_AES_CTR
+ * @param iv the CBC IV or CTR counter block, updated
+ * @param last the last ciphertext block of the request, used in CBC mode
+ * @param count the count of processed AES blocks, used in CTR mode
+ */
+void _hca_aes_chain_next_iv(enum hca_aes_mode mode, uint8_t * iv,
+                            const uint8_t * last, size_t count);
+
+/**
+ * Start or resume the hash of a session whose message chunks are fed by the
+ * caller, e.g. w/ queued DMA jobs.
+ *
+ * @param ss the SHA session, which should not hold any carry bytes
+ * @return 0 on success, -EINVAL if the session holds carry bytes, -EBUSY if
+ *         the engine is used by another session, -EIO on DMA error
+ */
+int _hca_sha_chain_start(struct hca_sha_session * ss);
+
+/**
+ * Account for the message bytes hashed by a chained request.
+ *
+ * The SHA engine is released if the session message is still empty, e.g.
+ * when the request failed before any job was queued.
+ *
+ * @param ss the SHA session
+ * @param length the count of hashed bytes
+ * @param rc the completion status of the request; on error, the message is
+ *           dropped
+ */
+void _hca_sha_chain_done(struct hca_sha_session * ss, size_t length, int rc);
+
+/**
+ * Append the SHA-2 padding to a message.
+ *
+ * @param mode the SHA-2 flavour
+ * @param ptr the end of the message, w/ room for up to two blocks
+ * @param length the length of the whole message, in bytes
+ * @return the count of padding bytes
+ */
+size_t _hca_sha_pad_msg(enum hca_sha_mode mode, uint8_t * ptr,
+                        uint64_t length);
+
+/**
+ * Hash a message which is already padded, w/ a single DMA request.
+ *
+ * @param ss the SHA session, which should not have a message in progress
+ * @param hash the output digest buffer, no alignment constraint
+ * @param src the padded message, DMA-aligned
+ * @param count the length of the padded message, in DMA blocks
+ * @return 0 on success, -EBUSY if the engine is used or the session has a
+ *         message in progress, -EIO on DMA error
+ */
+int _hca_sha_digest_padded(struct hca_sha_session * ss, uint8_t * hash,
+                           const uint8_t * src, size_t count);
+
+/**
+ * Split a buffer into its prolog, DMA main part and epilog.
+ *
+ * @param desc the descriptor to fill in
+ * @param src the buffer
+ * @param length the length of the buffer, in bytes
+ */
+void _hca_build_desc(struct hca_buf_desc * desc, const uint8_t * src,
+                     size_t length);
+
+/**
+ * Push bytes into the input FIFO.
+ *
+ * Whatever the alignment of the source buffer, bytes are merged into full
+ * XLEN-wide FIFO words; only the last bytes, if any, are pushed w/ narrower
+ * accesses.
+ */
+void _hca_fifo_in_push(const uint8_t * src, size_t length);
+
+/**
+ * Pop bytes from the output FIFO.
+ *
+ * Whatever the alignment of the destination buffer, bytes are popped as
+ * full XLEN-wide FIFO words; only the last bytes, if any, are popped w/
+ * narrower accesses.
+ */
+void _hca_fifo_out_pop(uint8_t * dst, size_t length);
+
+/**
+ * Start a DMA transfer, w/o waiting for its completion.
+ *
+ * The source buffer is flushed from, and the destination buffer discarded
+ * from the L1 data cache of the current hart; the destination lines,
+ * including the edge lines shared w/ other data, are invalidated again on
+ * completion, see #_hca_dma_wait. Data sharing a cache line w/ the
+ * destination buffer should not be written to during the transfer.
+ *
+ * @param dst the destination buffer, or NULL to only feed the input FIFO
+ * @param src the source buffer, should be DMA-aligned
+ * @param count the count of DMA blocks to transfer
+ */
+void _hca_dma_start(uint8_t * dst, const uint8_t * src, size_t count);
+
+/**
+ * Wait for the completion of the current DMA transfer.
+ *
+ * While a handler is attached to the ASD IRQ, the DMA done IRQ is enabled
+ * and the hart the IRQ is routed to sleeps until the transfer completes;
+ * other harts poll.
+ *
+ * @return 0 on success, -EIO on DMA error
+ */
+int _hca_dma_wait(void);
+
+/**
+ * Run a DMA transfer and wait for its completion.
+ *
+ * @param dst the destination buffer, or NULL to only feed the input FIFO
+ * @param src the source buffer, should be DMA-aligned
+ * @param count the count of DMA blocks to transfer
+ * @return 0 on success, -EIO on DMA error
+ */
+int _hca_dma_run(uint8_t * dst, const uint8_t * src, size_t count);
+
+/**
+ * Route an HCA interrupt line to a handler, and enable machine external
+ * interrupts on the current hart.
+ *
+ * A handler attached to the ASD IRQ should acknowledge the DMA done IRQ of
+ * any request, see #_hca_dma_wait.
+ *
+ * @param channel the PLIC channel of the HCA interrupt
+ * @param handler the handler to call
+ * @param opaque the handler argument
+ * @return 0 on success, -ENODEV if the interrupt cannot be routed
+ */
+int _hca_irq_attach(unsigned int channel, metal_interrupt_handler_t handler,
+                    void * opaque);
+
+/**
+ * Stop routing an HCA interrupt line.
+ *
+ * @param channel the PLIC channel of the HCA interrupt
+ */
+void _hca_irq_detach(unsigned int channel);
+
+/**
+ * Sleep until a job queue has room for another job.
+ *
+ * @param hq the queue
+ */
+void _hca_queue_wait_room(struct hca_queue * hq);
+
+//-----------------------------------------------------------------------------
+// Inline helpers
+//-----------------------------------------------------------------------------
+
+static inline void
+_hca_updreg32(uint32_t reg, uint32_t value, size_t offset, uint32_t mask)
+{
+    uint32_t reg32;
+    reg32 = METAL_REG32(HCA_BASE, reg);
+    reg32 &= ~(mask << offset);
+    reg32 |= ((value & mask) << offset);
+    METAL_REG32(HCA_BASE, reg) = reg32;
+}
+
+/**
+ * Build the configuration fields of the HCA control register: natural FIFO
+ * order, and the given IRQ enable bits.
+ */
+static inline uint32_t
+_hca_cr_config(enum hca_fifo_target target, uint32_t irqs)
+{
+    return (((uint32_t)target & HCA_REGISTER_CR_IFIFOTGT_MASK) <<
+            HCA_REGISTER_CR_IFIFOTGT_OFFSET) |
+           (HCA_REGISTER_CR_ENDIANNESS_MASK <<
+            HCA_REGISTER_CR_ENDIANNESS_OFFSET) |
+           irqs;
+}
+
+static inline bool
+_hca_aes_is_busy(void)
+{
+    uint32_t aes_cr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_AES_CR);
+    return !! (aes_cr & (HCA_REGISTER_AES_CR_BUSY_MASK <<
+                         HCA_REGISTER_AES_CR_BUSY_OFFSET));
+}
+
+static inline bool
+_hca_sha_is_busy(void)
+{
+    uint32_t sha_cr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_SHA_CR);
+    return !! (sha_cr & (HCA_REGISTER_SHA_CR_BUSY_MASK <<
+                         HCA_REGISTER_SHA_CR_BUSY_OFFSET));
+}
+
+static inline bool
+_hca_dma_is_busy(void)
+{
+    uint32_t dma_cr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_DMA_CR);
+    return !! (dma_cr & (HCA_REGISTER_DMA_CR_BUSY_MASK <<
+                         HCA_REGISTER_DMA_CR_BUSY_OFFSET));
+}
+
+static inline bool
+_hca_fifo_in_is_empty(void)
+{
+    uint32_t hca_cr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_CR);
+    return !!(hca_cr & HCA_CR_IFIFO_EMPTY_BIT);
+}
+
+static inline bool
+_hca_fifo_out_is_empty(void)
+{
+    uint32_t hca_cr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_CR);
+    return !!(hca_cr & HCA_CR_OFIFO_EMPTY_BIT);
+}
+
+/**
+ * Mask machine interrupts.
+ *
+ * @return the previous mstatus, to give back to #_hca_irq_restore
+ */
+static inline unsigned long
+_hca_irq_save(void)
+{
+    unsigned long mstatus;
+    __asm__ volatile ("csrrc %0, mstatus, %1" : "=r"(mstatus)
+                      : "r"(HCA_MSTATUS_MIE) : "memory");
+    return mstatus;
+}
+
+static inline void
+_hca_irq_restore(unsigned long mstatus)
+{
+    if ( mstatus & HCA_MSTATUS_MIE ) {
+        __asm__ volatile ("csrs mstatus, %0" :: "r"(HCA_MSTATUS_MIE)
+                          : "memory");
+    }
+}
+
+/**
+ * Sleep until a condition signalled by an HCA IRQ holds.
+ *
+ * Machine interrupts are masked while the condition is checked and until
+ * WFI is executed. WFI still resumes on a pending interrupt even w/ MIE
+ * clear, and the ISR runs as soon as MIE is restored, so an IRQ raised
+ * between the check and WFI cannot be missed. Called w/ MIE clear, e.g.
+ * from an ISR, this is a busy loop.
+ *
+ * @param done the completion condition, the IRQ should be raised once it
+ *             holds
+ */
+static inline void
+_hca_irq_wait(bool (* done)(void))
+{
+    for(;;) {
+        unsigned long mstatus = _hca_irq_save();
+        bool ok = done();
+        if ( ! ok && (mstatus & HCA_MSTATUS_MIE) ) {
+            __asm__ volatile ("wfi");
+        }
+        _hca_irq_restore(mstatus);
+        if ( ok ) {
+            return;
+        }
+    }
+}
+
+static inline bool
+_hca_sha_is_512(enum hca_sha_mode mode)
+{
+    return (mode == HCA_SHA384) || (mode == HCA_SHA512);
+}
+
+static inline size_t
+_hca_sha_block_size(enum hca_sha_mode mode)
+{
+    return _hca_sha_is_512(mode) ? HCA_SHA512_BLOCK_SIZE :
+                                   HCA_SHA256_BLOCK_SIZE;
+}
+
+static inline void
+_hca_aes_wait(void)
+{
+    while ( _hca_aes_is_busy() ) {
+        // busy loop
+    }
+}
+
+static inline void
+_hca_sha_wait(void)
+{
+    while ( _hca_sha_is_busy() ) {
+        // busy loop
+    }
+}
+
+#endif // HCA_PRIV_H
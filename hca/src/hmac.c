@@ -0,0 +1,128 @@
+/**
+ * @file hmac.c
+ * @brief HCA crypto engine driver: HMAC w/ SHA-2
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "hca/hmac.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define HCA_HMAC_IPAD    0x36u
+#define HCA_HMAC_OPAD    0x5Cu
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+/**
+ * Compute the inner digest straight into the outer message.
+ */
+static int
+_hca_hmac_inner(struct hca_hmac * hm, const uint8_t * src, size_t length)
+{
+    struct hca_sha_session * ss = &hm->hm_sha;
+    size_t block_size = hm->hm_block_size;
+    uint8_t * hash = &hm->hm_outer[block_size];
+
+    if ( length <= HCA_HMAC_INLINE_SIZE ) {
+        // key block, message and padding are sent as a single request
+        uint8_t * msg = &hm->hm_inner[block_size];
+        memcpy(msg, src, length);
+        size_t pad = _hca_sha_pad_msg(ss->ss_mode, &msg[length],
+                                      block_size + length);
+        size_t count = (block_size + length + pad) / HCA_DMA_BLOCK_SIZE;
+        return _hca_sha_digest_padded(ss, hash, hm->hm_inner, count);
+    }
+
+    // the key block fills whole DMA blocks: it is sent w/o any carry
+    int rc = hca_sha_update(ss, hm->hm_inner, block_size);
+    if ( ! rc ) {
+        rc = hca_sha_update(ss, src, length);
+    }
+    if ( ! rc ) {
+        rc = hca_sha_final(ss, hash, HCA_SHA_MAX_DIGEST_SIZE);
+    }
+    if ( rc ) {
+        // do not leave a partial message in the session
+        (void)hca_sha_init(ss, ss->ss_mode);
+    }
+
+    return rc;
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_hmac_init(struct hca_hmac * hm, enum hca_sha_mode mode,
+              const uint8_t * key, size_t key_len)
+{
+    if ( ! hm || (! key && key_len) ) {
+        return -EINVAL;
+    }
+
+    int rc = hca_sha_init(&hm->hm_sha, mode);
+    if ( rc ) {
+        return rc;
+    }
+
+    size_t block_size = _hca_sha_block_size(mode);
+    size_t hash_len = hca_sha_digest_size(mode);
+    uint8_t key_hash[HCA_SHA_MAX_DIGEST_SIZE];
+
+    if ( key_len > block_size ) {
+        rc = hca_sha_digest(&hm->hm_sha, key_hash, sizeof(key_hash), key,
+                            key_len);
+        if ( rc ) {
+            return rc;
+        }
+        key = key_hash;
+        key_len = hash_len;
+    }
+
+    uint8_t * ipad = hm->hm_inner;
+    uint8_t * opad = hm->hm_outer;
+    for (unsigned int ix=0; ix<block_size; ix++) {
+        uint8_t kb = (ix < key_len) ? key[ix] : 0u;
+        ipad[ix] = kb ^ HCA_HMAC_IPAD;
+        opad[ix] = kb ^ HCA_HMAC_OPAD;
+    }
+    memset(key_hash, 0, sizeof(key_hash));
+
+    // the outer message length never changes, neither does its padding
+    (void)_hca_sha_pad_msg(mode, &opad[block_size + hash_len],
+                           block_size + hash_len);
+
+    hm->hm_block_size = block_size;
+
+    return 0;
+}
+
+int
+hca_hmac_digest(struct hca_hmac * hm, uint8_t * mac, size_t mac_len,
+                const uint8_t * src, size_t length)
+{
+    if ( ! hm || ! mac || (! src && length) ) {
+        return -EINVAL;
+    }
+
+    if ( mac_len < hca_sha_digest_size(hm->hm_sha.ss_mode) ) {
+        return -EINVAL;
+    }
+
+    int rc = _hca_hmac_inner(hm, src, length);
+    if ( rc ) {
+        return rc;
+    }
+
+    return _hca_sha_digest_padded(&hm->hm_sha, mac, hm->hm_outer,
+                                  2u*hm->hm_block_size/HCA_DMA_BLOCK_SIZE);
+}
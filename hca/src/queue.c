@@ -0,0 +1,458 @@
+/**
+ * @file queue.c
+ * @brief HCA crypto engine driver: DMA job queue
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <limits.h>
+#include <metal/cache.h>
+#include <metal/cpu.h>
+#include <metal/lock.h>
+#include "hca/queue.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+/** Queue the HCA IRQ is routed to */
+static struct hca_queue * _hca_queue;
+
+/** Serializes the ISR w/ the harts which submit or wait from other harts */
+METAL_LOCK_DECLARE(_hca_queue_lock);
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+/**
+ * Take the queue lock, w/ machine interrupts masked.
+ *
+ * @return the previous mstatus, to give back to #_hca_queue_lock_give
+ */
+static unsigned long
+_hca_queue_lock_take(void)
+{
+    unsigned long mstatus = _hca_irq_save();
+    metal_lock_take(&_hca_queue_lock);
+    return mstatus;
+}
+
+static void
+_hca_queue_lock_give(unsigned long mstatus)
+{
+    metal_lock_give(&_hca_queue_lock);
+    _hca_irq_restore(mstatus);
+}
+
+/**
+ * Signal a job completion to the harts waiting on the queue.
+ *
+ * Called w/ the queue lock held. The hart the HCA IRQ is routed to is
+ * woken up by the IRQ itself, and never registers as a waiter.
+ */
+static void
+_hca_queue_notify(struct hca_queue * hq)
+{
+    unsigned long waiters = hq->hq_waiters;
+    for (int hartid=0; waiters; hartid++, waiters >>= 1u) {
+        if ( waiters & 1u ) {
+            hca_ipi_signal(hartid, true);
+        }
+    }
+}
+
+static bool
+_hca_queue_is_done(const struct hca_queue * hq, bool room)
+{
+    if ( room ) {
+        return (hq->hq_tail - hq->hq_head) < hq->hq_size;
+    }
+    return ! hq->hq_running;
+}
+
+/**
+ * Sleep until the queue is idle, or until it has room for another job.
+ *
+ * The hart the HCA IRQ is routed to sleeps on the IRQ itself. Any other
+ * hart registers as a waiter and sleeps w/ machine interrupts masked until
+ * the ISR raises its software interrupt (IPI), which is cleared w/o ever
+ * being taken, as w/ the arbiter.
+ */
+static void
+_hca_queue_sleep(struct hca_queue * hq, bool room)
+{
+    int hartid = (int)metal_cpu_get_current_hartid();
+
+    if ( hartid == hq->hq_hart ) {
+        for(;;) {
+            // check and sleep w/ the IRQ masked: a pending IRQ resumes WFI
+            // and is taken once interrupts are restored, so it cannot be
+            // missed
+            unsigned long mstatus = _hca_irq_save();
+            if ( _hca_queue_is_done(hq, room) ) {
+                _hca_irq_restore(mstatus);
+                break;
+            }
+            __asm__ volatile ("wfi");
+            _hca_irq_restore(mstatus);
+        }
+        return;
+    }
+
+    unsigned long mstatus = _hca_queue_lock_take();
+
+    if ( hartid >= (int)(sizeof(hq->hq_waiters)*CHAR_BIT) ) {
+        // cannot be tracked as a waiter
+        while ( ! _hca_queue_is_done(hq, room) ) {
+            metal_lock_give(&_hca_queue_lock);
+            metal_lock_take(&_hca_queue_lock);
+        }
+        _hca_queue_lock_give(mstatus);
+        return;
+    }
+
+    unsigned long mie;
+    __asm__ volatile ("csrrs %0, mie, %1" : "=r"(mie)
+                      : "r"(HCA_MIE_MSIE) : "memory");
+    hq->hq_waiters |= 1ul << hartid;
+
+    while ( ! _hca_queue_is_done(hq, room) ) {
+        metal_lock_give(&_hca_queue_lock);
+        __asm__ volatile ("wfi");
+        // the ISR raises the IPI w/ the lock held, after it updates the
+        // queue: once cleared w/ the lock held, the IPI cannot be missed
+        metal_lock_take(&_hca_queue_lock);
+        hca_ipi_signal(hartid, false);
+    }
+
+    hq->hq_waiters &= ~(1ul << hartid);
+    hca_ipi_signal(hartid, false);
+    _hca_queue_lock_give(mstatus);
+
+    if ( ! (mie & HCA_MIE_MSIE) ) {
+        __asm__ volatile ("csrc mie, %0" :: "r"(HCA_MIE_MSIE) : "memory");
+    }
+}
+
+/**
+ * Discard the destination of completed jobs from the L1 data cache of the
+ * current hart, up to a job index.
+ *
+ * The ISR only maintains the cache of the hart the HCA IRQ is routed to:
+ * called w/ the queue lock held, from any other hart.
+ */
+static void
+_hca_queue_sync(struct hca_queue * hq, size_t end)
+{
+    int hartid = (int)metal_cpu_get_current_hartid();
+
+    for (; hq->hq_synced != end; hq->hq_synced += 1u) {
+        const struct hca_job * job =
+            &hq->hq_jobs[hq->hq_synced & (hq->hq_size-1u)];
+        if ( job->hj_dst ) {
+            size_t size = job->hj_count*HCA_DMA_BLOCK_SIZE;
+            metal_dcache_l1_invalidate_range(hartid, (uintptr_t)job->hj_dst,
+                                             size);
+        }
+    }
+}
+
+/**
+ * Start the next segment of the head job.
+ *
+ * Called w/ the queue lock held.
+ */
+static void
+_hca_queue_start(struct hca_queue * hq)
+{
+    const struct hca_job * job = &hq->hq_jobs[hq->hq_head & (hq->hq_size-1u)];
+    size_t offset = hq->hq_offset * HCA_DMA_BLOCK_SIZE;
+    size_t count = MIN(job->hj_count - hq->hq_offset, HCA_DMA_MAX_COUNT);
+
+    _hca_fifo_retarget((enum hca_fifo_target)job->hj_target);
+
+    // FIFO target and DMA done IRQ; no DMA is running, so a DMA done status
+    // left over by a polled request may be cleared w/ the same store
+    _hca_cfg_trigger(HCA_CFG_CR,
+                     _hca_cr_config((enum hca_fifo_target)job->hj_target,
+                                    HCA_CR_DMA_IRQ_ENABLE_BIT),
+                     HCA_CR_DMA_DONE_BIT);
+
+    hq->hq_segment = count;
+    hq->hq_running = true;
+
+    _hca_dma_start(job->hj_dst ? &job->hj_dst[offset] : NULL,
+                   &job->hj_src[offset], count);
+}
+
+/**
+ * Complete the running segment, and start the next one if any.
+ *
+ * Called w/ the queue lock held.
+ *
+ * @return true if a job completed or the queue stopped
+ */
+static bool
+_hca_queue_advance(struct hca_queue * hq)
+{
+    int rc = _hca_dma_wait();
+    if ( rc ) {
+        // drop the pending jobs
+        hq->hq_error = rc;
+        hq->hq_head = hq->hq_tail;
+        hq->hq_offset = 0u;
+        hq->hq_running = false;
+        return true;
+    }
+
+    const struct hca_job * job = &hq->hq_jobs[hq->hq_head & (hq->hq_size-1u)];
+    hq->hq_offset += hq->hq_segment;
+    if ( hq->hq_offset < job->hj_count ) {
+        _hca_queue_start(hq);
+        return false;
+    }
+
+    hq->hq_offset = 0u;
+    hq->hq_head += 1u;
+    hq->hq_done += 1u;
+
+    if ( hq->hq_head != hq->hq_tail ) {
+        _hca_queue_start(hq);
+    } else {
+        hq->hq_running = false;
+    }
+
+    return true;
+}
+
+static void
+_hca_queue_irq_handler(int id, void * opaque)
+{
+    struct hca_queue * hq = (struct hca_queue *)opaque;
+
+    (void)id;
+
+    uint32_t cr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_CR);
+    if ( ! (cr & HCA_CR_DMA_DONE_BIT) ) {
+        return;
+    }
+
+    // acknowledge the DMA done IRQ only
+    cr &= ~HCA_CR_IRQ_STATUS_BITS;
+    METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_CR) = cr | HCA_CR_DMA_DONE_BIT;
+
+    // machine interrupts are already masked
+    metal_lock_take(&_hca_queue_lock);
+    if ( hq->hq_running && _hca_queue_advance(hq) ) {
+        _hca_queue_notify(hq);
+    }
+    metal_lock_give(&_hca_queue_lock);
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_queue_init(struct hca_queue * hq, struct hca_job * jobs, size_t size)
+{
+    if ( ! hq || ! jobs || ! size || (size & (size - 1u)) ) {
+        return -EINVAL;
+    }
+
+    if ( _hca_queue ) {
+        return -EBUSY;
+    }
+
+    if ( metal_lock_init(&_hca_queue_lock) ) {
+        return -ENOTSUP;
+    }
+
+    hq->hq_jobs = jobs;
+    hq->hq_size = size;
+    hq->hq_head = 0u;
+    hq->hq_tail = 0u;
+    hq->hq_offset = 0u;
+    hq->hq_segment = 0u;
+    hq->hq_done = 0u;
+    hq->hq_error = 0;
+    hq->hq_running = false;
+    hq->hq_synced = 0u;
+    hq->hq_waiters = 0u;
+    hq->hq_hart = (int)metal_cpu_get_current_hartid();
+
+    int rc = _hca_irq_attach(HCA_ASD_IRQ_CHANNEL, &_hca_queue_irq_handler,
+                             hq);
+    if ( rc ) {
+        return rc;
+    }
+
+    _hca_queue = hq;
+
+    return 0;
+}
+
+int
+hca_queue_fini(struct hca_queue * hq)
+{
+    if ( ! hq || (hq != _hca_queue) ) {
+        return -EINVAL;
+    }
+
+    int rc = hca_queue_wait(hq);
+
+    _hca_irq_detach(HCA_ASD_IRQ_CHANNEL);
+    _hca_cfg_update(HCA_CFG_CR, 0,
+                    HCA_REGISTER_CR_DMADIE_OFFSET,
+                    HCA_REGISTER_CR_DMADIE_MASK);
+
+    _hca_queue = NULL;
+
+    return rc;
+}
+
+int
+hca_queue_submit(struct hca_queue * hq, const struct hca_job * job)
+{
+    if ( ! hq || ! job || (hq != _hca_queue) ) {
+        return -EINVAL;
+    }
+
+    if ( ! job->hj_count || ! HCA_IS_DMA_ALIGNED(job->hj_src) ||
+         ! HCA_IS_DMA_ALIGNED(job->hj_dst) ) {
+        return -EINVAL;
+    }
+
+    int hartid = (int)metal_cpu_get_current_hartid();
+    bool remote = hartid != hq->hq_hart;
+    size_t size = job->hj_count*HCA_DMA_BLOCK_SIZE;
+
+    if ( remote ) {
+        // the ISR only maintains the cache of its own hart: write back the
+        // source, and drop any destination line which could be evicted over
+        // the DMA output
+        metal_dcache_l1_flush_range(hartid, (uintptr_t)job->hj_src, size);
+        if ( job->hj_dst ) {
+            metal_dcache_l1_discard_range(hartid, (uintptr_t)job->hj_dst,
+                                          size);
+        }
+    }
+
+    // the ISR may complete the last job and go idle concurrently, possibly
+    // on another hart
+    unsigned long mstatus = _hca_queue_lock_take();
+    int rc = 0;
+    if ( hq->hq_error ) {
+        rc = hq->hq_error;
+    } else if ( (hq->hq_tail - hq->hq_head) >= hq->hq_size ) {
+        rc = -EAGAIN;
+    } else if ( ! hq->hq_running && _hca_dma_is_busy() ) {
+        // another driver path uses the DMA
+        rc = -EBUSY;
+    } else {
+        if ( (hq->hq_tail - hq->hq_synced) >= hq->hq_size ) {
+            // the slot holds a completed job, which is about to be forgotten
+            size_t end = hq->hq_tail - hq->hq_size + 1u;
+            if ( remote ) {
+                _hca_queue_sync(hq, end);
+            } else {
+                hq->hq_synced = end;
+            }
+        }
+        hq->hq_jobs[hq->hq_tail & (hq->hq_size-1u)] = *job;
+        hq->hq_tail += 1u;
+        if ( ! hq->hq_running ) {
+            _hca_queue_start(hq);
+        }
+    }
+    _hca_queue_lock_give(mstatus);
+
+    return rc;
+}
+
+int
+hca_queue_wait(struct hca_queue * hq)
+{
+    if ( ! hq ) {
+        return -EINVAL;
+    }
+
+    _hca_queue_sleep(hq, false);
+
+    if ( (int)metal_cpu_get_current_hartid() != hq->hq_hart ) {
+        // drop the destination lines this hart may have reloaded meanwhile
+        unsigned long mstatus = _hca_queue_lock_take();
+        _hca_queue_sync(hq, hq->hq_head);
+        _hca_queue_lock_give(mstatus);
+    }
+
+    return hq->hq_error;
+}
+
+int
+hca_queue_aes_setup(struct hca_queue * hq,
+                    const struct hca_aes_session * as,
+                    enum hca_aes_mode mode, enum hca_aes_process proc,
+                    const uint8_t * iv)
+{
+    if ( ! hq || ! as || (hq != _hca_queue) ) {
+        return -EINVAL;
+    }
+
+    if ( mode == HCA_AES_GCM ) {
+        // GCM phases are driven by the CPU
+        return -ENOTSUP;
+    }
+
+    if ( (mode != HCA_AES_ECB) && ! iv ) {
+        return -EINVAL;
+    }
+
+    if ( hq->hq_head != hq->hq_tail ) {
+        // the engine would be reconfigured under pending jobs
+        return -EBUSY;
+    }
+
+    return _hca_aes_chain_setup(as, mode, proc, iv);
+}
+
+int
+hca_queue_sha_start(struct hca_queue * hq, struct hca_sha_session * ss)
+{
+    if ( ! hq || ! ss || (hq != _hca_queue) ) {
+        return -EINVAL;
+    }
+
+    if ( hq->hq_head != hq->hq_tail ) {
+        return -EBUSY;
+    }
+
+    return _hca_sha_chain_start(ss);
+}
+
+int
+hca_queue_sha_done(struct hca_queue * hq, struct hca_sha_session * ss,
+                   size_t length)
+{
+    if ( ! hq || ! ss || (hq != _hca_queue) ) {
+        return -EINVAL;
+    }
+
+    int rc = hq->hq_error;
+    _hca_sha_chain_done(ss, length, rc);
+
+    return rc;
+}
+
+//-----------------------------------------------------------------------------
+// Internal API
+//-----------------------------------------------------------------------------
+
+void
+_hca_queue_wait_room(struct hca_queue * hq)
+{
+    _hca_queue_sleep(hq, true);
+}
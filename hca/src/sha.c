@@ -0,0 +1,735 @@
+/**
+ * @file sha.c
+ * @brief HCA crypto engine driver: SHA-2 hashing
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <metal/cpu.h>
+#include "hca/sha.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+#define HCA_SHA_CR_INIT_BIT \
+    (HCA_REGISTER_SHA_CR_INIT_MASK << HCA_REGISTER_SHA_CR_INIT_OFFSET)
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+/** Session whose hash is in progress in the SHA engine */
+static struct hca_sha_session * _hca_sha_owner;
+
+/** Per-mode length below which messages are hashed in software */
+static size_t _hca_sha_sw_threshold[] = {
+    HCA_SHA_SW_THRESHOLD, HCA_SHA_SW_THRESHOLD,
+    HCA_SHA_SW_THRESHOLD, HCA_SHA_SW_THRESHOLD,
+};
+
+/**
+ * Zeroed message for calibration, content does not change timings; aligned
+ * so that the HCA path is measured w/o a CPU-fed unaligned prolog
+ */
+static uint8_t _hca_sha_calib_msg[HCA_SHA_CALIBRATE_MAX] HCA_DMA_ALIGN;
+
+//-----------------------------------------------------------------------------
+// Inline helpers
+//-----------------------------------------------------------------------------
+
+static inline size_t
+_hca_sha_len_size(enum hca_sha_mode mode)
+{
+    return _hca_sha_is_512(mode) ? HCA_SHA512_LEN_SIZE : HCA_SHA256_LEN_SIZE;
+}
+
+/** Size of the internal state, i.e. the digest w/o truncation */
+static inline size_t
+_hca_sha_state_size(enum hca_sha_mode mode)
+{
+    return _hca_sha_is_512(mode) ? 512u/CHAR_BIT : 256u/CHAR_BIT;
+}
+
+/** Configuration fields of the SHA control register */
+static inline uint32_t
+_hca_sha_cr(enum hca_sha_mode mode)
+{
+    return ((uint32_t)mode & HCA_REGISTER_SHA_CR_MODE_MASK) <<
+           HCA_REGISTER_SHA_CR_MODE_OFFSET;
+}
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+static void
+_hca_sha_get_hash(uint8_t * hash, size_t length)
+{
+    // hash should be aligned, not checked here
+    #if __riscv_xlen >= 64
+    size_t size = length/sizeof(uint64_t);
+    uint64_t * ptr = (uint64_t *)hash;
+    #else
+    size_t size = length/sizeof(uint32_t);
+    uint32_t * ptr = (uint32_t *)hash;
+    #endif
+    for(unsigned int ix=0; ix<size; ix++) {
+        ptr[size - 1u - ix] =
+            #if __riscv_xlen >= 64
+            __builtin_bswap64(METAL_REG64(HCA_BASE,
+                              METAL_SIFIVE_HCA_HASH+ix*sizeof(uint64_t)));
+            #else
+            __builtin_bswap32(METAL_REG32(HCA_BASE,
+                              METAL_SIFIVE_HCA_HASH+ix*sizeof(uint32_t)));
+            #endif
+    }
+}
+
+static void
+_hca_sha_update_bit_len(uint8_t * eob, uint64_t length)
+{
+    const uint8_t *plen = (const uint8_t *)&length;
+    unsigned int count = sizeof(uint64_t);
+
+    while ( count-- ) {
+        *--eob = *plen++;
+    }
+}
+
+/**
+ * Count of padding bytes, including the 0x80 marker and the message length,
+ * which complete a message up to a block boundary.
+ */
+static size_t
+_hca_sha_pad_len(enum hca_sha_mode mode, uint64_t msg_size)
+{
+    size_t block_size = _hca_sha_block_size(mode);
+
+    size_t to_end = block_size - (size_t)(msg_size%block_size);
+    if ( to_end < _hca_sha_len_size(mode) + 1u ) {
+        to_end += block_size;
+    }
+
+    return to_end;
+}
+
+/**
+ * Append the SHA-2 padding to the carry bytes of the current trail buffer.
+ *
+ * The carry is first moved so that the bytes which do not fill a DMA block
+ * come first and the remaining of the trail starts on a DMA boundary. This
+ * enables to push the former from the CPU then to send the latter w/ DMA,
+ * w/o having to wait for the DMA completion in between.
+ *
+ * @param ss the session
+ * @param length updated with the length of the padded trail, in bytes
+ * @param head updated with the count of bytes to push from the CPU
+ * @return the start of the padded trail
+ */
+static const uint8_t *
+_hca_sha_pad(struct hca_sha_session * ss, size_t * length, size_t * head)
+{
+    uint64_t msg_size = ss->ss_length;
+    size_t to_end = _hca_sha_pad_len(ss->ss_mode, msg_size);
+
+    size_t trail_len = ss->ss_carry_len + to_end;
+    size_t rem = trail_len & (HCA_DMA_BLOCK_SIZE - 1u);
+    size_t offset = (HCA_DMA_ALIGNMENT - rem) & (HCA_DMA_ALIGNMENT - 1u);
+
+    uint8_t * trail = &ss->ss_trail[ss->ss_trail_ix][offset];
+    memmove(trail, ss->ss_trail[ss->ss_trail_ix], ss->ss_carry_len);
+
+    (void)_hca_sha_pad_msg(ss->ss_mode, &trail[ss->ss_carry_len], msg_size);
+
+    *length = trail_len;
+    *head = rem;
+
+    return trail;
+}
+
+static void
+_hca_sha_reset(struct hca_sha_session * ss)
+{
+    if ( _hca_sha_owner == ss ) {
+        _hca_sha_owner = NULL;
+    }
+    ss->ss_length = 0u;
+    ss->ss_hash = NULL;
+    ss->ss_carry_len = 0u;
+    ss->ss_started = false;
+    ss->ss_inflight = false;
+}
+
+/**
+ * Complete the on-going request of a session, if any, and store any pending
+ * digest.
+ */
+static int
+_hca_sha_sync(struct hca_sha_session * ss)
+{
+    int rc = 0;
+
+    if ( ss->ss_inflight ) {
+        rc = _hca_dma_wait();
+        ss->ss_inflight = false;
+    }
+
+    if ( rc ) {
+        // the current message cannot be recovered
+        _hca_sha_reset(ss);
+        return rc;
+    }
+
+    if ( ss->ss_hash ) {
+        _hca_sha_wait();
+
+        uint64_t state[HCA_SHA_MAX_DIGEST_SIZE/sizeof(uint64_t)];
+        _hca_sha_get_hash((uint8_t *)state,
+                          _hca_sha_state_size(ss->ss_mode));
+        memcpy(ss->ss_hash, state, hca_sha_digest_size(ss->ss_mode));
+        ss->ss_hash = NULL;
+
+        if ( ! ss->ss_started && (_hca_sha_owner == ss) ) {
+            _hca_sha_owner = NULL;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Complete the current request unless the session is pipelined.
+ */
+static inline int
+_hca_sha_done(struct hca_sha_session * ss)
+{
+    return ss->ss_pipeline ? 0 : _hca_sha_sync(ss);
+}
+
+/**
+ * Take ownership of the SHA engine once the previous request of the
+ * session is complete, starting a new hash on first use.
+ */
+static int
+_hca_sha_acquire(struct hca_sha_session * ss)
+{
+    if ( _hca_sha_owner && (_hca_sha_owner != ss) ) {
+        return -EBUSY;
+    }
+
+    int rc = _hca_sha_sync(ss);
+    if ( rc ) {
+        return rc;
+    }
+
+    if ( _hca_dma_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_setup(HCA_FIFO_TARGET_SHA);
+
+    if ( ! ss->ss_started ) {
+        if ( _hca_sha_is_busy() ) {
+            return -EBUSY;
+        }
+
+        // SHA mode and start
+        _hca_cfg_trigger(HCA_CFG_SHA_CR, _hca_sha_cr(ss->ss_mode),
+                         HCA_SHA_CR_INIT_BIT);
+
+        ss->ss_started = true;
+    }
+
+    _hca_sha_owner = ss;
+
+    return 0;
+}
+
+/**
+ * Start a DMA request from the SHA input FIFO.
+ */
+static inline void
+_hca_sha_dma_start(struct hca_sha_session * ss, const uint8_t * src,
+                   size_t count)
+{
+    _hca_dma_start(NULL, src, count);
+    ss->ss_inflight = true;
+}
+
+/**
+ * Measure the best time of a few digests of the same message, either in
+ * software or w/ the SHA engine.
+ */
+static int
+_hca_sha_measure(struct metal_cpu * cpu, struct hca_sha_session * ss,
+                 bool sw, size_t length, unsigned long long * cycles)
+{
+    uint8_t hash[HCA_SHA_MAX_DIGEST_SIZE];
+
+    *cycles = ~0ull;
+    for (unsigned int ix=0; ix<3u; ix++) {
+        unsigned long long start = metal_cpu_get_timer(cpu);
+        int rc;
+        if ( sw ) {
+            rc = hca_sha_sw_digest(ss->ss_mode, hash, sizeof(hash),
+                                   _hca_sha_calib_msg, length);
+        } else {
+            rc = hca_sha_update(ss, _hca_sha_calib_msg, length);
+            if ( ! rc ) {
+                rc = hca_sha_final(ss, hash, sizeof(hash));
+            }
+        }
+        unsigned long long end = metal_cpu_get_timer(cpu);
+        if ( rc ) {
+            return rc;
+        }
+        *cycles = MIN(*cycles, end - start);
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Internal API
+//-----------------------------------------------------------------------------
+
+int
+_hca_sha_chain_start(struct hca_sha_session * ss)
+{
+    if ( ss->ss_carry_len ) {
+        // chained requests are DMA only
+        return -EINVAL;
+    }
+
+    return _hca_sha_acquire(ss);
+}
+
+void
+_hca_sha_chain_done(struct hca_sha_session * ss, size_t length, int rc)
+{
+    if ( rc ) {
+        // part of the message may have been hashed
+        _hca_sha_reset(ss);
+        return;
+    }
+
+    ss->ss_length += length;
+    if ( ! ss->ss_length ) {
+        // nothing sent to the engine: do not keep it for an empty message
+        _hca_sha_reset(ss);
+    }
+}
+
+size_t
+_hca_sha_pad_msg(enum hca_sha_mode mode, uint8_t * ptr, uint64_t length)
+{
+    size_t to_end = _hca_sha_pad_len(mode, length);
+
+    memset(ptr, 0, to_end);
+    *ptr |= 0x80;
+    // messages longer than 2^61 bytes are not supported
+    _hca_sha_update_bit_len(&ptr[to_end], length*CHAR_BIT);
+
+    return to_end;
+}
+
+int
+_hca_sha_digest_padded(struct hca_sha_session * ss, uint8_t * hash,
+                       const uint8_t * src, size_t count)
+{
+    if ( _hca_sha_owner && (_hca_sha_owner != ss) ) {
+        return -EBUSY;
+    }
+
+    int rc = _hca_sha_sync(ss);
+    if ( rc ) {
+        return rc;
+    }
+
+    if ( ss->ss_started || ss->ss_carry_len ) {
+        // a message is in progress
+        return -EBUSY;
+    }
+
+    if ( _hca_dma_is_busy() || _hca_sha_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_setup(HCA_FIFO_TARGET_SHA);
+    _hca_sha_owner = ss;
+
+    _hca_cfg_trigger(HCA_CFG_SHA_CR, _hca_sha_cr(ss->ss_mode),
+                     HCA_SHA_CR_INIT_BIT);
+
+    rc = _hca_dma_run(NULL, src, count);
+    if ( ! rc ) {
+        uint64_t state[HCA_SHA_MAX_DIGEST_SIZE/sizeof(uint64_t)];
+        _hca_sha_wait();
+        _hca_sha_get_hash((uint8_t *)state,
+                          _hca_sha_state_size(ss->ss_mode));
+        memcpy(hash, state, hca_sha_digest_size(ss->ss_mode));
+    }
+
+    _hca_sha_reset(ss);
+
+    return rc;
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+size_t
+hca_sha_digest_size(enum hca_sha_mode mode)
+{
+    switch ( mode ) {
+        case HCA_SHA224:
+            return 224u/CHAR_BIT;
+        case HCA_SHA256:
+            return 256u/CHAR_BIT;
+        case HCA_SHA384:
+            return 384u/CHAR_BIT;
+        case HCA_SHA512:
+            return 512u/CHAR_BIT;
+        default:
+            return 0u;
+    }
+}
+
+int
+hca_sha_init(struct hca_sha_session * ss, enum hca_sha_mode mode)
+{
+    if ( ! ss || ! hca_sha_digest_size(mode) ) {
+        return -EINVAL;
+    }
+
+    if ( ! METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_SHA_REV) ) {
+        return -ENODEV;
+    }
+
+    if ( _hca_sha_owner == ss ) {
+        // do not leave a request on-going on the engine
+        (void)_hca_sha_sync(ss);
+    }
+
+    _hca_sha_reset(ss);
+    ss->ss_mode = mode;
+    ss->ss_trail_ix = 0u;
+    ss->ss_pipeline = false;
+
+    return 0;
+}
+
+int
+hca_sha_set_pipeline(struct hca_sha_session * ss, bool enable)
+{
+    if ( ! ss ) {
+        return -EINVAL;
+    }
+
+    int rc = 0;
+    if ( ! enable ) {
+        rc = _hca_sha_sync(ss);
+    }
+
+    ss->ss_pipeline = enable;
+
+    return rc;
+}
+
+int
+hca_sha_sync(struct hca_sha_session * ss)
+{
+    if ( ! ss ) {
+        return -EINVAL;
+    }
+
+    return _hca_sha_sync(ss);
+}
+
+int
+hca_sha_update(struct hca_sha_session * ss, const uint8_t * src,
+               size_t length)
+{
+    if ( ! ss || (! src && length) ) {
+        return -EINVAL;
+    }
+
+    if ( ! length ) {
+        return 0;
+    }
+
+    int rc = _hca_sha_acquire(ss);
+    if ( rc ) {
+        return rc;
+    }
+
+    ss->ss_length += length;
+
+    uint8_t * carry = ss->ss_trail[ss->ss_trail_ix];
+
+    if ( ss->ss_carry_len ) {
+        // complete the carry up to a DMA block, so that it can be pushed w/
+        // the widest FIFO accesses
+        size_t fill = MIN(HCA_DMA_BLOCK_SIZE - ss->ss_carry_len, length);
+        memcpy(&carry[ss->ss_carry_len], src, fill);
+        ss->ss_carry_len += fill;
+        src += fill;
+        length -= fill;
+        if ( ss->ss_carry_len < HCA_DMA_BLOCK_SIZE ) {
+            return 0;
+        }
+        _hca_fifo_in_push(carry, HCA_DMA_BLOCK_SIZE);
+        ss->ss_carry_len = 0u;
+    }
+
+    if ( length < HCA_DMA_BLOCK_SIZE ) {
+        memcpy(carry, src, length);
+        ss->ss_carry_len = length;
+        return _hca_sha_done(ss);
+    }
+
+    struct hca_buf_desc desc;
+    _hca_build_desc(&desc, src, length);
+
+    if ( desc.bd_prolog_len ) {
+        _hca_fifo_in_push(desc.bd_prolog, desc.bd_prolog_len);
+    }
+
+    if ( desc.bd_main_count ) {
+        _hca_sha_dma_start(ss, desc.bd_main, desc.bd_main_count);
+    }
+
+    // less than a DMA block, keep it for the next update, while the DMA
+    // runs
+    memcpy(carry, desc.bd_epilog, desc.bd_epilog_len);
+    ss->ss_carry_len = desc.bd_epilog_len;
+
+    return _hca_sha_done(ss);
+}
+
+int
+hca_sha_final(struct hca_sha_session * ss, uint8_t * hash, size_t hash_len)
+{
+    if ( ! ss || ! hash ) {
+        return -EINVAL;
+    }
+
+    if ( hash_len < hca_sha_digest_size(ss->ss_mode) ) {
+        return -EINVAL;
+    }
+
+    if ( _hca_sha_owner && (_hca_sha_owner != ss) ) {
+        return -EBUSY;
+    }
+
+    // build the padding while the previous request, if any, is on-going
+    size_t trail_len;
+    size_t head;
+    const uint8_t * trail = _hca_sha_pad(ss, &trail_len, &head);
+
+    int rc = _hca_sha_acquire(ss);
+    if ( rc ) {
+        // restore the carry, so that finalization may be retried
+        memmove(ss->ss_trail[ss->ss_trail_ix], trail, ss->ss_carry_len);
+        return rc;
+    }
+
+    if ( head ) {
+        _hca_fifo_in_push(trail, head);
+    }
+
+    size_t count = (trail_len - head) / HCA_DMA_BLOCK_SIZE;
+    if ( count ) {
+        _hca_sha_dma_start(ss, &trail[head], count);
+    }
+
+    // the engine now owns the trail buffer, switch to the other one for the
+    // next message
+    ss->ss_hash = hash;
+    ss->ss_length = 0u;
+    ss->ss_carry_len = 0u;
+    ss->ss_started = false;
+    ss->ss_trail_ix ^= 1u;
+
+    return _hca_sha_done(ss);
+}
+
+int
+hca_sha_digest(struct hca_sha_session * ss, uint8_t * hash,
+               size_t hash_len, const uint8_t * src, size_t length)
+{
+    if ( ! ss || ! hash || (hash_len < hca_sha_digest_size(ss->ss_mode)) ) {
+        return -EINVAL;
+    }
+
+    int rc;
+
+    if ( ! ss->ss_length &&
+         (length < _hca_sha_sw_threshold[ss->ss_mode]) ) {
+        // a pipelined digest may still be pending
+        rc = _hca_sha_sync(ss);
+        if ( rc ) {
+            return rc;
+        }
+        return hca_sha_sw_digest(ss->ss_mode, hash, hash_len, src, length);
+    }
+
+    rc = hca_sha_update(ss, src, length);
+    if ( rc ) {
+        return rc;
+    }
+
+    return hca_sha_final(ss, hash, hash_len);
+}
+
+int
+hca_sha_hash_many(struct hca_sha_session * ss,
+                  const struct hca_sha_record * records, size_t count,
+                  uint8_t * digests, size_t digests_len)
+{
+    if ( ! ss || (count && (! records || ! digests)) ) {
+        return -EINVAL;
+    }
+
+    size_t hash_len = hca_sha_digest_size(ss->ss_mode);
+    if ( digests_len / hash_len < count ) {
+        return -EINVAL;
+    }
+
+    for (unsigned int ix=0; ix<count; ix++) {
+        if ( ! records[ix].sr_data && records[ix].sr_length ) {
+            return -EINVAL;
+        }
+    }
+
+    if ( _hca_sha_owner && (_hca_sha_owner != ss) ) {
+        return -EBUSY;
+    }
+
+    int rc = _hca_sha_sync(ss);
+    if ( rc ) {
+        return rc;
+    }
+
+    if ( ss->ss_started || ss->ss_carry_len ) {
+        // a message is in progress
+        return -EBUSY;
+    }
+
+    if ( _hca_dma_is_busy() || _hca_sha_is_busy() ) {
+        return -EBUSY;
+    }
+
+    _hca_setup(HCA_FIFO_TARGET_SHA);
+    _hca_sha_owner = ss;
+
+    // SHA mode w/ init request: a single write starts each message
+    uint32_t sha_cr = _hca_sha_cr(ss->ss_mode);
+
+    size_t state_size = _hca_sha_state_size(ss->ss_mode);
+    uint64_t state[HCA_SHA_MAX_DIGEST_SIZE/sizeof(uint64_t)];
+
+    for (unsigned int ix=0; ix<count; ix++) {
+        _hca_cfg_trigger(HCA_CFG_SHA_CR, sha_cr, HCA_SHA_CR_INIT_BIT);
+
+        struct hca_buf_desc desc;
+        _hca_build_desc(&desc, records[ix].sr_data, records[ix].sr_length);
+
+        if ( desc.bd_prolog_len ) {
+            _hca_fifo_in_push(desc.bd_prolog, desc.bd_prolog_len);
+        }
+
+        if ( desc.bd_main_count ) {
+            rc = _hca_dma_run(NULL, desc.bd_main, desc.bd_main_count);
+            if ( rc ) {
+                break;
+            }
+        }
+
+        memcpy(ss->ss_trail[ss->ss_trail_ix], desc.bd_epilog,
+               desc.bd_epilog_len);
+        ss->ss_carry_len = desc.bd_epilog_len;
+        ss->ss_length = records[ix].sr_length;
+
+        size_t trail_len;
+        size_t head;
+        const uint8_t * trail = _hca_sha_pad(ss, &trail_len, &head);
+
+        // the trail is short, pushing it from the CPU is cheaper than
+        // setting up a DMA request
+        _hca_fifo_in_push(trail, trail_len);
+
+        _hca_sha_wait();
+        _hca_sha_get_hash((uint8_t *)state, state_size);
+        memcpy(&digests[ix*hash_len], state, hash_len);
+    }
+
+    _hca_sha_reset(ss);
+
+    return rc;
+}
+
+int
+hca_sha_set_sw_threshold(enum hca_sha_mode mode, size_t threshold)
+{
+    if ( ! hca_sha_digest_size(mode) ) {
+        return -EINVAL;
+    }
+
+    _hca_sha_sw_threshold[mode] = threshold;
+
+    return 0;
+}
+
+size_t
+hca_sha_get_sw_threshold(enum hca_sha_mode mode)
+{
+    return hca_sha_digest_size(mode) ? _hca_sha_sw_threshold[mode] : 0u;
+}
+
+int
+hca_sha_calibrate(enum hca_sha_mode mode, size_t * threshold)
+{
+    struct metal_cpu * cpu = metal_cpu_get(metal_cpu_get_current_hartid());
+    if ( ! cpu ) {
+        return -ENODEV;
+    }
+
+    struct hca_sha_session ss;
+    int rc = hca_sha_init(&ss, mode);
+    if ( rc ) {
+        return rc;
+    }
+
+    // first length, in DMA blocks, at which the engine wins
+    size_t length;
+    for (length=0; length<HCA_SHA_CALIBRATE_MAX;
+         length+=HCA_DMA_BLOCK_SIZE) {
+        unsigned long long sw_cycles;
+        unsigned long long hw_cycles;
+        rc = _hca_sha_measure(cpu, &ss, false, length, &hw_cycles);
+        if ( rc ) {
+            return rc;
+        }
+        rc = _hca_sha_measure(cpu, &ss, true, length, &sw_cycles);
+        if ( rc ) {
+            return rc;
+        }
+        if ( hw_cycles <= sw_cycles ) {
+            break;
+        }
+    }
+
+    _hca_sha_sw_threshold[mode] = length;
+    if ( threshold ) {
+        *threshold = length;
+    }
+
+    return 0;
+}
@@ -0,0 +1,315 @@
+/**
+ * @file sha_sw.c
+ * @brief HCA crypto engine driver: software SHA-2 for short messages
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <limits.h>
+#include <string.h>
+#include "hca/sha.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+#define ROR32(_x_, _n_) (((_x_) >> (_n_)) | ((_x_) << (32u - (_n_))))
+#define ROR64(_x_, _n_) (((_x_) >> (_n_)) | ((_x_) << (64u - (_n_))))
+
+#define SHA_CH(_x_, _y_, _z_)  (((_x_) & (_y_)) ^ (~(_x_) & (_z_)))
+#define SHA_MAJ(_x_, _y_, _z_) (((_x_) & (_y_)) ^ ((_x_) & (_z_)) ^ \
+                                ((_y_) & (_z_)))
+
+#define SHA256_S0(_x_) (ROR32(_x_, 2u) ^ ROR32(_x_, 13u) ^ ROR32(_x_, 22u))
+#define SHA256_S1(_x_) (ROR32(_x_, 6u) ^ ROR32(_x_, 11u) ^ ROR32(_x_, 25u))
+#define SHA256_s0(_x_) (ROR32(_x_, 7u) ^ ROR32(_x_, 18u) ^ ((_x_) >> 3u))
+#define SHA256_s1(_x_) (ROR32(_x_, 17u) ^ ROR32(_x_, 19u) ^ ((_x_) >> 10u))
+
+#define SHA512_S0(_x_) (ROR64(_x_, 28u) ^ ROR64(_x_, 34u) ^ ROR64(_x_, 39u))
+#define SHA512_S1(_x_) (ROR64(_x_, 14u) ^ ROR64(_x_, 18u) ^ ROR64(_x_, 41u))
+#define SHA512_s0(_x_) (ROR64(_x_, 1u) ^ ROR64(_x_, 8u) ^ ((_x_) >> 7u))
+#define SHA512_s1(_x_) (ROR64(_x_, 19u) ^ ROR64(_x_, 61u) ^ ((_x_) >> 6u))
+
+/**
+ * One round, w/o moving the working variables: the callers rotate the
+ * arguments instead, so that the compiler keeps them in registers.
+ */
+#define SHA_ROUND(_S0_, _S1_, _k_, _w_, _a_, _b_, _c_, _d_, _e_, _f_, _g_, \
+                  _h_, _i_)                                                \
+    do {                                                                   \
+        (_h_) += _S1_(_e_) + SHA_CH(_e_, _f_, _g_) + (_k_)[(_i_)] +        \
+                 (_w_)[(_i_) & 15u];                                       \
+        (_d_) += (_h_);                                                    \
+        (_h_) += _S0_(_a_) + SHA_MAJ(_a_, _b_, _c_);                       \
+    } while (0)
+
+/** Eight rounds, i.e. a full rotation of the working variables */
+#define SHA_ROUND8(_S0_, _S1_, _k_, _w_, _i_)                            \
+    do {                                                                 \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, a, b, c, d, e, f, g, h, _i_+0u); \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, h, a, b, c, d, e, f, g, _i_+1u); \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, g, h, a, b, c, d, e, f, _i_+2u); \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, f, g, h, a, b, c, d, e, _i_+3u); \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, e, f, g, h, a, b, c, d, _i_+4u); \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, d, e, f, g, h, a, b, c, _i_+5u); \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, c, d, e, f, g, h, a, b, _i_+6u); \
+        SHA_ROUND(_S0_, _S1_, _k_, _w_, b, c, d, e, f, g, h, a, _i_+7u); \
+    } while (0)
+
+/** Next word of the rolling 16-word message schedule */
+#define SHA_SCHEDULE(_s0_, _s1_, _w_, _i_)                          \
+    (_w_)[(_i_)] += _s1_((_w_)[((_i_) + 14u) & 15u]) +              \
+                    (_w_)[((_i_) + 9u) & 15u] +                     \
+                    _s0_((_w_)[((_i_) + 1u) & 15u])
+
+#define SHA_SCHEDULE16(_s0_, _s1_, _w_)                                   \
+    do {                                                                  \
+        for (unsigned int _j_=0; _j_<16u; _j_++) {                        \
+            SHA_SCHEDULE(_s0_, _s1_, _w_, _j_);                           \
+        }                                                                 \
+    } while (0)
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define SHA256_ROUNDS 64u
+#define SHA512_ROUNDS 80u
+
+static const uint32_t _SHA256_K[SHA256_ROUNDS] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t _SHA512_K[SHA512_ROUNDS] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f,
+    0xe9b5dba58189dbbc, 0x3956c25bf348b538, 0x59f111f1b605d019,
+    0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242,
+    0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+    0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3,
+    0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65, 0x2de92c6f592b0275,
+    0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+    0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f,
+    0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc,
+    0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+    0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6,
+    0x92722c851482353b, 0xa2bfe8a14cf10364, 0xa81a664bbc423001,
+    0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+    0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99,
+    0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb,
+    0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc,
+    0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915,
+    0xc67178f2e372532b, 0xca273eceea26619c, 0xd186b8c721c0c207,
+    0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba,
+    0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+    0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a,
+    0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+};
+
+static const uint32_t _SHA224_H0[8u] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511,
+    0x64f98fa7, 0xbefa4fa4,
+};
+
+static const uint32_t _SHA256_H0[8u] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
+    0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint64_t _SHA384_H0[8u] = {
+    0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17,
+    0x152fecd8f70e5939, 0x67332667ffc00b31, 0x8eb44a8768581511,
+    0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4,
+};
+
+static const uint64_t _SHA512_H0[8u] = {
+    0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b,
+    0xa54ff53a5f1d36f1, 0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+    0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+};
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+static void
+_hca_sha256_block(uint32_t * state, const uint8_t * block)
+{
+    uint32_t w[16u];
+
+    // word-at-a-time load, no alignment constraint on the message
+    memcpy(w, block, sizeof(w));
+    for (unsigned int ix=0; ix<16u; ix++) {
+        w[ix] = __builtin_bswap32(w[ix]);
+    }
+
+    uint32_t a = state[0u];
+    uint32_t b = state[1u];
+    uint32_t c = state[2u];
+    uint32_t d = state[3u];
+    uint32_t e = state[4u];
+    uint32_t f = state[5u];
+    uint32_t g = state[6u];
+    uint32_t h = state[7u];
+
+    for (unsigned int rnd=0; rnd<SHA256_ROUNDS; rnd+=16u) {
+        if ( rnd ) {
+            SHA_SCHEDULE16(SHA256_s0, SHA256_s1, w);
+        }
+        const uint32_t * k = &_SHA256_K[rnd];
+        SHA_ROUND8(SHA256_S0, SHA256_S1, k, w, 0u);
+        SHA_ROUND8(SHA256_S0, SHA256_S1, k, w, 8u);
+    }
+
+    state[0u] += a;
+    state[1u] += b;
+    state[2u] += c;
+    state[3u] += d;
+    state[4u] += e;
+    state[5u] += f;
+    state[6u] += g;
+    state[7u] += h;
+}
+
+static void
+_hca_sha512_block(uint64_t * state, const uint8_t * block)
+{
+    uint64_t w[16u];
+
+    memcpy(w, block, sizeof(w));
+    for (unsigned int ix=0; ix<16u; ix++) {
+        w[ix] = __builtin_bswap64(w[ix]);
+    }
+
+    uint64_t a = state[0u];
+    uint64_t b = state[1u];
+    uint64_t c = state[2u];
+    uint64_t d = state[3u];
+    uint64_t e = state[4u];
+    uint64_t f = state[5u];
+    uint64_t g = state[6u];
+    uint64_t h = state[7u];
+
+    for (unsigned int rnd=0; rnd<SHA512_ROUNDS; rnd+=16u) {
+        if ( rnd ) {
+            SHA_SCHEDULE16(SHA512_s0, SHA512_s1, w);
+        }
+        const uint64_t * k = &_SHA512_K[rnd];
+        SHA_ROUND8(SHA512_S0, SHA512_S1, k, w, 0u);
+        SHA_ROUND8(SHA512_S0, SHA512_S1, k, w, 8u);
+    }
+
+    state[0u] += a;
+    state[1u] += b;
+    state[2u] += c;
+    state[3u] += d;
+    state[4u] += e;
+    state[5u] += f;
+    state[6u] += g;
+    state[7u] += h;
+}
+
+/**
+ * Hash a message w/ a block function, the last block(s) being padded in a
+ * local buffer.
+ */
+static void
+_hca_sha_sw_run(void (* block_fn)(void * state, const uint8_t * block),
+                void * state, size_t block_size, size_t len_size,
+                const uint8_t * src, size_t length)
+{
+    uint64_t last[2u*HCA_SHA512_BLOCK_SIZE/sizeof(uint64_t)];
+    uint8_t * trail = (uint8_t *)last;
+
+    size_t full = length - (length % block_size);
+    for (size_t pos=0; pos<full; pos+=block_size) {
+        block_fn(state, &src[pos]);
+    }
+
+    size_t rem = length - full;
+    size_t trail_len = (rem + 1u + len_size <= block_size) ?
+        block_size : 2u*block_size;
+
+    memset(trail, 0, trail_len);
+    if ( rem ) {
+        memcpy(trail, &src[full], rem);
+    }
+    trail[rem] = 0x80;
+    // messages longer than 2^61 bytes are not supported
+    uint64_t bit_len = (uint64_t)length * CHAR_BIT;
+    for (unsigned int ix=0; ix<sizeof(uint64_t); ix++) {
+        trail[trail_len - 1u - ix] = (uint8_t)(bit_len >> (CHAR_BIT*ix));
+    }
+
+    for (size_t pos=0; pos<trail_len; pos+=block_size) {
+        block_fn(state, &trail[pos]);
+    }
+}
+
+static void
+_hca_sha256_block_fn(void * state, const uint8_t * block)
+{
+    _hca_sha256_block((uint32_t *)state, block);
+}
+
+static void
+_hca_sha512_block_fn(void * state, const uint8_t * block)
+{
+    _hca_sha512_block((uint64_t *)state, block);
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_sha_sw_digest(enum hca_sha_mode mode, uint8_t * hash, size_t hash_len,
+                  const uint8_t * src, size_t length)
+{
+    size_t digest_size = hca_sha_digest_size(mode);
+
+    if ( ! hash || ! digest_size || (hash_len < digest_size) ||
+         (length && ! src) ) {
+        return -EINVAL;
+    }
+
+    if ( (mode == HCA_SHA224) || (mode == HCA_SHA256) ) {
+        uint32_t state[8u];
+        memcpy(state, (mode == HCA_SHA224) ? _SHA224_H0 : _SHA256_H0,
+               sizeof(state));
+        _hca_sha_sw_run(&_hca_sha256_block_fn, state, HCA_SHA256_BLOCK_SIZE,
+                        HCA_SHA256_LEN_SIZE, src, length);
+        for (unsigned int ix=0; ix<ARRAY_SIZE(state); ix++) {
+            state[ix] = __builtin_bswap32(state[ix]);
+        }
+        memcpy(hash, state, digest_size);
+    } else {
+        uint64_t state[8u];
+        memcpy(state, (mode == HCA_SHA384) ? _SHA384_H0 : _SHA512_H0,
+               sizeof(state));
+        _hca_sha_sw_run(&_hca_sha512_block_fn, state, HCA_SHA512_BLOCK_SIZE,
+                        HCA_SHA512_LEN_SIZE, src, length);
+        for (unsigned int ix=0; ix<ARRAY_SIZE(state); ix++) {
+            state[ix] = __builtin_bswap64(state[ix]);
+        }
+        memcpy(hash, state, digest_size);
+    }
+
+    return 0;
+}
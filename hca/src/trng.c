@@ -0,0 +1,298 @@
+/**
+ * @file trng.c
+ * @brief HCA crypto engine driver: TRNG entropy pool
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "hca/trng.h"
+#include "hca_priv.h"
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+#define HCA_TRNG_SR_RNDRDY_BIT \
+    (HCA_REGISTER_TRNG_SR_RNDRDY_MASK << HCA_REGISTER_TRNG_SR_RNDRDY_OFFSET)
+#define HCA_TRNG_SR_HTR_BIT \
+    (HCA_REGISTER_TRNG_SR_HTR_MASK << HCA_REGISTER_TRNG_SR_HTR_OFFSET)
+#define HCA_TRNG_SR_HTS_BIT \
+    (HCA_REGISTER_TRNG_SR_HTS_MASK << HCA_REGISTER_TRNG_SR_HTS_OFFSET)
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+/** Pool the TRNG IRQ is routed to */
+static struct hca_trng * _hca_trng;
+
+//-----------------------------------------------------------------------------
+// Internal functions
+//-----------------------------------------------------------------------------
+
+static int
+_hca_trng_health_test(void)
+{
+    // lock trim value
+    _hca_updreg32(METAL_SIFIVE_HCA_TRNG_TRIM, 1,
+                  HCA_REGISTER_TRNG_TRIM_LOCK_OFFSET,
+                  HCA_REGISTER_TRNG_TRIM_LOCK_MASK);
+
+    // start on-demand health test
+    _hca_updreg32(METAL_SIFIVE_HCA_TRNG_CR, 1,
+                  HCA_REGISTER_TRNG_CR_HTSTART_OFFSET,
+                  HCA_REGISTER_TRNG_CR_HTSTART_MASK);
+
+    int rc = 0;
+    while ( METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_SR) &
+            HCA_TRNG_SR_HTR_BIT ) {
+        // all 0's should be read back while the health test is running
+        if ( METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_DATA) &&
+             (METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_SR) &
+              HCA_TRNG_SR_HTR_BIT) ) {
+            rc = -EIO;
+            break;
+        }
+    }
+
+    if ( METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_SR) &
+         HCA_TRNG_SR_HTS_BIT ) {
+        rc = -EIO;
+    }
+
+    _hca_updreg32(METAL_SIFIVE_HCA_TRNG_CR, 0,
+                  HCA_REGISTER_TRNG_CR_HTSTART_OFFSET,
+                  HCA_REGISTER_TRNG_CR_HTSTART_MASK);
+
+    return rc;
+}
+
+static void
+_hca_trng_set_irq(struct hca_trng * tr, bool enable)
+{
+    tr->tr_refill = enable;
+    _hca_updreg32(METAL_SIFIVE_HCA_TRNG_CR, enable ? 1u : 0u,
+                  HCA_REGISTER_TRNG_CR_RNDIRQEN_OFFSET,
+                  HCA_REGISTER_TRNG_CR_RNDIRQEN_MASK);
+}
+
+/**
+ * Poll the TRNG for a single word.
+ *
+ * Called w/ the TRNG IRQ masked, so that the handler does not steal it.
+ */
+static int
+_hca_trng_poll(uint32_t * word)
+{
+    uint32_t sr;
+    do {
+        sr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_SR);
+        if ( sr & HCA_TRNG_SR_HTS_BIT ) {
+            return -EIO;
+        }
+    } while ( ! (sr & HCA_TRNG_SR_RNDRDY_BIT) );
+
+    *word = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_DATA);
+
+    return 0;
+}
+
+static void
+_hca_trng_irq_handler(int id, void * opaque)
+{
+    struct hca_trng * tr = (struct hca_trng *)opaque;
+
+    (void)id;
+
+    uint32_t sr;
+    while ( (sr = METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_SR)) &
+            HCA_TRNG_SR_RNDRDY_BIT ) {
+        if ( sr & HCA_TRNG_SR_HTS_BIT ) {
+            tr->tr_error = -EIO;
+            _hca_trng_set_irq(tr, false);
+            return;
+        }
+        size_t tail = tr->tr_tail;
+        if ( (tail - tr->tr_head) >= tr->tr_size ) {
+            // pool is full, resumed from #hca_getrandom
+            _hca_trng_set_irq(tr, false);
+            return;
+        }
+        // reading the data acknowledges the IRQ; in burst mode several
+        // words may be ready at once
+        tr->tr_pool[tail & (tr->tr_size-1u)] =
+            METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_DATA);
+        __atomic_signal_fence(__ATOMIC_RELEASE);
+        tr->tr_tail = tail + 1u;
+    }
+}
+
+/**
+ * Move whole words from the pool.
+ *
+ * @return the count of copied words
+ */
+static size_t
+_hca_trng_drain(struct hca_trng * tr, uint8_t * dst, size_t count)
+{
+    size_t head = tr->tr_head;
+    size_t avail = tr->tr_tail - head;
+    __atomic_signal_fence(__ATOMIC_ACQUIRE);
+
+    size_t pos = head & (tr->tr_size-1u);
+    // do not wrap around the ring end within a single copy
+    count = MIN(MIN(count, avail), tr->tr_size - pos);
+    if ( count ) {
+        uint32_t * words = &tr->tr_pool[pos];
+        memcpy(dst, words, count*sizeof(uint32_t));
+        // entropy is delivered once
+        memset(words, 0, count*sizeof(uint32_t));
+        __atomic_signal_fence(__ATOMIC_RELEASE);
+        tr->tr_head = head + count;
+    }
+
+    return count;
+}
+
+/**
+ * Resume the pool refill once the low watermark is reached.
+ */
+static void
+_hca_trng_resume(struct hca_trng * tr)
+{
+    if ( ! tr->tr_refill && ! tr->tr_error &&
+         ((tr->tr_tail - tr->tr_head) <= (tr->tr_size >> 1u)) ) {
+        unsigned long mstatus = _hca_irq_save();
+        _hca_trng_set_irq(tr, true);
+        _hca_irq_restore(mstatus);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// API
+//-----------------------------------------------------------------------------
+
+int
+hca_trng_init(struct hca_trng * tr, uint32_t * pool, size_t size,
+              bool burst)
+{
+    if ( ! tr || ! pool || ! size || (size & (size - 1u)) ) {
+        return -EINVAL;
+    }
+
+    if ( _hca_trng ) {
+        return -EBUSY;
+    }
+
+    if ( ! METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_REV) ) {
+        return -ENODEV;
+    }
+
+    int rc = _hca_trng_health_test();
+    if ( rc ) {
+        return rc;
+    }
+
+    tr->tr_pool = pool;
+    tr->tr_size = size;
+    tr->tr_head = 0u;
+    tr->tr_tail = 0u;
+    tr->tr_refill = false;
+    tr->tr_error = 0;
+
+    rc = _hca_irq_attach(HCA_TRNG_IRQ_CHANNEL, &_hca_trng_irq_handler, tr);
+    if ( rc ) {
+        return rc;
+    }
+
+    _hca_updreg32(METAL_SIFIVE_HCA_TRNG_CR, burst ? 1u : 0u,
+                  HCA_REGISTER_TRNG_CR_BURSTEN_OFFSET,
+                  HCA_REGISTER_TRNG_CR_BURSTEN_MASK);
+
+    _hca_trng = tr;
+
+    // start filling the pool right away
+    unsigned long mstatus = _hca_irq_save();
+    _hca_trng_set_irq(tr, true);
+    _hca_irq_restore(mstatus);
+
+    return 0;
+}
+
+int
+hca_trng_fini(struct hca_trng * tr)
+{
+    if ( ! tr || (tr != _hca_trng) ) {
+        return -EINVAL;
+    }
+
+    unsigned long mstatus = _hca_irq_save();
+    _hca_trng_set_irq(tr, false);
+    _hca_irq_restore(mstatus);
+
+    _hca_irq_detach(HCA_TRNG_IRQ_CHANNEL);
+    _hca_updreg32(METAL_SIFIVE_HCA_TRNG_CR, 0,
+                  HCA_REGISTER_TRNG_CR_BURSTEN_OFFSET,
+                  HCA_REGISTER_TRNG_CR_BURSTEN_MASK);
+
+    memset(tr->tr_pool, 0, tr->tr_size*sizeof(uint32_t));
+    tr->tr_head = tr->tr_tail = 0u;
+
+    _hca_trng = NULL;
+
+    return 0;
+}
+
+int
+hca_getrandom(void * buf, size_t len)
+{
+    struct hca_trng * tr = _hca_trng;
+
+    if ( ! buf && len ) {
+        return -EINVAL;
+    }
+
+    if ( ! tr ) {
+        return -ENODEV;
+    }
+
+    if ( tr->tr_error ) {
+        return tr->tr_error;
+    }
+
+    uint8_t * dst = (uint8_t *)buf;
+    int rc = 0;
+
+    while ( len ) {
+        size_t count = _hca_trng_drain(tr, dst, len/sizeof(uint32_t));
+        if ( count ) {
+            dst += count*sizeof(uint32_t);
+            len -= count*sizeof(uint32_t);
+            continue;
+        }
+
+        // less than a word to deliver, or pool drained
+        uint32_t word;
+        if ( ! _hca_trng_drain(tr, (uint8_t *)&word, 1u) ) {
+            // do not wait for the next IRQ
+            _hca_trng_resume(tr);
+            unsigned long mstatus = _hca_irq_save();
+            rc = _hca_trng_poll(&word);
+            _hca_irq_restore(mstatus);
+            if ( rc ) {
+                tr->tr_error = rc;
+                break;
+            }
+        }
+        size_t chunk = MIN(len, sizeof(uint32_t));
+        memcpy(dst, &word, chunk);
+        dst += chunk;
+        len -= chunk;
+    }
+
+    _hca_trng_resume(tr);
+
+    return rc;
+}
@@ -13,6 +13,28 @@ typedef volatile int32_t metal_atomic_t;
 #define METAL_ATOMIC_DECLARE(name)                                             \
     __attribute((section(".data.atomics"))) metal_atomic_t name
 
+#if __riscv_xlen == 64
+/* 64-bit atomics are only available on RV64 */
+typedef volatile int64_t metal_atomic64_t;
+
+#define METAL_ATOMIC64_DECLARE(name)                                           \
+    __attribute((section(".data.atomics"))) metal_atomic64_t name
+#endif
+
+/*!
+ * @brief Memory ordering of an atomic operation, as in C11
+ *
+ * Acquire and release orderings map to the .aq and .rl bits of the AMO and
+ * LR/SC instructions, or to fences around plain loads and stores.
+ */
+typedef enum {
+    METAL_ATOMIC_RELAXED,
+    METAL_ATOMIC_ACQUIRE,
+    METAL_ATOMIC_RELEASE,
+    METAL_ATOMIC_ACQ_REL,
+    METAL_ATOMIC_SEQ_CST,
+} metal_atomic_order_t;
+
 #define _METAL_STORE_AMO_ACCESS_FAULT 7
 
 /* This macro stores the memory address in mtval like a normal store/amo access
@@ -256,4 +278,284 @@ __inline__ uint32_t metal_atomic_min_u(metal_atomic_t *a, uint32_t compare) {
 #endif
 }
 
+/*
+ * Operations with an explicit memory ordering, and their 64-bit variants
+ *
+ * The ordering is expected to be a constant, so that only a single
+ * instruction remains once the function is inlined.
+ */
+
+/* Emit an AMO instruction w/ the ordering bits of a memory order */
+#define _METAL_ATOMIC_AMO(insn, order, old_, value_, a_)                       \
+    switch (order) {                                                           \
+    case METAL_ATOMIC_RELAXED:                                                 \
+        _METAL_ATOMIC_AMO_ASM(insn, "", old_, value_, a_);                     \
+        break;                                                                 \
+    case METAL_ATOMIC_ACQUIRE:                                                 \
+        _METAL_ATOMIC_AMO_ASM(insn, ".aq", old_, value_, a_);                  \
+        break;                                                                 \
+    case METAL_ATOMIC_RELEASE:                                                 \
+        _METAL_ATOMIC_AMO_ASM(insn, ".rl", old_, value_, a_);                  \
+        break;                                                                 \
+    default:                                                                   \
+        _METAL_ATOMIC_AMO_ASM(insn, ".aqrl", old_, value_, a_);                \
+        break;                                                                 \
+    }
+
+#define _METAL_ATOMIC_AMO_ASM(insn, bits, old_, value_, a_)                    \
+    __asm__ volatile(insn bits " %[old], %[value], (%[atomic])"                \
+                     : [old] "=r"(old_)                                        \
+                     : [value] "r"(value_), [atomic] "r"(a_)                   \
+                     : "memory")
+
+/* Define an AMO operation w/ an explicit memory ordering */
+#ifdef __riscv_atomic
+#define _METAL_ATOMIC_AMO_DEFINE(name, insn, atomic_t, value_t)                \
+    __inline__ value_t name(atomic_t *a, value_t value,                        \
+                            metal_atomic_order_t order) {                      \
+        value_t old;                                                           \
+        _METAL_ATOMIC_AMO(insn, order, old, value, a)                          \
+        return old;                                                            \
+    }
+#else
+#define _METAL_ATOMIC_AMO_DEFINE(name, insn, atomic_t, value_t)                \
+    __inline__ value_t name(atomic_t *a, value_t value,                        \
+                            metal_atomic_order_t order) {                      \
+        (void)value;                                                           \
+        (void)order;                                                           \
+        _METAL_TRAP_AMO_ACCESS(a);                                             \
+    }
+#endif
+
+/* Emit a LR/SC compare-and-swap loop w/ the ordering bits of an order */
+#define _METAL_ATOMIC_CAS_ASM(width, lr_bits, sc_bits, old_, exp_, des_, a_)   \
+    do {                                                                       \
+        int fail;                                                              \
+        __asm__ volatile("1: lr." width lr_bits " %[old], (%[atomic])\n"       \
+                         "   bne %[old], %[exp], 2f\n"                         \
+                         "   sc." width sc_bits                                \
+                         " %[fail], %[des], (%[atomic])\n"                     \
+                         "   bnez %[fail], 1b\n"                               \
+                         "2:"                                                  \
+                         : [old] "=&r"(old_), [fail] "=&r"(fail)               \
+                         : [exp] "r"(exp_), [des] "r"(des_), [atomic] "r"(a_)  \
+                         : "memory");                                          \
+    } while (0)
+
+/* Define a compare-and-swap w/ an explicit memory ordering */
+#ifdef __riscv_atomic
+#define _METAL_ATOMIC_CAS_DEFINE(name, width, atomic_t, value_t)               \
+    __inline__ int name(atomic_t *a, value_t *expected, value_t desired,       \
+                        metal_atomic_order_t order) {                          \
+        value_t exp = *expected;                                               \
+        value_t old;                                                           \
+        switch (order) {                                                       \
+        case METAL_ATOMIC_RELAXED:                                             \
+            _METAL_ATOMIC_CAS_ASM(width, "", "", old, exp, desired, a);        \
+            break;                                                             \
+        case METAL_ATOMIC_ACQUIRE:                                             \
+            _METAL_ATOMIC_CAS_ASM(width, ".aq", "", old, exp, desired, a);     \
+            break;                                                             \
+        case METAL_ATOMIC_RELEASE:                                             \
+            _METAL_ATOMIC_CAS_ASM(width, "", ".rl", old, exp, desired, a);     \
+            break;                                                             \
+        case METAL_ATOMIC_ACQ_REL:                                             \
+            _METAL_ATOMIC_CAS_ASM(width, ".aq", ".rl", old, exp, desired, a);  \
+            break;                                                             \
+        default:                                                               \
+            _METAL_ATOMIC_CAS_ASM(width, ".aqrl", ".rl", old, exp, desired,    \
+                                  a);                                          \
+            break;                                                             \
+        }                                                                      \
+        if (old != exp) {                                                      \
+            *expected = old;                                                   \
+            return 0;                                                          \
+        }                                                                      \
+        return 1;                                                              \
+    }
+#else
+#define _METAL_ATOMIC_CAS_DEFINE(name, width, atomic_t, value_t)               \
+    __inline__ int name(atomic_t *a, value_t *expected, value_t desired,       \
+                        metal_atomic_order_t order) {                          \
+        (void)expected;                                                        \
+        (void)desired;                                                         \
+        (void)order;                                                           \
+        _METAL_TRAP_AMO_ACCESS(a);                                             \
+    }
+#endif
+
+/* Define a plain load and store w/ the fences of an explicit ordering */
+#define _METAL_ATOMIC_LOAD_STORE_DEFINE(load, store, atomic_t, value_t)        \
+    __inline__ value_t load(atomic_t *a, metal_atomic_order_t order) {         \
+        if (order == METAL_ATOMIC_SEQ_CST) {                                   \
+            __asm__ volatile("fence rw, rw" ::: "memory");                     \
+        }                                                                      \
+        value_t value = *a;                                                    \
+        if (order != METAL_ATOMIC_RELAXED) {                                   \
+            __asm__ volatile("fence r, rw" ::: "memory");                      \
+        }                                                                      \
+        return value;                                                          \
+    }                                                                          \
+    __inline__ void store(atomic_t *a, value_t value,                          \
+                          metal_atomic_order_t order) {                        \
+        if (order != METAL_ATOMIC_RELAXED) {                                   \
+            __asm__ volatile("fence rw, w" ::: "memory");                      \
+        }                                                                      \
+        *a = value;                                                            \
+    }
+
+/*
+ * List of the operations w/ an explicit ordering:
+ * AMO(name, instruction, atomic type, value type)
+ * CAS(name, LR/SC width, atomic type, value type)
+ * LDST(load name, store name, atomic type, value type)
+ */
+#define _METAL_ATOMIC32_OPS(AMO, CAS, LDST)                                    \
+    AMO(metal_atomic_add_explicit, "amoadd.w", metal_atomic_t, int32_t)        \
+    AMO(metal_atomic_and_explicit, "amoand.w", metal_atomic_t, int32_t)        \
+    AMO(metal_atomic_or_explicit, "amoor.w", metal_atomic_t, int32_t)          \
+    AMO(metal_atomic_xor_explicit, "amoxor.w", metal_atomic_t, int32_t)        \
+    AMO(metal_atomic_swap_explicit, "amoswap.w", metal_atomic_t, int32_t)      \
+    AMO(metal_atomic_max_explicit, "amomax.w", metal_atomic_t, int32_t)        \
+    AMO(metal_atomic_max_u_explicit, "amomaxu.w", metal_atomic_t, uint32_t)    \
+    AMO(metal_atomic_min_explicit, "amomin.w", metal_atomic_t, int32_t)        \
+    AMO(metal_atomic_min_u_explicit, "amominu.w", metal_atomic_t, uint32_t)    \
+    CAS(metal_atomic_cas_explicit, "w", metal_atomic_t, int32_t)               \
+    LDST(metal_atomic_load, metal_atomic_store, metal_atomic_t, int32_t)
+
+#if __riscv_xlen == 64
+#define _METAL_ATOMIC64_OPS(AMO, CAS, LDST)                                    \
+    AMO(metal_atomic64_add_explicit, "amoadd.d", metal_atomic64_t, int64_t)    \
+    AMO(metal_atomic64_and_explicit, "amoand.d", metal_atomic64_t, int64_t)    \
+    AMO(metal_atomic64_or_explicit, "amoor.d", metal_atomic64_t, int64_t)      \
+    AMO(metal_atomic64_xor_explicit, "amoxor.d", metal_atomic64_t, int64_t)    \
+    AMO(metal_atomic64_swap_explicit, "amoswap.d", metal_atomic64_t, int64_t)  \
+    AMO(metal_atomic64_max_explicit, "amomax.d", metal_atomic64_t, int64_t)    \
+    AMO(metal_atomic64_max_u_explicit, "amomaxu.d", metal_atomic64_t,          \
+        uint64_t)                                                              \
+    AMO(metal_atomic64_min_explicit, "amomin.d", metal_atomic64_t, int64_t)    \
+    AMO(metal_atomic64_min_u_explicit, "amominu.d", metal_atomic64_t,          \
+        uint64_t)                                                              \
+    CAS(metal_atomic64_cas_explicit, "d", metal_atomic64_t, int64_t)           \
+    LDST(metal_atomic64_load, metal_atomic64_store, metal_atomic64_t, int64_t)
+#else
+#define _METAL_ATOMIC64_OPS(AMO, CAS, LDST)
+#endif
+
+/*!
+ * @fn metal_atomic_add_explicit
+ * @brief Atomically apply an operation to a metal_atomic_t w/ an explicit
+ * memory ordering, and return its old value
+ *
+ * metal_atomic_{add,and,or,xor,swap,max,max_u,min,min_u}_explicit behave as
+ * the functions of the same name w/o the _explicit suffix. On RV64, the
+ * metal_atomic64_*_explicit functions apply to a metal_atomic64_t.
+ *
+ * @param a The pointer to the value
+ * @param value The operand of the operation
+ * @param order The memory ordering of the operation
+ *
+ * @return The previous value of the atomic
+ */
+
+/*!
+ * @fn metal_atomic_cas_explicit
+ * @brief Atomically replace the value of a metal_atomic_t if it holds an
+ * expected value, w/ an explicit memory ordering
+ *
+ * This is a strong compare-and-swap, built on a LR/SC loop. On RV64,
+ * metal_atomic64_cas_explicit applies to a metal_atomic64_t.
+ *
+ * @param a The pointer to the value
+ * @param expected The expected value, updated w/ the current value on
+ * failure
+ * @param desired The value to store if the current value is the expected one
+ * @param order The memory ordering of the operation, on success; a failure
+ * is not ordered beyond the acquire semantics of the load, if any
+ *
+ * @return 1 if the value has been replaced, 0 otherwise
+ */
+
+/*!
+ * @fn metal_atomic_load
+ * @brief Load a metal_atomic_t w/ an explicit memory ordering
+ *
+ * metal_atomic_store stores a value w/ an explicit memory ordering. On RV64,
+ * metal_atomic64_load and metal_atomic64_store apply to a metal_atomic64_t.
+ */
+
+_METAL_ATOMIC32_OPS(_METAL_ATOMIC_AMO_DEFINE, _METAL_ATOMIC_CAS_DEFINE,
+                    _METAL_ATOMIC_LOAD_STORE_DEFINE)
+_METAL_ATOMIC64_OPS(_METAL_ATOMIC_AMO_DEFINE, _METAL_ATOMIC_CAS_DEFINE,
+                    _METAL_ATOMIC_LOAD_STORE_DEFINE)
+
+/*!
+ * @brief Atomically replace the value of a metal_atomic_t if it holds an
+ * expected value, w/ sequentially consistent ordering
+ *
+ * @param a The pointer to the value
+ * @param expected The expected value, updated w/ the current value on
+ * failure
+ * @param desired The value to store if the current value is the expected one
+ *
+ * @return 1 if the value has been replaced, 0 otherwise
+ */
+__inline__ int metal_atomic_cas(metal_atomic_t *a, int32_t *expected,
+                                int32_t desired) {
+    return metal_atomic_cas_explicit(a, expected, desired,
+                                     METAL_ATOMIC_SEQ_CST);
+}
+
+#if __riscv_xlen == 64
+/* Define a relaxed 64-bit operation */
+#define _METAL_ATOMIC64_RELAXED_DEFINE(op, value_t)                            \
+    __inline__ value_t metal_atomic64_##op(metal_atomic64_t *a,                \
+                                           value_t value) {                    \
+        return metal_atomic64_##op##_explicit(a, value, METAL_ATOMIC_RELAXED); \
+    }
+
+#define _METAL_ATOMIC64_RELAXED_OPS(OP)                                        \
+    OP(add, int64_t)                                                           \
+    OP(and, int64_t)                                                           \
+    OP(or, int64_t)                                                            \
+    OP(xor, int64_t)                                                           \
+    OP(swap, int64_t)                                                          \
+    OP(max, int64_t)                                                           \
+    OP(max_u, uint64_t)                                                        \
+    OP(min, int64_t)                                                           \
+    OP(min_u, uint64_t)
+
+/*!
+ * @fn metal_atomic64_add
+ * @brief Atomically apply an operation to a metal_atomic64_t and return its
+ * old value
+ *
+ * metal_atomic64_{add,and,or,xor,swap,max,max_u,min,min_u} behave as the
+ * 32-bit functions of the same name, w/ 64-bit operands.
+ *
+ * @param a The pointer to the value
+ * @param value The operand of the operation
+ *
+ * @return The previous value of the metal_atomic64_t
+ */
+_METAL_ATOMIC64_RELAXED_OPS(_METAL_ATOMIC64_RELAXED_DEFINE)
+
+/*!
+ * @brief Atomically replace the value of a metal_atomic64_t if it holds an
+ * expected value, w/ sequentially consistent ordering
+ *
+ * @param a The pointer to the value
+ * @param expected The expected value, updated w/ the current value on
+ * failure
+ * @param desired The value to store if the current value is the expected one
+ *
+ * @return 1 if the value has been replaced, 0 otherwise
+ */
+__inline__ int metal_atomic64_cas(metal_atomic64_t *a, int64_t *expected,
+                                  int64_t desired) {
+    return metal_atomic64_cas_explicit(a, expected, desired,
+                                       METAL_ATOMIC_SEQ_CST);
+}
+#endif
+
 #endif /* METAL__ATOMIC_H */
@@ -9,8 +9,24 @@
  *
  * @brief API for configuring caches
  */
+#include <stddef.h>
 #include <stdint.h>
 
+#ifndef METAL_DCACHE_L1_LINE_SIZE
+/*!
+ * @brief Size of a L1 dcache line, in bytes
+ */
+#define METAL_DCACHE_L1_LINE_SIZE 64u
+#endif
+
+#ifndef METAL_DCACHE_L1_RANGE_MAX
+/*!
+ * @brief Largest range maintained line by line, in bytes
+ * Larger ranges fall back to a maintenance of the whole L1 dcache
+ */
+#define METAL_DCACHE_L1_RANGE_MAX 32768u
+#endif
+
 /*!
  * @brief a handle for a cache
  * Note: To be deprecated in next release.
@@ -98,6 +114,52 @@ void metal_dcache_l1_flush(int hartid, uintptr_t address);
  */
 void metal_dcache_l1_discard(int hartid, uintptr_t address);
 
+/*!
+ * @brief Flush a range of dcache for L1 on the requested core with write back
+ *
+ * Every line which overlaps the range is written back and invalidated,
+ * e.g. before a DMA engine reads from memory. Ranges larger than
+ * METAL_DCACHE_L1_RANGE_MAX flush the whole L1 dcache.
+ * @param hartid The core to flush
+ * @param start  The virtual address of the first byte of the range
+ * @param len    The size of the range, in bytes
+ * @return None
+ */
+void metal_dcache_l1_flush_range(int hartid, uintptr_t start, size_t len);
+
+/*!
+ * @brief Discard a range of dcache for L1 on the requested core
+ *
+ * Lines which are fully covered by the range are invalidated with no write
+ * back, e.g. before a DMA engine writes to memory. Partially covered lines
+ * at either end are flushed instead, so that neighbouring data is
+ * preserved. Ranges larger than METAL_DCACHE_L1_RANGE_MAX flush the whole
+ * L1 dcache.
+ * @param hartid The core to discard
+ * @param start  The virtual address of the first byte of the range
+ * @param len    The size of the range, in bytes
+ * @return None
+ */
+void metal_dcache_l1_discard_range(int hartid, uintptr_t start, size_t len);
+
+/*!
+ * @brief Invalidate a range of dcache for L1 on the requested core
+ *
+ * Every line which overlaps the range, including partially covered lines at
+ * either end, is invalidated with no write back, e.g. after a DMA engine
+ * writes to memory. Neighbouring data which shares a line with the range is
+ * reloaded from memory: it should have been written back beforehand, e.g.
+ * with metal_dcache_l1_discard_range, and not written to since, as such
+ * writes are lost. Ranges larger than METAL_DCACHE_L1_RANGE_MAX flush the
+ * whole L1 dcache.
+ * @param hartid The core to invalidate
+ * @param start  The virtual address of the first byte of the range
+ * @param len    The size of the range, in bytes
+ * @return None
+ */
+void metal_dcache_l1_invalidate_range(int hartid, uintptr_t start,
+                                      size_t len);
+
 /*!
  * @brief Check if icache is supported on the core
  * @param hartid The core to check
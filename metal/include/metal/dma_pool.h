@@ -0,0 +1,95 @@
+/* Copyright 2020 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#ifndef METAL__DMA_POOL_H
+#define METAL__DMA_POOL_H
+
+/*!
+ * @file dma_pool.h
+ * @brief An API for sharing a bounded pool of DMA buffers
+ *
+ * Blocks are carved from a caller-provided arena, which should be mapped in
+ * a single readable and writable memory block of the device tree. Block
+ * sizes are rounded up to a power of two size class, with one free list per
+ * class. A larger free block is split in halves on demand, so allocation
+ * runs in constant time. A released block is merged back with its other half,
+ * its buddy, whenever the buddy is free, so that small requests do not
+ * permanently fragment the largest blocks; release walks the free list of
+ * each class it merges into.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <metal/lock.h>
+
+#ifndef METAL_DMA_POOL_ALIGNMENT
+/*!
+ * @brief Alignment and size of the smallest block, in bytes
+ * Should be a power of two, at least as large as a pointer
+ */
+#define METAL_DMA_POOL_ALIGNMENT 32u
+#endif
+
+#ifndef METAL_DMA_POOL_CLASSES
+/*!
+ * @brief Count of size classes
+ * The largest block is METAL_DMA_POOL_ALIGNMENT << (METAL_DMA_POOL_CLASSES-1)
+ */
+#define METAL_DMA_POOL_CLASSES 10u
+#endif
+
+/*!
+ * @brief Size of the largest block, in bytes
+ */
+#define METAL_DMA_POOL_MAX_SIZE                                                \
+    (((size_t)METAL_DMA_POOL_ALIGNMENT) << (METAL_DMA_POOL_CLASSES - 1u))
+
+/*!
+ * @brief A handle for a DMA buffer pool
+ *
+ * As the pool is protected with a lock, the handle should be placed in a
+ * memory region which supports atomic memory operations.
+ */
+struct metal_dma_pool {
+    struct metal_lock _lock;
+    uintptr_t _base; /* start of the arena, buddies are paired from it */
+    void *_free[METAL_DMA_POOL_CLASSES];
+};
+
+/*!
+ * @brief Initialize a DMA buffer pool
+ * @param pool The handle for the pool
+ * @param arena The memory to hand out, aligned on METAL_DMA_POOL_ALIGNMENT
+ *              or trimmed to it
+ * @param size The size of the arena, in bytes
+ * @return 0 if the pool is successfully initialized, 1 if the arena does not
+ * hold a single block once aligned, 2 if it is not entirely mapped in a
+ * single memory block of __metal_memory_table, 3 if this memory block is not
+ * readable and writable, 4 if the pool lock cannot be initialized, i.e. the
+ * handle is not in a memory which supports atomic memory operations.
+ *
+ * The arena is carved into blocks of the largest size class, the remainder
+ * into smaller blocks. To get a METAL_DMA_POOL_MAX_SIZE block while smaller
+ * blocks are in use, the arena should be larger than this size.
+ */
+int metal_dma_pool_init(struct metal_dma_pool *pool, void *arena,
+                        size_t size);
+
+/*!
+ * @brief Allocate a block from a DMA buffer pool
+ * @param pool The handle for the pool
+ * @param size The requested size, in bytes
+ * @return A block aligned on METAL_DMA_POOL_ALIGNMENT, or NULL if size is
+ * zero, larger than METAL_DMA_POOL_MAX_SIZE or if the pool is exhausted
+ */
+void *metal_dma_pool_alloc(struct metal_dma_pool *pool, size_t size);
+
+/*!
+ * @brief Give a block back to a DMA buffer pool
+ * @param pool The handle for the pool
+ * @param ptr The block to release, or NULL
+ * @param size The size which was requested on allocation
+ */
+void metal_dma_pool_free(struct metal_dma_pool *pool, void *ptr, size_t size);
+
+#endif /* METAL__DMA_POOL_H */
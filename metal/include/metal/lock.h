@@ -4,6 +4,7 @@
 #ifndef METAL__LOCK_H
 #define METAL__LOCK_H
 
+#include <string.h>
 #include <metal/compiler.h>
 #include <metal/machine.h>
 #include <metal/memory.h>
@@ -19,37 +20,167 @@
 #define METAL_LOCK_BACKOFF_CYCLES 32
 #define METAL_LOCK_BACKOFF_EXPONENT 2
 
+/* Largest count of locks printed by metal_lock_stats_dump */
+#define METAL_LOCK_STATS_DUMP_MAX 16
+
+/* Fields on which harts spin are kept on their own cache line */
+#ifndef METAL_LOCK_LINE_SIZE
+#define METAL_LOCK_LINE_SIZE 64
+#endif
+
+/* Writer bit of a reader-writer lock, lower bits count the readers */
+#define _METAL_RWLOCK_WRITER 0x80000000u
+
+#if __riscv_xlen == 64
+#define _METAL_LOCK_AMO_PTR "d"
+#else
+#define _METAL_LOCK_AMO_PTR "w"
+#endif
+
 /*!
  * @def METAL_LOCK_DECLARE
  * @brief Declare a lock
  *
  * Locks must be declared with METAL_LOCK_DECLARE to ensure that the lock
  * is linked into a memory region which supports atomic memory operations.
+ *
+ * The .data.locks section only holds struct metal_lock objects, so that
+ * the statistics of all the declared locks can be walked when
+ * METAL_LOCK_STATS is defined. Other lock flavours use sub-sections.
  */
 #define METAL_LOCK_DECLARE(name)                                               \
     __attribute__((section(".data.locks"))) struct metal_lock name
 
+/*!
+ * @def METAL_TICKET_LOCK_DECLARE
+ * @brief Declare a ticket lock
+ *
+ * Ticket locks follow the same placement rules as locks declared with
+ * METAL_LOCK_DECLARE.
+ */
+#define METAL_TICKET_LOCK_DECLARE(name)                                        \
+    __attribute__((section(".data.locks.ticket")))                             \
+    struct metal_ticket_lock name
+
+/*!
+ * @def METAL_MCS_LOCK_DECLARE
+ * @brief Declare a MCS queue lock
+ *
+ * MCS locks follow the same placement rules as locks declared with
+ * METAL_LOCK_DECLARE. The queue nodes should also live in a memory region
+ * which supports atomic memory operations.
+ */
+#define METAL_MCS_LOCK_DECLARE(name)                                           \
+    __attribute__((section(".data.locks.mcs")))                                \
+    struct metal_mcs_lock name
+
+/*!
+ * @def METAL_RWLOCK_DECLARE
+ * @brief Declare a reader-writer lock
+ *
+ * Reader-writer locks follow the same placement rules as locks declared
+ * with METAL_LOCK_DECLARE.
+ */
+#define METAL_RWLOCK_DECLARE(name)                                             \
+    __attribute__((section(".data.locks.rwlock")))                             \
+    struct metal_rwlock name
+
+/*!
+ * @def METAL_SEQLOCK_DECLARE
+ * @brief Declare a sequence lock
+ *
+ * Sequence locks follow the same placement rules as locks declared with
+ * METAL_LOCK_DECLARE.
+ */
+#define METAL_SEQLOCK_DECLARE(name)                                            \
+    __attribute__((section(".data.locks.seqlock")))                            \
+    struct metal_seqlock name
+
+#ifdef METAL_LOCK_STATS
+/*!
+ * @brief Contention statistics of a lock, in mcycle cycles
+ *
+ * Statistics are only updated by the lock holder, w/o atomics.
+ */
+struct metal_lock_stats {
+    uint64_t _acquisitions; /* count of takes */
+    uint64_t _spins;        /* count of failed attempts to take the lock */
+    uint64_t _wait_total;   /* cycles spent taking the lock */
+    uint64_t _hold_total;   /* cycles spent holding the lock */
+    unsigned long _wait_max;
+    unsigned long _hold_max;
+    unsigned long _hold_start;
+};
+#endif
+
 /*!
  * @brief A handle for a lock
  */
 struct metal_lock {
     int _state;
+#ifdef METAL_LOCK_STATS
+    struct metal_lock_stats _stats;
+#endif
 };
 
 /*!
- * @brief Initialize a lock
- * @param lock The handle for a lock
- * @return 0 if the lock is successfully initialized. A non-zero code indicates
- * failure.
+ * @brief A handle for a ticket lock
  *
- * If the lock cannot be initialized, attempts to take or give the lock
- * will result in a Store/AMO access fault.
+ * Harts are granted the lock in the order they asked for it. Waiters only
+ * read the owner ticket, which is written once per handoff.
  */
-__inline__ int metal_lock_init(struct metal_lock *lock) {
+struct metal_ticket_lock {
+    unsigned int _next;
+    volatile unsigned int _owner
+        __attribute__((aligned(METAL_LOCK_LINE_SIZE)));
+};
+
+/*!
+ * @brief A waiter node of a MCS queue lock
+ *
+ * Each hart which takes the lock provides its own node, which it keeps
+ * until it gives the lock back. A waiter only spins on its own node.
+ */
+struct metal_mcs_node {
+    struct metal_mcs_node *volatile _next;
+    volatile int _locked;
+} __attribute__((aligned(METAL_LOCK_LINE_SIZE)));
+
+/*!
+ * @brief A handle for a MCS queue lock
+ */
+struct metal_mcs_lock {
+    struct metal_mcs_node *_tail;
+};
+
+/*!
+ * @brief A handle for a reader-writer lock
+ *
+ * Any number of readers may hold the lock at once. A writer excludes both
+ * readers and other writers; once it asks for the lock, new readers wait.
+ */
+struct metal_rwlock {
+    volatile unsigned int _state;
+};
+
+/*!
+ * @brief A handle for a sequence lock
+ *
+ * Readers never write to the lock: they read the protected data, then
+ * retry if a writer updated it meanwhile. Writers are serialized with a
+ * regular lock.
+ */
+struct metal_seqlock {
+    volatile unsigned int _seq;
+    struct metal_lock _lock;
+};
+
+/* Check that a lock lives in a memory which supports atomics */
+__inline__ int _metal_lock_check(const volatile void *state) {
 #ifdef __riscv_atomic
     /* Get a handle for the memory which holds the lock state */
     struct metal_memory *lock_mem =
-        metal_get_memory_from_address((uintptr_t) & (lock->_state));
+        metal_get_memory_from_address((uintptr_t)state);
     if (!lock_mem) {
         return 1;
     }
@@ -59,14 +190,94 @@ __inline__ int metal_lock_init(struct metal_lock *lock) {
         return 2;
     }
 
-    lock->_state = 0;
-
     return 0;
 #else
     return 3;
 #endif
 }
 
+/*!
+ * @brief Initialize a lock
+ * @param lock The handle for a lock
+ * @return 0 if the lock is successfully initialized. A non-zero code indicates
+ * failure.
+ *
+ * If the lock cannot be initialized, attempts to take or give the lock
+ * will result in a Store/AMO access fault.
+ */
+__inline__ int metal_lock_init(struct metal_lock *lock) {
+    int rc = _metal_lock_check(&lock->_state);
+    if (rc) {
+        return rc;
+    }
+
+    lock->_state = 0;
+#ifdef METAL_LOCK_STATS
+    memset(&lock->_stats, 0, sizeof(lock->_stats));
+#endif
+
+    return 0;
+}
+
+#ifdef METAL_LOCK_STATS
+__inline__ unsigned long _metal_lock_cycles(void) {
+    unsigned long cycles;
+    __asm__ volatile("csrr %0, mcycle" : "=r"(cycles));
+    return cycles;
+}
+
+/* Account for a take, once the lock is held */
+__inline__ void _metal_lock_stats_taken(struct metal_lock *lock,
+                                        unsigned long start,
+                                        unsigned long spins) {
+    struct metal_lock_stats *stats = &lock->_stats;
+    unsigned long now = _metal_lock_cycles();
+    unsigned long wait = now - start;
+
+    stats->_acquisitions++;
+    stats->_spins += spins;
+    stats->_wait_total += wait;
+    if (wait > stats->_wait_max) {
+        stats->_wait_max = wait;
+    }
+    stats->_hold_start = now;
+}
+
+/* Account for the hold time, while the lock is still held */
+__inline__ void _metal_lock_stats_given(struct metal_lock *lock) {
+    struct metal_lock_stats *stats = &lock->_stats;
+    unsigned long hold = _metal_lock_cycles() - stats->_hold_start;
+
+    stats->_hold_total += hold;
+    if (hold > stats->_hold_max) {
+        stats->_hold_max = hold;
+    }
+}
+
+/*!
+ * @brief Retrieve the most contended locks declared with METAL_LOCK_DECLARE
+ * @param locks Updated with the locks, by decreasing total wait time
+ * @param count The size of the locks array
+ * @return The count of locks stored in the array, i.e. the count of taken
+ * locks, up to count
+ *
+ * Only available when METAL_LOCK_STATS is defined.
+ */
+size_t metal_lock_stats_top(struct metal_lock **locks, size_t count);
+
+/*!
+ * @brief Print the statistics of the most contended locks declared with
+ * METAL_LOCK_DECLARE
+ * @param count The largest count of locks to print, up to
+ * METAL_LOCK_STATS_DUMP_MAX
+ *
+ * Locks are identified by their address, see the map file of the
+ * application for their names. Only available when METAL_LOCK_STATS is
+ * defined.
+ */
+void metal_lock_stats_dump(size_t count);
+#endif
+
 /*!
  * @brief Take a lock
  * @param lock The handle for a lock
@@ -83,6 +294,11 @@ __inline__ int metal_lock_take(struct metal_lock *lock) {
     int backoff = 1;
     const int max_backoff = METAL_LOCK_BACKOFF_CYCLES * METAL_MAX_CORES;
 
+#ifdef METAL_LOCK_STATS
+    unsigned long start = _metal_lock_cycles();
+    unsigned long spins = 0;
+#endif
+
     while (1) {
         __asm__ volatile("amoswap.w.aq %[old], %[new], (%[state])"
                          : [old] "=r"(old)
@@ -93,6 +309,10 @@ __inline__ int metal_lock_take(struct metal_lock *lock) {
             break;
         }
 
+#ifdef METAL_LOCK_STATS
+        spins++;
+#endif
+
         for (int i = 0; i < backoff; i++) {
             __asm__ volatile("");
         }
@@ -102,6 +322,10 @@ __inline__ int metal_lock_take(struct metal_lock *lock) {
         }
     }
 
+#ifdef METAL_LOCK_STATS
+    _metal_lock_stats_taken(lock, start, spins);
+#endif
+
     return 0;
 #else
     /* Store the memory address in mtval like a normal store/amo access fault */
@@ -125,6 +349,10 @@ __inline__ int metal_lock_take(struct metal_lock *lock) {
  */
 __inline__ int metal_lock_give(struct metal_lock *lock) {
 #ifdef __riscv_atomic
+#ifdef METAL_LOCK_STATS
+    _metal_lock_stats_given(lock);
+#endif
+
     __asm__ volatile(
         "amoswap.w.rl x0, x0, (%[state])" ::[state] "r"(&(lock->_state))
         : "memory");
@@ -142,4 +370,450 @@ __inline__ int metal_lock_give(struct metal_lock *lock) {
 #endif
 }
 
+/*!
+ * @brief Initialize a ticket lock
+ * @param lock The handle for a ticket lock
+ * @return 0 if the lock is successfully initialized. A non-zero code indicates
+ * failure.
+ *
+ * If the lock cannot be initialized, attempts to take or give the lock
+ * will result in a Store/AMO access fault.
+ */
+__inline__ int metal_ticket_lock_init(struct metal_ticket_lock *lock) {
+    int rc = _metal_lock_check(&lock->_next);
+    if (rc) {
+        return rc;
+    }
+
+    lock->_next = 0;
+    lock->_owner = 0;
+
+    return 0;
+}
+
+/*!
+ * @brief Take a ticket lock
+ * @param lock The handle for a ticket lock
+ * @return 0 if the lock is successfully taken
+ *
+ * Waiters back off in proportion to their distance to the owner ticket,
+ * so that the owner line is only polled when the lock may be available.
+ */
+__inline__ int metal_ticket_lock_take(struct metal_ticket_lock *lock) {
+#ifdef __riscv_atomic
+    unsigned int ticket;
+    __asm__ volatile("amoadd.w %[ticket], %[one], (%[next])"
+                     : [ticket] "=r"(ticket)
+                     : [one] "r"(1), [next] "r"(&(lock->_next))
+                     : "memory");
+
+    while (1) {
+        unsigned int distance = ticket - lock->_owner;
+        if (distance == 0) {
+            break;
+        }
+
+        for (unsigned int i = 0; i < distance * METAL_LOCK_BACKOFF_CYCLES;
+             i++) {
+            __asm__ volatile("");
+        }
+    }
+
+    __asm__ volatile("fence r, rw" ::: "memory");
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_next)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Give back a held ticket lock
+ * @param lock The handle for a ticket lock
+ * @return 0 if the lock is successfully given
+ */
+__inline__ int metal_ticket_lock_give(struct metal_ticket_lock *lock) {
+#ifdef __riscv_atomic
+    /* Only the owner updates the owner ticket */
+    unsigned int owner = lock->_owner + 1;
+
+    __asm__ volatile("fence rw, w" ::: "memory");
+    lock->_owner = owner;
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_owner)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Initialize a MCS queue lock
+ * @param lock The handle for a MCS lock
+ * @return 0 if the lock is successfully initialized. A non-zero code indicates
+ * failure.
+ *
+ * If the lock cannot be initialized, attempts to take or give the lock
+ * will result in a Store/AMO access fault.
+ */
+__inline__ int metal_mcs_lock_init(struct metal_mcs_lock *lock) {
+    int rc = _metal_lock_check(&lock->_tail);
+    if (rc) {
+        return rc;
+    }
+
+    lock->_tail = NULL;
+
+    return 0;
+}
+
+/*!
+ * @brief Take a MCS queue lock
+ * @param lock The handle for a MCS lock
+ * @param node The queue node of the calling hart, owned by the lock until
+ * it is given back
+ * @return 0 if the lock is successfully taken
+ *
+ * Waiters are queued in arrival order, each one spinning on its own node,
+ * so that a handoff only touches the cache line of the next waiter.
+ */
+__inline__ int metal_mcs_lock_take(struct metal_mcs_lock *lock,
+                                   struct metal_mcs_node *node) {
+#ifdef __riscv_atomic
+    struct metal_mcs_node *pred;
+
+    node->_next = NULL;
+    node->_locked = 1;
+
+    /* Release the node initialization, acquire the previous tail */
+    __asm__ volatile("amoswap." _METAL_LOCK_AMO_PTR
+                     ".aqrl %[pred], %[node], (%[tail])"
+                     : [pred] "=r"(pred)
+                     : [node] "r"(node), [tail] "r"(&(lock->_tail))
+                     : "memory");
+
+    if (pred) {
+        pred->_next = node;
+        while (node->_locked) {
+            __asm__ volatile("");
+        }
+        __asm__ volatile("fence r, rw" ::: "memory");
+    }
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_tail)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Give back a held MCS queue lock
+ * @param lock The handle for a MCS lock
+ * @param node The queue node used to take the lock
+ * @return 0 if the lock is successfully given
+ */
+__inline__ int metal_mcs_lock_give(struct metal_mcs_lock *lock,
+                                   struct metal_mcs_node *node) {
+#ifdef __riscv_atomic
+    struct metal_mcs_node *next = node->_next;
+
+    if (!next) {
+        /* No known successor: release the lock if the node is the tail */
+        struct metal_mcs_node *tail;
+        int fail;
+        __asm__ volatile("1: lr." _METAL_LOCK_AMO_PTR " %[tail], (%[lock])\n"
+                         "   bne %[tail], %[node], 2f\n"
+                         "   sc." _METAL_LOCK_AMO_PTR
+                         ".rl %[fail], zero, (%[lock])\n"
+                         "   bnez %[fail], 1b\n"
+                         "2:"
+                         : [tail] "=&r"(tail), [fail] "=&r"(fail)
+                         : [node] "r"(node), [lock] "r"(&(lock->_tail))
+                         : "memory");
+        if (tail == node) {
+            return 0;
+        }
+
+        /* A successor is being queued, wait for it to link its node */
+        while (!(next = node->_next)) {
+            __asm__ volatile("");
+        }
+    }
+
+    __asm__ volatile("fence rw, w" ::: "memory");
+    next->_locked = 0;
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_tail)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Initialize a reader-writer lock
+ * @param lock The handle for a reader-writer lock
+ * @return 0 if the lock is successfully initialized. A non-zero code indicates
+ * failure.
+ *
+ * If the lock cannot be initialized, attempts to take or give the lock
+ * will result in a Store/AMO access fault.
+ */
+__inline__ int metal_rwlock_init(struct metal_rwlock *lock) {
+    int rc = _metal_lock_check(&lock->_state);
+    if (rc) {
+        return rc;
+    }
+
+    lock->_state = 0;
+
+    return 0;
+}
+
+/*!
+ * @brief Take a reader-writer lock for reading
+ * @param lock The handle for a reader-writer lock
+ * @return 0 if the lock is successfully taken
+ */
+__inline__ int metal_rwlock_read_take(struct metal_rwlock *lock) {
+#ifdef __riscv_atomic
+    unsigned int old;
+
+    while (1) {
+        __asm__ volatile("amoadd.w.aq %[old], %[one], (%[state])"
+                         : [old] "=r"(old)
+                         : [one] "r"(1), [state] "r"(&(lock->_state))
+                         : "memory");
+        if (!(old & _METAL_RWLOCK_WRITER)) {
+            break;
+        }
+
+        /* Step back, and only poll until the writer is gone */
+        __asm__ volatile("amoadd.w x0, %[minus_one], (%[state])"
+                         :
+                         : [minus_one] "r"(-1), [state] "r"(&(lock->_state))
+                         : "memory");
+        while (lock->_state & _METAL_RWLOCK_WRITER) {
+            __asm__ volatile("");
+        }
+    }
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_state)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Give back a reader-writer lock held for reading
+ * @param lock The handle for a reader-writer lock
+ * @return 0 if the lock is successfully given
+ */
+__inline__ int metal_rwlock_read_give(struct metal_rwlock *lock) {
+#ifdef __riscv_atomic
+    __asm__ volatile("amoadd.w.rl x0, %[minus_one], (%[state])"
+                     :
+                     : [minus_one] "r"(-1), [state] "r"(&(lock->_state))
+                     : "memory");
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_state)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Take a reader-writer lock for writing
+ * @param lock The handle for a reader-writer lock
+ * @return 0 if the lock is successfully taken
+ *
+ * The writer bit is claimed first, so that no new reader gets in, then the
+ * current readers are drained.
+ */
+__inline__ int metal_rwlock_write_take(struct metal_rwlock *lock) {
+#ifdef __riscv_atomic
+    unsigned int old;
+
+    while (1) {
+        __asm__ volatile("amoor.w.aq %[old], %[writer], (%[state])"
+                         : [old] "=r"(old)
+                         : [writer] "r"(_METAL_RWLOCK_WRITER),
+                           [state] "r"(&(lock->_state))
+                         : "memory");
+        if (!(old & _METAL_RWLOCK_WRITER)) {
+            break;
+        }
+
+        while (lock->_state & _METAL_RWLOCK_WRITER) {
+            __asm__ volatile("");
+        }
+    }
+
+    while (lock->_state & ~_METAL_RWLOCK_WRITER) {
+        __asm__ volatile("");
+    }
+
+    __asm__ volatile("fence r, rw" ::: "memory");
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_state)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Give back a reader-writer lock held for writing
+ * @param lock The handle for a reader-writer lock
+ * @return 0 if the lock is successfully given
+ */
+__inline__ int metal_rwlock_write_give(struct metal_rwlock *lock) {
+#ifdef __riscv_atomic
+    __asm__ volatile("amoand.w.rl x0, %[readers], (%[state])"
+                     :
+                     : [readers] "r"(~_METAL_RWLOCK_WRITER),
+                       [state] "r"(&(lock->_state))
+                     : "memory");
+
+    return 0;
+#else
+    /* Store the memory address in mtval like a normal store/amo access fault */
+    __asm__("csrw mtval, %[state]" ::[state] "r"(&(lock->_state)));
+
+    /* Trigger a Store/AMO access fault */
+    _metal_trap(_METAL_STORE_AMO_ACCESS_FAULT);
+
+    /* If execution returns, indicate failure */
+    return 1;
+#endif
+}
+
+/*!
+ * @brief Initialize a sequence lock
+ * @param lock The handle for a sequence lock
+ * @return 0 if the lock is successfully initialized. A non-zero code indicates
+ * failure.
+ */
+__inline__ int metal_seqlock_init(struct metal_seqlock *lock) {
+    int rc = metal_lock_init(&lock->_lock);
+    if (rc) {
+        return rc;
+    }
+
+    lock->_seq = 0;
+
+    return 0;
+}
+
+/*!
+ * @brief Start reading the data protected by a sequence lock
+ * @param lock The handle for a sequence lock
+ * @return The sequence to give to metal_seqlock_read_retry
+ *
+ * Readers never block writers: the data may change while it is read, so
+ * it should be copied out and only used once metal_seqlock_read_retry
+ * reports that the copy is consistent.
+ */
+__inline__ unsigned int metal_seqlock_read_begin(struct metal_seqlock *lock) {
+    unsigned int seq;
+
+    /* An odd sequence denotes an on-going update */
+    while ((seq = lock->_seq) & 1) {
+        __asm__ volatile("");
+    }
+
+    __asm__ volatile("fence r, r" ::: "memory");
+
+    return seq;
+}
+
+/*!
+ * @brief Check whether the data read since metal_seqlock_read_begin is
+ * consistent
+ * @param lock The handle for a sequence lock
+ * @param seq The sequence returned by metal_seqlock_read_begin
+ * @return 0 if the data is consistent, 1 if it should be read again
+ */
+__inline__ int metal_seqlock_read_retry(struct metal_seqlock *lock,
+                                        unsigned int seq) {
+    __asm__ volatile("fence r, r" ::: "memory");
+
+    return lock->_seq != seq;
+}
+
+/*!
+ * @brief Start updating the data protected by a sequence lock
+ * @param lock The handle for a sequence lock
+ * @return 0 if the lock is successfully taken
+ */
+__inline__ int metal_seqlock_write_begin(struct metal_seqlock *lock) {
+    int rc = metal_lock_take(&lock->_lock);
+    if (rc) {
+        return rc;
+    }
+
+    lock->_seq = lock->_seq + 1;
+    __asm__ volatile("fence w, w" ::: "memory");
+
+    return 0;
+}
+
+/*!
+ * @brief Complete the update of the data protected by a sequence lock
+ * @param lock The handle for a sequence lock
+ * @return 0 if the lock is successfully given
+ */
+__inline__ int metal_seqlock_write_end(struct metal_seqlock *lock) {
+    __asm__ volatile("fence w, w" ::: "memory");
+    lock->_seq = lock->_seq + 1;
+
+    return metal_lock_give(&lock->_lock);
+}
+
 #endif /* METAL__LOCK_H */
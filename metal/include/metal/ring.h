@@ -0,0 +1,149 @@
+/* Copyright 2020 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#ifndef METAL__RING_H
+#define METAL__RING_H
+
+/*!
+ * @file ring.h
+ * @brief Lock-free bounded rings of object pointers
+ *
+ * Rings pass object pointers between harts, or from an interrupt handler
+ * to the main loop, w/o any lock: no caller ever waits for another one, so
+ * that a ring may be used from interrupt context. Enqueue and dequeue
+ * operations move up to a batch of objects at once, and return the count
+ * of objects actually moved.
+ *
+ * The single-producer single-consumer ring only relies on ordered loads
+ * and stores. The multi-producer multi-consumer ring claims slots with a
+ * compare-and-swap, and should be placed in a memory region which supports
+ * atomic memory operations.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <metal/atomic.h>
+
+#ifndef METAL_RING_LINE_SIZE
+/*!
+ * @brief Size of a cache line; indices written by distinct harts are kept
+ * on distinct lines
+ */
+#define METAL_RING_LINE_SIZE 64
+#endif
+
+/*!
+ * @brief A single-producer single-consumer ring
+ *
+ * Each side caches the last index it read from the other side, so that it
+ * only reads the line of the other side when the ring looks full or empty.
+ */
+struct metal_spsc_ring {
+    /* consumer line */
+    metal_atomic_t _head __attribute__((aligned(METAL_RING_LINE_SIZE)));
+    uint32_t _tail_cache;
+    /* producer line */
+    metal_atomic_t _tail __attribute__((aligned(METAL_RING_LINE_SIZE)));
+    uint32_t _head_cache;
+    /* read-only line */
+    void **_slots __attribute__((aligned(METAL_RING_LINE_SIZE)));
+    uint32_t _mask;
+};
+
+/*!
+ * @brief A slot of a multi-producer multi-consumer ring
+ */
+struct metal_mpmc_slot {
+    metal_atomic_t _seq;
+    void *_obj;
+};
+
+/*!
+ * @brief A bounded multi-producer multi-consumer ring
+ *
+ * Each slot carries a sequence number which tells whether it may be filled
+ * or emptied for the current lap, so that producers and consumers never
+ * wait for each other.
+ */
+struct metal_mpmc_ring {
+    metal_atomic_t _enqueue __attribute__((aligned(METAL_RING_LINE_SIZE)));
+    metal_atomic_t _dequeue __attribute__((aligned(METAL_RING_LINE_SIZE)));
+    struct metal_mpmc_slot *_slots
+        __attribute__((aligned(METAL_RING_LINE_SIZE)));
+    uint32_t _mask;
+};
+
+/*!
+ * @brief Initialize a single-producer single-consumer ring
+ * @param ring The handle for the ring
+ * @param slots The storage for the object pointers
+ * @param count The count of slots, a power of two, at least 2
+ * @return 0 if the ring is successfully initialized. A non-zero code
+ * indicates failure.
+ */
+int metal_spsc_ring_init(struct metal_spsc_ring *ring, void **slots,
+                         size_t count);
+
+/*!
+ * @brief Enqueue a batch of objects into a single-producer ring
+ * @param ring The handle for the ring
+ * @param objs The objects to enqueue
+ * @param count The count of objects
+ * @return The count of enqueued objects, less than count if the ring is
+ * full
+ */
+size_t metal_spsc_ring_enqueue(struct metal_spsc_ring *ring,
+                               void *const *objs, size_t count);
+
+/*!
+ * @brief Dequeue a batch of objects from a single-consumer ring
+ * @param ring The handle for the ring
+ * @param objs Updated with the dequeued objects
+ * @param count The largest count of objects to dequeue
+ * @return The count of dequeued objects, less than count if the ring is
+ * empty
+ */
+size_t metal_spsc_ring_dequeue(struct metal_spsc_ring *ring, void **objs,
+                               size_t count);
+
+/*!
+ * @brief Initialize a multi-producer multi-consumer ring
+ * @param ring The handle for the ring
+ * @param slots The storage for the slots
+ * @param count The count of slots, a power of two, at least 2
+ * @return 0 if the ring is successfully initialized. A non-zero code
+ * indicates failure, e.g. if the ring is not in a memory which supports
+ * atomics.
+ */
+int metal_mpmc_ring_init(struct metal_mpmc_ring *ring,
+                         struct metal_mpmc_slot *slots, size_t count);
+
+/*!
+ * @brief Enqueue a batch of objects into a multi-producer ring
+ *
+ * The batch is enqueued in a row, unless the ring fills up, in which case
+ * only its first objects are enqueued.
+ *
+ * @param ring The handle for the ring
+ * @param objs The objects to enqueue
+ * @param count The count of objects
+ * @return The count of enqueued objects
+ */
+size_t metal_mpmc_ring_enqueue(struct metal_mpmc_ring *ring,
+                               void *const *objs, size_t count);
+
+/*!
+ * @brief Dequeue a batch of objects from a multi-consumer ring
+ *
+ * A consumer may get fewer objects than were enqueued if a producer has
+ * claimed slots but not filled them yet.
+ *
+ * @param ring The handle for the ring
+ * @param objs Updated with the dequeued objects
+ * @param count The largest count of objects to dequeue
+ * @return The count of dequeued objects
+ */
+size_t metal_mpmc_ring_dequeue(struct metal_mpmc_ring *ring, void **objs,
+                               size_t count);
+
+#endif /* METAL__RING_H */
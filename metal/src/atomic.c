@@ -17,3 +17,33 @@ extern __inline__ uint32_t metal_atomic_max_u(metal_atomic_t *a,
 extern __inline__ int32_t metal_atomic_min(metal_atomic_t *a, int32_t compare);
 extern __inline__ uint32_t metal_atomic_min_u(metal_atomic_t *a,
                                               uint32_t compare);
+
+#define _METAL_ATOMIC_AMO_EXTERN(name, insn, atomic_t, value_t)                \
+    extern __inline__ value_t name(atomic_t *a, value_t value,                 \
+                                   metal_atomic_order_t order);
+#define _METAL_ATOMIC_CAS_EXTERN(name, width, atomic_t, value_t)               \
+    extern __inline__ int name(atomic_t *a, value_t *expected,                 \
+                               value_t desired, metal_atomic_order_t order);
+#define _METAL_ATOMIC_LOAD_STORE_EXTERN(load, store, atomic_t, value_t)        \
+    extern __inline__ value_t load(atomic_t *a, metal_atomic_order_t order);   \
+    extern __inline__ void store(atomic_t *a, value_t value,                   \
+                                 metal_atomic_order_t order);
+
+_METAL_ATOMIC32_OPS(_METAL_ATOMIC_AMO_EXTERN, _METAL_ATOMIC_CAS_EXTERN,
+                    _METAL_ATOMIC_LOAD_STORE_EXTERN)
+_METAL_ATOMIC64_OPS(_METAL_ATOMIC_AMO_EXTERN, _METAL_ATOMIC_CAS_EXTERN,
+                    _METAL_ATOMIC_LOAD_STORE_EXTERN)
+
+extern __inline__ int metal_atomic_cas(metal_atomic_t *a, int32_t *expected,
+                                       int32_t desired);
+
+#if __riscv_xlen == 64
+#define _METAL_ATOMIC64_RELAXED_EXTERN(op, value_t)                            \
+    extern __inline__ value_t metal_atomic64_##op(metal_atomic64_t *a,         \
+                                                  value_t value);
+
+_METAL_ATOMIC64_RELAXED_OPS(_METAL_ATOMIC64_RELAXED_EXTERN)
+
+extern __inline__ int metal_atomic64_cas(metal_atomic64_t *a,
+                                         int64_t *expected, int64_t desired);
+#endif
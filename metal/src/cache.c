@@ -164,17 +164,18 @@ void metal_dcache_l1_flush(int hartid, uintptr_t address) {
     if (metal_dcache_l1_available(hartid)) {
         if (address) {
             uintptr_t ms1 = 0, ms2 = 0;
+            register uintptr_t a0 __asm__("a0") = address;
             __asm__ __volatile__("csrr %0, mtvec \n\t"
                                  "la %1, 1f \n\t"
                                  "csrw mtvec, %1 \n\t"
-                                 ".insn i 0x73, 0, x0, %2, -0x40 \n\t"
+                                 ".word 0xfc050073 \n\t"
                                  ".align 2\n\t"
                                  "1: \n\t"
                                  "csrw mtvec, %0 \n\t"
                                  : "+r"(ms1), "+r"(ms2)
-                                 : "r"(address));
-            // Using ‘.insn’ pseudo directive:
-            //       '.insn i opcode, func3, rd, rs1, simm12'
+                                 : "r"(a0));
+            /* rs1 is pinned to a0 (x10), as the '.insn' pseudo directive
+             * is not supported by the clang integrated assembler */
         } else {
             __asm__ __volatile__(".word 0xfc000073" : : : "memory");
         }
@@ -203,19 +204,130 @@ void metal_dcache_l1_discard(int hartid, uintptr_t address) {
     if (metal_dcache_l1_available(hartid)) {
         if (address) {
             uintptr_t ms1 = 0, ms2 = 0;
+            register uintptr_t a0 __asm__("a0") = address;
             __asm__ __volatile__("csrr %0, mtvec \n\t"
                                  "la %1, 1f \n\t"
                                  "csrw mtvec, %1 \n\t"
-                                 ".insn i 0x73, 0, x0, %2, -0x3E \n\t"
+                                 ".word 0xfc250073 \n\t"
                                  ".align 2\n\t"
                                  "1: \n\t"
                                  "csrw mtvec, %0 \n\t"
                                  : "+r"(ms1), "+r"(ms2)
-                                 : "r"(address));
-            // Using ‘.insn’ pseudo directive:
-            //       '.insn i opcode, func3, rd, rs1, simm12'
+                                 : "r"(a0));
+            /* rs1 is pinned to a0 (x10), as the '.insn' pseudo directive
+             * is not supported by the clang integrated assembler */
         } else {
             __asm__ __volatile__(".word 0xfc200073" : : : "memory");
         }
     }
 }
+
+/*!
+ * @brief Write back and invalidate the L1 D$ lines in [first, end)
+ *
+ * The trap guard is installed once for the whole range: if CFLUSH.D.L1 is
+ * not implemented, the first instruction traps and the loop is abandoned.
+ * Machine interrupts are masked meanwhile, as any trap would be rerouted.
+ */
+static void metal_dcache_l1_flush_lines(uintptr_t first, uintptr_t end) {
+    uintptr_t ms1, ms2, mstatus;
+    register uintptr_t a0 __asm__("a0") = first;
+    __asm__ __volatile__("csrrci %2, mstatus, 8 \n\t"
+                         "csrr %0, mtvec \n\t"
+                         "la %1, 2f \n\t"
+                         "csrw mtvec, %1 \n\t"
+                         "1: \n\t"
+                         ".word 0xfc050073 \n\t"
+                         "add %3, %3, %5 \n\t"
+                         "bltu %3, %4, 1b \n\t"
+                         ".align 2\n\t"
+                         "2: \n\t"
+                         "csrw mtvec, %0 \n\t"
+                         "csrw mstatus, %2 \n\t"
+                         : "=&r"(ms1), "=&r"(ms2), "=&r"(mstatus), "+r"(a0)
+                         : "r"(end), "r"(METAL_DCACHE_L1_LINE_SIZE)
+                         : "memory");
+}
+
+/*!
+ * @brief Invalidate the L1 D$ lines in [first, end), with no write back
+ *
+ * Same trap guard as #metal_dcache_l1_flush_lines
+ */
+static void metal_dcache_l1_discard_lines(uintptr_t first, uintptr_t end) {
+    uintptr_t ms1, ms2, mstatus;
+    register uintptr_t a0 __asm__("a0") = first;
+    __asm__ __volatile__("csrrci %2, mstatus, 8 \n\t"
+                         "csrr %0, mtvec \n\t"
+                         "la %1, 2f \n\t"
+                         "csrw mtvec, %1 \n\t"
+                         "1: \n\t"
+                         ".word 0xfc250073 \n\t"
+                         "add %3, %3, %5 \n\t"
+                         "bltu %3, %4, 1b \n\t"
+                         ".align 2\n\t"
+                         "2: \n\t"
+                         "csrw mtvec, %0 \n\t"
+                         "csrw mstatus, %2 \n\t"
+                         : "=&r"(ms1), "=&r"(ms2), "=&r"(mstatus), "+r"(a0)
+                         : "r"(end), "r"(METAL_DCACHE_L1_LINE_SIZE)
+                         : "memory");
+}
+
+void metal_dcache_l1_flush_range(int hartid, uintptr_t start, size_t len) {
+    uintptr_t mask = METAL_DCACHE_L1_LINE_SIZE - 1u;
+
+    if (!len || !metal_dcache_l1_available(hartid)) {
+        return;
+    }
+    if (len > METAL_DCACHE_L1_RANGE_MAX) {
+        __asm__ __volatile__(".word 0xfc000073" : : : "memory");
+        return;
+    }
+    metal_dcache_l1_flush_lines(start & ~mask, start + len);
+}
+
+void metal_dcache_l1_discard_range(int hartid, uintptr_t start, size_t len) {
+    uintptr_t mask = METAL_DCACHE_L1_LINE_SIZE - 1u;
+
+    if (!len || !metal_dcache_l1_available(hartid)) {
+        return;
+    }
+    if (len > METAL_DCACHE_L1_RANGE_MAX) {
+        /* a full discard would also drop unrelated dirty lines */
+        __asm__ __volatile__(".word 0xfc000073" : : : "memory");
+        return;
+    }
+
+    uintptr_t end = start + len;
+    uintptr_t first = (start + mask) & ~mask;
+    uintptr_t last = end & ~mask;
+
+    if (first >= last) {
+        /* no full line: only partial lines, which may hold other data */
+        metal_dcache_l1_flush_lines(start & ~mask, end);
+        return;
+    }
+    if (start != first) {
+        metal_dcache_l1_flush_lines(start & ~mask, first);
+    }
+    if (end != last) {
+        metal_dcache_l1_flush_lines(last, end);
+    }
+    metal_dcache_l1_discard_lines(first, last);
+}
+
+void metal_dcache_l1_invalidate_range(int hartid, uintptr_t start,
+                                      size_t len) {
+    uintptr_t mask = METAL_DCACHE_L1_LINE_SIZE - 1u;
+
+    if (!len || !metal_dcache_l1_available(hartid)) {
+        return;
+    }
+    if (len > METAL_DCACHE_L1_RANGE_MAX) {
+        /* a full discard would also drop unrelated dirty lines */
+        __asm__ __volatile__(".word 0xfc000073" : : : "memory");
+        return;
+    }
+    metal_dcache_l1_discard_lines(start & ~mask, start + len);
+}
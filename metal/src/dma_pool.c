@@ -0,0 +1,191 @@
+/* Copyright 2020 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <limits.h>
+#include <metal/dma_pool.h>
+#include <metal/memory.h>
+
+#define METAL_DMA_POOL_SHIFT __builtin_ctz(METAL_DMA_POOL_ALIGNMENT)
+
+/* Machine interrupt enable bit of mstatus */
+#define METAL_DMA_POOL_MSTATUS_MIE 0x8u
+
+/* A free block, linked in the list of its size class */
+struct metal_dma_pool_block {
+    struct metal_dma_pool_block *_next;
+};
+
+/* Size class of a request, or -1 if it is too large */
+static int metal_dma_pool_class(size_t size) {
+    if (size <= METAL_DMA_POOL_ALIGNMENT) {
+        return 0;
+    }
+    if (size > METAL_DMA_POOL_MAX_SIZE) {
+        return -1;
+    }
+    /* smallest power of two which is not less than size */
+    int bits = (int)(sizeof(unsigned long) * CHAR_BIT) -
+               __builtin_clzl((unsigned long)(size - 1u));
+    return bits - METAL_DMA_POOL_SHIFT;
+}
+
+/*
+ * Machine interrupts are masked while the lock is held, so that a block may
+ * be allocated or released from an interrupt handler
+ */
+static unsigned long metal_dma_pool_lock(struct metal_dma_pool *pool) {
+    unsigned long mstatus;
+    __asm__ __volatile__("csrrc %0, mstatus, %1"
+                         : "=r"(mstatus)
+                         : "r"(METAL_DMA_POOL_MSTATUS_MIE)
+                         : "memory");
+    metal_lock_take(&pool->_lock);
+    return mstatus;
+}
+
+static void metal_dma_pool_unlock(struct metal_dma_pool *pool,
+                                  unsigned long mstatus) {
+    metal_lock_give(&pool->_lock);
+    if (mstatus & METAL_DMA_POOL_MSTATUS_MIE) {
+        __asm__ __volatile__("csrs mstatus, %0"
+                             :
+                             : "r"(METAL_DMA_POOL_MSTATUS_MIE)
+                             : "memory");
+    }
+}
+
+static void metal_dma_pool_push(struct metal_dma_pool *pool, int cls,
+                                uintptr_t addr) {
+    struct metal_dma_pool_block *block = (struct metal_dma_pool_block *)addr;
+    block->_next = pool->_free[cls];
+    pool->_free[cls] = block;
+}
+
+static void *metal_dma_pool_pop(struct metal_dma_pool *pool, int cls) {
+    struct metal_dma_pool_block *block = pool->_free[cls];
+    if (block) {
+        pool->_free[cls] = block->_next;
+    }
+    return block;
+}
+
+/* Unlink a block from the free list of its class, if it is free */
+static int metal_dma_pool_take(struct metal_dma_pool *pool, int cls,
+                               uintptr_t addr) {
+    struct metal_dma_pool_block *prev = NULL;
+    struct metal_dma_pool_block *block = pool->_free[cls];
+    while (block) {
+        if ((uintptr_t)block == addr) {
+            if (prev) {
+                prev->_next = block->_next;
+            } else {
+                pool->_free[cls] = block->_next;
+            }
+            return 1;
+        }
+        prev = block;
+        block = block->_next;
+    }
+    return 0;
+}
+
+int metal_dma_pool_init(struct metal_dma_pool *pool, void *arena,
+                        size_t size) {
+    uintptr_t mask = METAL_DMA_POOL_ALIGNMENT - 1u;
+    uintptr_t start = (uintptr_t)arena;
+    uintptr_t base = (start + mask) & ~mask;
+    uintptr_t end = (start + size) & ~mask;
+
+    if (!arena || (base < start) || (end <= base)) {
+        return 1;
+    }
+
+    /* the whole arena should belong to a single DMA-capable memory */
+    struct metal_memory *mem = metal_get_memory_from_address(base);
+    if (!mem || (mem != metal_get_memory_from_address(end - 1u))) {
+        return 2;
+    }
+    if (!mem->_attrs.R || !mem->_attrs.W) {
+        return 3;
+    }
+
+    if (metal_lock_init(&pool->_lock)) {
+        return 4;
+    }
+
+    pool->_base = base;
+    for (unsigned int cls = 0; cls < METAL_DMA_POOL_CLASSES; cls++) {
+        pool->_free[cls] = NULL;
+    }
+
+    /* carve the arena into the largest blocks which are aligned on their
+     * size from the base, so that every block has a single buddy */
+    for (uintptr_t addr = base; addr < end;) {
+        int cls = (int)METAL_DMA_POOL_CLASSES - 1;
+        size_t block_size = METAL_DMA_POOL_MAX_SIZE;
+        while (((addr - base) & (block_size - 1u)) ||
+               ((end - addr) < block_size)) {
+            cls--;
+            block_size >>= 1u;
+        }
+        metal_dma_pool_push(pool, cls, addr);
+        addr += block_size;
+    }
+
+    return 0;
+}
+
+void *metal_dma_pool_alloc(struct metal_dma_pool *pool, size_t size) {
+    int cls = metal_dma_pool_class(size);
+    if (!size || (cls < 0)) {
+        return NULL;
+    }
+
+    unsigned long mstatus = metal_dma_pool_lock(pool);
+
+    void *ptr = metal_dma_pool_pop(pool, cls);
+    if (!ptr) {
+        /* split the smallest larger free block: its upper halves are
+         * released into the lower classes */
+        for (int big = cls + 1; big < (int)METAL_DMA_POOL_CLASSES; big++) {
+            ptr = metal_dma_pool_pop(pool, big);
+            if (ptr) {
+                for (int low = cls; low < big; low++) {
+                    metal_dma_pool_push(
+                        pool, low,
+                        (uintptr_t)ptr +
+                            (((size_t)METAL_DMA_POOL_ALIGNMENT) << low));
+                }
+                break;
+            }
+        }
+    }
+
+    metal_dma_pool_unlock(pool, mstatus);
+
+    return ptr;
+}
+
+void metal_dma_pool_free(struct metal_dma_pool *pool, void *ptr, size_t size) {
+    int cls = metal_dma_pool_class(size);
+    if (!ptr || !size || (cls < 0)) {
+        return;
+    }
+
+    unsigned long mstatus = metal_dma_pool_lock(pool);
+
+    /* merge the block with its buddy as long as the buddy is free */
+    uintptr_t addr = (uintptr_t)ptr;
+    for (; cls < (int)METAL_DMA_POOL_CLASSES - 1; cls++) {
+        uintptr_t buddy = pool->_base + ((addr - pool->_base) ^
+                                         (((size_t)METAL_DMA_POOL_ALIGNMENT)
+                                          << cls));
+        if (!metal_dma_pool_take(pool, cls, buddy)) {
+            break;
+        }
+        addr = (addr < buddy) ? addr : buddy;
+    }
+    metal_dma_pool_push(pool, cls, addr);
+
+    metal_dma_pool_unlock(pool, mstatus);
+}
@@ -2,7 +2,89 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
 #include <metal/lock.h>
+#include <stdio.h>
 
 extern __inline__ int metal_lock_init(struct metal_lock *lock);
 extern __inline__ int metal_lock_take(struct metal_lock *lock);
 extern __inline__ int metal_lock_give(struct metal_lock *lock);
+extern __inline__ int _metal_lock_check(const volatile void *state);
+extern __inline__ int metal_ticket_lock_init(struct metal_ticket_lock *lock);
+extern __inline__ int metal_ticket_lock_take(struct metal_ticket_lock *lock);
+extern __inline__ int metal_ticket_lock_give(struct metal_ticket_lock *lock);
+extern __inline__ int metal_mcs_lock_init(struct metal_mcs_lock *lock);
+extern __inline__ int metal_mcs_lock_take(struct metal_mcs_lock *lock,
+                                          struct metal_mcs_node *node);
+extern __inline__ int metal_mcs_lock_give(struct metal_mcs_lock *lock,
+                                          struct metal_mcs_node *node);
+extern __inline__ int metal_rwlock_init(struct metal_rwlock *lock);
+extern __inline__ int metal_rwlock_read_take(struct metal_rwlock *lock);
+extern __inline__ int metal_rwlock_read_give(struct metal_rwlock *lock);
+extern __inline__ int metal_rwlock_write_take(struct metal_rwlock *lock);
+extern __inline__ int metal_rwlock_write_give(struct metal_rwlock *lock);
+extern __inline__ int metal_seqlock_init(struct metal_seqlock *lock);
+extern __inline__ unsigned int
+metal_seqlock_read_begin(struct metal_seqlock *lock);
+extern __inline__ int metal_seqlock_read_retry(struct metal_seqlock *lock,
+                                               unsigned int seq);
+extern __inline__ int metal_seqlock_write_begin(struct metal_seqlock *lock);
+extern __inline__ int metal_seqlock_write_end(struct metal_seqlock *lock);
+
+#ifdef METAL_LOCK_STATS
+extern __inline__ unsigned long _metal_lock_cycles(void);
+extern __inline__ void _metal_lock_stats_taken(struct metal_lock *lock,
+                                               unsigned long start,
+                                               unsigned long spins);
+extern __inline__ void _metal_lock_stats_given(struct metal_lock *lock);
+
+/* Bounds of the .data.locks section, see the linker script */
+extern struct metal_lock metal_segment_locks_start[];
+extern struct metal_lock metal_segment_locks_end[];
+
+size_t metal_lock_stats_top(struct metal_lock **locks, size_t count) {
+    size_t found = 0;
+
+    for (struct metal_lock *lock = metal_segment_locks_start;
+         lock < metal_segment_locks_end; lock++) {
+        if (!lock->_stats._acquisitions) {
+            continue;
+        }
+
+        /* insertion sort, by decreasing total wait time */
+        uint64_t wait = lock->_stats._wait_total;
+        size_t pos = found;
+        while (pos && (locks[pos - 1]->_stats._wait_total < wait)) {
+            if (pos < count) {
+                locks[pos] = locks[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < count) {
+            locks[pos] = lock;
+            if (found < count) {
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+void metal_lock_stats_dump(size_t count) {
+    struct metal_lock *locks[METAL_LOCK_STATS_DUMP_MAX];
+
+    if (count > METAL_LOCK_STATS_DUMP_MAX) {
+        count = METAL_LOCK_STATS_DUMP_MAX;
+    }
+
+    count = metal_lock_stats_top(locks, count);
+    for (size_t ix = 0; ix < count; ix++) {
+        const struct metal_lock_stats *stats = &locks[ix]->_stats;
+        printf("lock %p: %llu takes, %llu spins, wait %llu (max %lu), "
+               "hold %llu (max %lu) cycles\n",
+               (void *)locks[ix], (unsigned long long)stats->_acquisitions,
+               (unsigned long long)stats->_spins,
+               (unsigned long long)stats->_wait_total, stats->_wait_max,
+               (unsigned long long)stats->_hold_total, stats->_hold_max);
+    }
+}
+#endif
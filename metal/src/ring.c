@@ -0,0 +1,188 @@
+/* Copyright 2020 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <metal/lock.h>
+#include <metal/ring.h>
+
+/* Largest count of slots, so that free-running indices compare properly */
+#define METAL_RING_MAX_COUNT 0x80000000u
+
+static int metal_ring_check_count(size_t count) {
+    return (count < 2u) || (count > METAL_RING_MAX_COUNT) ||
+           (count & (count - 1u));
+}
+
+int metal_spsc_ring_init(struct metal_spsc_ring *ring, void **slots,
+                         size_t count) {
+    if (!ring || !slots || metal_ring_check_count(count)) {
+        return 1;
+    }
+
+    ring->_slots = slots;
+    ring->_mask = (uint32_t)(count - 1u);
+    ring->_head_cache = 0;
+    ring->_tail_cache = 0;
+    metal_atomic_store(&ring->_head, 0, METAL_ATOMIC_RELAXED);
+    metal_atomic_store(&ring->_tail, 0, METAL_ATOMIC_RELAXED);
+
+    return 0;
+}
+
+size_t metal_spsc_ring_enqueue(struct metal_spsc_ring *ring,
+                               void *const *objs, size_t count) {
+    uint32_t size = ring->_mask + 1u;
+    uint32_t tail =
+        (uint32_t)metal_atomic_load(&ring->_tail, METAL_ATOMIC_RELAXED);
+    uint32_t room = size - (tail - ring->_head_cache);
+
+    if (room < count) {
+        /* the consumer may have made room since the last look */
+        ring->_head_cache =
+            (uint32_t)metal_atomic_load(&ring->_head, METAL_ATOMIC_ACQUIRE);
+        room = size - (tail - ring->_head_cache);
+    }
+
+    size_t n = (count < room) ? count : room;
+    for (size_t i = 0; i < n; i++) {
+        ring->_slots[(tail + i) & ring->_mask] = objs[i];
+    }
+
+    if (n) {
+        /* publish the objects */
+        metal_atomic_store(&ring->_tail, (int32_t)(tail + n),
+                           METAL_ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+size_t metal_spsc_ring_dequeue(struct metal_spsc_ring *ring, void **objs,
+                               size_t count) {
+    uint32_t head =
+        (uint32_t)metal_atomic_load(&ring->_head, METAL_ATOMIC_RELAXED);
+    uint32_t avail = ring->_tail_cache - head;
+
+    if (avail < count) {
+        /* the producer may have published objects since the last look */
+        ring->_tail_cache =
+            (uint32_t)metal_atomic_load(&ring->_tail, METAL_ATOMIC_ACQUIRE);
+        avail = ring->_tail_cache - head;
+    }
+
+    size_t n = (count < avail) ? count : avail;
+    for (size_t i = 0; i < n; i++) {
+        objs[i] = ring->_slots[(head + i) & ring->_mask];
+    }
+
+    if (n) {
+        /* give the slots back */
+        metal_atomic_store(&ring->_head, (int32_t)(head + n),
+                           METAL_ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+int metal_mpmc_ring_init(struct metal_mpmc_ring *ring,
+                         struct metal_mpmc_slot *slots, size_t count) {
+    if (!ring || !slots || metal_ring_check_count(count)) {
+        return 1;
+    }
+
+    int rc = _metal_lock_check(&ring->_enqueue);
+    if (!rc) {
+        rc = _metal_lock_check(&ring->_dequeue);
+    }
+    if (rc) {
+        return rc + 1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        metal_atomic_store(&slots[i]._seq, (int32_t)i, METAL_ATOMIC_RELAXED);
+        slots[i]._obj = NULL;
+    }
+
+    ring->_slots = slots;
+    ring->_mask = (uint32_t)(count - 1u);
+    metal_atomic_store(&ring->_enqueue, 0, METAL_ATOMIC_RELAXED);
+    metal_atomic_store(&ring->_dequeue, 0, METAL_ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/*
+ * Claim up to count consecutive slots whose sequence is the index of the
+ * slot plus an offset, i.e. slots which are ready for the current lap
+ */
+static size_t metal_mpmc_ring_claim(struct metal_mpmc_ring *ring,
+                                    metal_atomic_t *index, uint32_t offset,
+                                    size_t count, uint32_t *first) {
+    uint32_t pos = (uint32_t)metal_atomic_load(index, METAL_ATOMIC_RELAXED);
+
+    while (1) {
+        size_t n = 0;
+        int32_t diff = 0;
+        while (n < count) {
+            struct metal_mpmc_slot *slot =
+                &ring->_slots[(pos + n) & ring->_mask];
+            uint32_t seq = (uint32_t)metal_atomic_load(&slot->_seq,
+                                                       METAL_ATOMIC_ACQUIRE);
+            diff = (int32_t)(seq - (pos + n + offset));
+            if (diff) {
+                break;
+            }
+            n++;
+        }
+
+        if (!n && (diff < 0)) {
+            /* full, or empty: the slot is not ready for this lap */
+            return 0;
+        }
+
+        if (!n) {
+            /* another hart has claimed the slot: catch up */
+            pos = (uint32_t)metal_atomic_load(index, METAL_ATOMIC_RELAXED);
+            continue;
+        }
+
+        int32_t expected = (int32_t)pos;
+        if (metal_atomic_cas_explicit(index, &expected, (int32_t)(pos + n),
+                                      METAL_ATOMIC_RELAXED)) {
+            *first = pos;
+            return n;
+        }
+        pos = (uint32_t)expected;
+    }
+}
+
+size_t metal_mpmc_ring_enqueue(struct metal_mpmc_ring *ring,
+                               void *const *objs, size_t count) {
+    uint32_t pos;
+    size_t n = metal_mpmc_ring_claim(ring, &ring->_enqueue, 0, count, &pos);
+
+    for (size_t i = 0; i < n; i++) {
+        struct metal_mpmc_slot *slot = &ring->_slots[(pos + i) & ring->_mask];
+        slot->_obj = objs[i];
+        /* publish the object to consumers */
+        metal_atomic_store(&slot->_seq, (int32_t)(pos + i + 1u),
+                           METAL_ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+size_t metal_mpmc_ring_dequeue(struct metal_mpmc_ring *ring, void **objs,
+                               size_t count) {
+    uint32_t pos;
+    size_t n = metal_mpmc_ring_claim(ring, &ring->_dequeue, 1u, count, &pos);
+
+    for (size_t i = 0; i < n; i++) {
+        struct metal_mpmc_slot *slot = &ring->_slots[(pos + i) & ring->_mask];
+        objs[i] = slot->_obj;
+        /* give the slot back to producers, for the next lap */
+        metal_atomic_store(&slot->_seq, (int32_t)(pos + i + ring->_mask + 1u),
+                           METAL_ATOMIC_RELEASE);
+    }
+
+    return n;
+}
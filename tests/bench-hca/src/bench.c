@@ -0,0 +1,449 @@
+/**
+ * @file bench.c
+ * @brief HCA throughput and latency benchmarks
+ *
+ * Each result is emitted as a single CSV line, prefixed with "bench,", so
+ * that it can be extracted from the console output:
+ *
+ *   bench,<alg>,<completion>,<size>,<src_off>,<dst_off>,<iterations>,
+ *         <cycles>,<mtime>,<cycles_per_byte>
+ *
+ * completion is poll or irq for the HCA, and sw for the software SHA-2
+ * reference. irq rows feed the engines from the HCA job queue; AES-GCM has
+ * none, as the CPU drives a GCM request between its AAD, payload and tag
+ * phases. batch rows hash many records of size bytes w/ a single request:
+ * iterations then counts the messages, so that cycles/iterations is the
+ * per-message cost. cycles and mtime are the totals for all iterations;
+ * cycles_per_byte is a fixed point value w/ 3 decimals.
+ *
+ * @copyright Copyright (c) 2020 SiFive, Inc
+ * @copyright SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "metal/cpu.h"
+#include "metal/hpm.h"
+#include "hca/aes.h"
+#include "hca/queue.h"
+#include "hca/sha.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define BENCH_MIN_SIZE       16u      // bytes
+#define BENCH_MAX_SIZE       65536u   // bytes
+/** Bytes to process for each measure, to smooth out the timer resolution */
+#define BENCH_TARGET_BYTES   65536u
+#define BENCH_MIN_ITER       2u
+#define BENCH_MAX_ITER       256u
+/** Largest tested misalignment, in bytes */
+#define BENCH_MAX_OFFSET     8u
+
+#define BENCH_QUEUE_SIZE     4u      // jobs
+
+/** Records hashed by each batch request, and their size range */
+#define BENCH_BATCH_COUNT    16u
+#define BENCH_BATCH_MIN_SIZE 32u      // bytes
+#define BENCH_BATCH_MAX_SIZE 256u     // bytes
+
+//-----------------------------------------------------------------------------
+// Macros
+//-----------------------------------------------------------------------------
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(_a_) (sizeof((_a_))/sizeof((_a_)[0]))
+#endif // ARRAY_SIZE
+
+#ifndef MIN
+# define MIN(_a_, _b_) ((_a_) < (_b_) ? (_a_) : (_b_))
+#endif // MIN
+
+#ifndef MAX
+# define MAX(_a_, _b_) ((_a_) > (_b_) ? (_a_) : (_b_))
+#endif // MAX
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** A benchmarked operation, run once on the given buffers */
+typedef int (* bench_op_t)(uint8_t * dst, const uint8_t * src, size_t size);
+
+struct bench_case {
+    const char * bc_alg;        /**< Algorithm name */
+    /** Completion mode: poll or irq, sw for the software reference */
+    const char * bc_completion;
+    bench_op_t bc_op;           /**< Operation */
+    size_t bc_granule;          /**< Size multiple the operation requires */
+    bool bc_output;             /**< Whether a destination buffer is used */
+    bool bc_aligned;            /**< Whether DMA-aligned buffers only */
+    size_t bc_batch;            /**< Messages per operation, 0 if single */
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static uint8_t _src_buf[BENCH_MAX_SIZE+BENCH_MAX_OFFSET]
+    HCA_DMA_ALIGN;
+static uint8_t _dst_buf[BENCH_MAX_SIZE+BENCH_MAX_OFFSET+HCA_AES_BLOCK_SIZE]
+    HCA_DMA_ALIGN;
+
+static const size_t _offsets[] = { 0u, 1u, 4u, 8u };
+
+static const uint8_t _key[16u] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88,
+    0x09, 0xCF, 0x4F, 0x3C,
+};
+
+static const uint8_t _iv[HCA_AES_GCM_IV_SIZE] = {
+    0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88,
+};
+
+static struct metal_cpu * _cpu;
+static struct hca_sha_session _sha;
+static struct hca_aes_session _aes;
+static struct hca_queue _queue;
+static struct hca_job _jobs[BENCH_QUEUE_SIZE];
+
+//-----------------------------------------------------------------------------
+// Benchmarked operations
+//-----------------------------------------------------------------------------
+
+static int
+_bench_sha(enum hca_sha_mode mode, const uint8_t * src, size_t size)
+{
+    uint8_t hash[HCA_SHA_MAX_DIGEST_SIZE];
+
+    int rc = hca_sha_init(&_sha, mode);
+    if ( rc ) {
+        return rc;
+    }
+
+    return hca_sha_digest(&_sha, hash, sizeof(hash), src, size);
+}
+
+static int
+_bench_sha256(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    (void)dst;
+    return _bench_sha(HCA_SHA256, src, size);
+}
+
+static int
+_bench_sha512(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    (void)dst;
+    return _bench_sha(HCA_SHA512, src, size);
+}
+
+static int
+_bench_sha256_sw(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    uint8_t hash[HCA_SHA_MAX_DIGEST_SIZE];
+
+    (void)dst;
+    return hca_sha_sw_digest(HCA_SHA256, hash, sizeof(hash), src, size);
+}
+
+static int
+_bench_sha512_sw(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    uint8_t hash[HCA_SHA_MAX_DIGEST_SIZE];
+
+    (void)dst;
+    return hca_sha_sw_digest(HCA_SHA512, hash, sizeof(hash), src, size);
+}
+
+static int
+_bench_sha256_batch(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    struct hca_sha_record records[BENCH_BATCH_COUNT];
+    uint8_t digests[BENCH_BATCH_COUNT*HCA_SHA_MAX_DIGEST_SIZE];
+
+    (void)dst;
+    for (unsigned int ix=0; ix<BENCH_BATCH_COUNT; ix++) {
+        records[ix].sr_data = &src[ix*size];
+        records[ix].sr_length = size;
+    }
+
+    int rc = hca_sha_init(&_sha, HCA_SHA256);
+    if ( rc ) {
+        return rc;
+    }
+
+    return hca_sha_hash_many(&_sha, records, BENCH_BATCH_COUNT, digests,
+                             sizeof(digests));
+}
+
+static int
+_bench_aes_ecb(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    return hca_aes_ecb(&_aes, HCA_AES_ENCRYPT, dst, src, size);
+}
+
+static int
+_bench_aes_gcm(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    uint8_t tag[HCA_AES_GCM_TAG_SIZE];
+
+    return hca_aes_gcm(&_aes, HCA_AES_ENCRYPT, dst, tag, _iv, src, size,
+                       NULL, 0);
+}
+
+static int
+_bench_aes_ecb_irq(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    struct hca_job job = {
+        .hj_src = src,
+        .hj_dst = dst,
+        .hj_count = size/HCA_DMA_BLOCK_SIZE,
+        .hj_target = HCA_JOB_AES,
+    };
+
+    int rc = hca_queue_aes_setup(&_queue, &_aes, HCA_AES_ECB,
+                                 HCA_AES_ENCRYPT, NULL);
+    if ( ! rc ) {
+        rc = hca_queue_submit(&_queue, &job);
+    }
+    if ( rc ) {
+        return rc;
+    }
+
+    return hca_queue_wait(&_queue);
+}
+
+static int
+_bench_sha_irq(enum hca_sha_mode mode, const uint8_t * src, size_t size)
+{
+    uint8_t hash[HCA_SHA_MAX_DIGEST_SIZE];
+    struct hca_job job = {
+        .hj_src = src,
+        .hj_dst = NULL,
+        .hj_count = size/HCA_DMA_BLOCK_SIZE,
+        .hj_target = HCA_JOB_SHA,
+    };
+
+    int rc = hca_sha_init(&_sha, mode);
+    if ( ! rc ) {
+        rc = hca_queue_sha_start(&_queue, &_sha);
+    }
+    if ( rc ) {
+        return rc;
+    }
+
+    rc = hca_queue_submit(&_queue, &job);
+    if ( ! rc ) {
+        rc = hca_queue_wait(&_queue);
+    }
+    int xrc = hca_queue_sha_done(&_queue, &_sha, rc ? 0u : size);
+    if ( ! rc ) {
+        rc = xrc;
+    }
+
+    xrc = hca_sha_final(&_sha, hash, sizeof(hash));
+
+    return rc ? rc : xrc;
+}
+
+static int
+_bench_sha256_irq(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    (void)dst;
+    return _bench_sha_irq(HCA_SHA256, src, size);
+}
+
+static int
+_bench_sha512_irq(uint8_t * dst, const uint8_t * src, size_t size)
+{
+    (void)dst;
+    return _bench_sha_irq(HCA_SHA512, src, size);
+}
+
+static const struct bench_case _cases[] = {
+    { "sha256", "poll", &_bench_sha256, 1u, false, false },
+    { "sha512", "poll", &_bench_sha512, 1u, false, false },
+    { "sha256", "sw", &_bench_sha256_sw, 1u, false, false },
+    { "sha512", "sw", &_bench_sha512_sw, 1u, false, false },
+    { "sha256", "batch", &_bench_sha256_batch, 1u, false, true,
+      BENCH_BATCH_COUNT },
+    { "aes-ecb", "poll", &_bench_aes_ecb, HCA_AES_BLOCK_SIZE, true, false },
+    { "aes-gcm", "poll", &_bench_aes_gcm, 1u, true, false },
+    { "aes-ecb", "irq", &_bench_aes_ecb_irq, HCA_AES_BLOCK_SIZE, true, true },
+    { "sha256", "irq", &_bench_sha256_irq, HCA_SHA256_BLOCK_SIZE, false,
+      true },
+    { "sha512", "irq", &_bench_sha512_irq, HCA_SHA512_BLOCK_SIZE, false,
+      true },
+};
+
+//-----------------------------------------------------------------------------
+// Benchmark engine
+//-----------------------------------------------------------------------------
+
+static unsigned long long
+_bench_cycles(void)
+{
+    return metal_hpm_read_counter(_cpu, METAL_HPM_CYCLE);
+}
+
+static unsigned long long
+_bench_mtime(void)
+{
+    return metal_cpu_get_mtime(_cpu);
+}
+
+static int
+_bench_run(const struct bench_case * bc, size_t size, size_t src_off,
+           size_t dst_off)
+{
+    uint8_t * dst = &_dst_buf[dst_off];
+    const uint8_t * src = &_src_buf[src_off];
+    size_t msgs = bc->bc_batch ? bc->bc_batch : 1u;
+    unsigned int iters = MIN(MAX(BENCH_TARGET_BYTES/(size*msgs),
+                                 BENCH_MIN_ITER),
+                             BENCH_MAX_ITER);
+
+    // warm up, also checks the case is supported
+    int rc = bc->bc_op(dst, src, size);
+    if ( rc ) {
+        printf("# %s,%s,%zu,%zu,%zu: error %d\n", bc->bc_alg,
+               bc->bc_completion, size, src_off, dst_off, rc);
+        return rc;
+    }
+
+    unsigned long long mtime = _bench_mtime();
+    unsigned long long cycles = _bench_cycles();
+    for (unsigned int ix=0; ix<iters; ix++) {
+        rc = bc->bc_op(dst, src, size);
+        if ( rc ) {
+            break;
+        }
+    }
+    cycles = _bench_cycles() - cycles;
+    mtime = _bench_mtime() - mtime;
+
+    if ( rc ) {
+        printf("# %s,%s,%zu,%zu,%zu: error %d\n", bc->bc_alg,
+               bc->bc_completion, size, src_off, dst_off, rc);
+        return rc;
+    }
+
+    unsigned long long count = (unsigned long long)iters * msgs;
+    unsigned long long cpb =
+        (cycles * 1000ull) / ((unsigned long long)size * count);
+    printf("bench,%s,%s,%zu,%zu,%zu,%llu,%llu,%llu,%llu.%03llu\n",
+           bc->bc_alg, bc->bc_completion, size, src_off, dst_off, count,
+           cycles, mtime, cpb / 1000ull, cpb % 1000ull);
+
+    return 0;
+}
+
+static unsigned int
+_bench_case(const struct bench_case * bc)
+{
+    unsigned int errors = 0;
+
+    if ( bc->bc_batch ) {
+        // small records, where the per-message setup cost dominates
+        for (size_t size=BENCH_BATCH_MIN_SIZE; size<=BENCH_BATCH_MAX_SIZE;
+             size<<=1u) {
+            if ( _bench_run(bc, size, 0u, 0u) ) {
+                errors++;
+            }
+        }
+        return errors;
+    }
+
+    for (size_t size=BENCH_MIN_SIZE; size<=BENCH_MAX_SIZE; size<<=2u) {
+        size_t length = size - (size % bc->bc_granule);
+        if ( ! length ) {
+            continue;
+        }
+        for (unsigned int six=0; six<ARRAY_SIZE(_offsets); six++) {
+            size_t src_off = _offsets[six];
+            for (unsigned int dix=0; dix<ARRAY_SIZE(_offsets); dix++) {
+                size_t dst_off = _offsets[dix];
+                if ( bc->bc_aligned && (src_off || dst_off) ) {
+                    continue;
+                }
+                if ( ! bc->bc_output && dst_off ) {
+                    continue;
+                }
+                if ( _bench_run(bc, length, src_off, dst_off) ) {
+                    errors++;
+                }
+            }
+        }
+    }
+
+    return errors;
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(void)
+{
+    int rc;
+
+    _cpu = metal_cpu_get(metal_cpu_get_current_hartid());
+    if ( ! _cpu ) {
+        printf("# no CPU\n");
+        return 1;
+    }
+    metal_hpm_init(_cpu);
+
+    rc = hca_init();
+    if ( rc ) {
+        printf("# HCA not available: %d\n", rc);
+        return 1;
+    }
+
+    // poll rows always measure the SHA engine, software hashing has its
+    // own rows
+    (void)hca_sha_set_sw_threshold(HCA_SHA256, 0u);
+    (void)hca_sha_set_sw_threshold(HCA_SHA512, 0u);
+
+    rc = hca_aes_init(&_aes, _key, sizeof(_key));
+    if ( rc ) {
+        printf("# AES not available: %d\n", rc);
+        return 1;
+    }
+
+    for (unsigned int ix=0; ix<sizeof(_src_buf); ix++) {
+        _src_buf[ix] = (uint8_t)(ix * 7u + 1u);
+    }
+
+    printf("# alg,completion,size,src_off,dst_off,iterations,cycles,mtime,"
+           "cycles_per_byte\n");
+
+    unsigned int errors = 0;
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_cases); ix++) {
+        const struct bench_case * bc = &_cases[ix];
+        bool irq = ! strcmp(bc->bc_completion, "irq");
+        if ( irq ) {
+            rc = hca_queue_init(&_queue, _jobs, ARRAY_SIZE(_jobs));
+            if ( rc ) {
+                printf("# %s,%s: no IRQ: %d\n", bc->bc_alg,
+                       bc->bc_completion, rc);
+                errors++;
+                continue;
+            }
+        }
+        errors += _bench_case(bc);
+        if ( irq ) {
+            hca_queue_fini(&_queue);
+        }
+    }
+
+    printf("# done, %u error(s)\n", errors);
+
+    return errors ? 1 : 0;
+}
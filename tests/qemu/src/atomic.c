@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "metal/machine.h"
+#include "metal/atomic.h"
+#include "unity_fixture.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static METAL_ATOMIC_DECLARE(_atomic);
+#if __riscv_xlen == 64
+static METAL_ATOMIC64_DECLARE(_atomic64);
+#endif // __riscv_xlen
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(atomic);
+
+TEST_SETUP(atomic)
+{
+    metal_atomic_store(&_atomic, 0, METAL_ATOMIC_RELAXED);
+    #if __riscv_xlen == 64
+    metal_atomic64_store(&_atomic64, 0, METAL_ATOMIC_RELAXED);
+    #endif // __riscv_xlen
+}
+
+TEST_TEAR_DOWN(atomic) {}
+
+TEST(atomic, explicit)
+{
+    TEST_ASSERT_EQUAL_INT(0, metal_atomic_add_explicit(&_atomic, 5,
+                                                       METAL_ATOMIC_ACQUIRE));
+    TEST_ASSERT_EQUAL_INT(5, metal_atomic_or_explicit(&_atomic, 0x30,
+                                                      METAL_ATOMIC_RELEASE));
+    TEST_ASSERT_EQUAL_INT(0x35, metal_atomic_and_explicit(&_atomic, 0x0F,
+                                                      METAL_ATOMIC_ACQ_REL));
+    TEST_ASSERT_EQUAL_INT(5, metal_atomic_xor_explicit(&_atomic, 1,
+                                                       METAL_ATOMIC_SEQ_CST));
+    TEST_ASSERT_EQUAL_INT(4, metal_atomic_min_explicit(&_atomic, -1,
+                                                       METAL_ATOMIC_RELAXED));
+    TEST_ASSERT_EQUAL_UINT(UINT32_MAX,
+                           metal_atomic_min_u_explicit(&_atomic, 7u,
+                                                       METAL_ATOMIC_RELAXED));
+    TEST_ASSERT_EQUAL_INT(7, metal_atomic_swap_explicit(&_atomic, 9,
+                                                        METAL_ATOMIC_ACQUIRE));
+    TEST_ASSERT_EQUAL_INT(9, metal_atomic_load(&_atomic,
+                                               METAL_ATOMIC_ACQUIRE));
+}
+
+TEST(atomic, cas)
+{
+    int32_t expected = 1;
+
+    // mismatch reports the current value
+    TEST_ASSERT_FALSE(metal_atomic_cas(&_atomic, &expected, 2));
+    TEST_ASSERT_EQUAL_INT(0, expected);
+    TEST_ASSERT_TRUE(metal_atomic_cas(&_atomic, &expected, 2));
+    TEST_ASSERT_EQUAL_INT(2, metal_atomic_load(&_atomic,
+                                               METAL_ATOMIC_RELAXED));
+    TEST_ASSERT_TRUE(metal_atomic_cas_explicit(&_atomic, &expected, -3,
+                                               METAL_ATOMIC_RELAXED) == 0);
+    expected = 2;
+    TEST_ASSERT_TRUE(metal_atomic_cas_explicit(&_atomic, &expected, -3,
+                                               METAL_ATOMIC_ACQ_REL));
+    TEST_ASSERT_EQUAL_INT(-3, metal_atomic_load(&_atomic,
+                                                METAL_ATOMIC_SEQ_CST));
+}
+
+#if __riscv_xlen == 64
+TEST(atomic, atomic64)
+{
+    int64_t expected = 0;
+    const int64_t large = INT64_C(0x123456789A);
+
+    TEST_ASSERT_TRUE(metal_atomic64_cas(&_atomic64, &expected, large));
+    TEST_ASSERT_TRUE(large == metal_atomic64_add(&_atomic64, 1));
+    TEST_ASSERT_TRUE((large + 1) ==
+                     metal_atomic64_swap_explicit(&_atomic64, -1,
+                                                  METAL_ATOMIC_ACQ_REL));
+    TEST_ASSERT_TRUE(UINT64_MAX == metal_atomic64_max_u(&_atomic64, 0u));
+    TEST_ASSERT_TRUE(-1 == metal_atomic64_max(&_atomic64, large));
+    expected = 0;
+    TEST_ASSERT_FALSE(metal_atomic64_cas(&_atomic64, &expected, 0));
+    TEST_ASSERT_TRUE(large == expected);
+    TEST_ASSERT_TRUE(large == metal_atomic64_load(&_atomic64,
+                                                  METAL_ATOMIC_ACQUIRE));
+}
+#endif // __riscv_xlen
+
+TEST_GROUP_RUNNER(atomic)
+{
+    RUN_TEST_CASE(atomic, explicit);
+    RUN_TEST_CASE(atomic, cas);
+    #if __riscv_xlen == 64
+    RUN_TEST_CASE(atomic, atomic64);
+    #endif // __riscv_xlen
+}
@@ -5,8 +5,8 @@
 #include <limits.h>
 #include "metal/machine.h"
 #include "metal/tty.h"
-#include "sifive_hca-0.5.x.h"
-#include "hca_macro.h"
+#include "hca/sifive_hca-0.5.x.h"
+#include "hca/hca_macro.h"
 #include "unity_fixture.h"
 #include "dma_test.h"
 #include "qemu.h"
@@ -44,7 +44,6 @@ static const uint8_t _CIPHERTEXT_ECB[] ALIGN(DMA_ALIGNMENT) = {
 
 static struct worker _work;
 static uint8_t _dst_buf[sizeof(_PLAINTEXT_ECB)] ALIGN(DMA_ALIGNMENT);
-static uint8_t _long_buf[4u*PAGE_SIZE] ALIGN(DMA_ALIGNMENT);
 
 //-----------------------------------------------------------------------------
 // DMA AES test implementation
@@ -267,13 +266,6 @@ _hca_irq_handler(int id, void * opaque)
     }
 }
 
-static void
-_timer_irq_handler(int id, void * opaque) {
-    struct metal_cpu *cpu = (struct metal_cpu *)opaque;
-    metal_cpu_set_mtimecmp(cpu, metal_cpu_get_mtime(cpu)+HEART_BEAT_TIME);
-    // puts("^T\n");
-}
-
 static void
 _hca_irq_init(struct worker * work)
 {
@@ -303,24 +295,6 @@ _hca_irq_init(struct worker * work)
     metal_interrupt_set_threshold(plic, 1);
     metal_interrupt_set_priority(plic, HCA_ASD_IRQ_CHANNEL, 2);
 
-    // use a timer IRQ as an easier workaround for a time vulnarability
-    // issue between WFI instruction and ISR. To avoid being stuck in WFI,
-    // add an hearbeat.
-    struct metal_interrupt *tmr_intr;
-    tmr_intr = metal_cpu_timer_interrupt_controller(cpu);
-    if ( !tmr_intr ) {
-        return;
-    }
-    metal_interrupt_init(tmr_intr);
-
-    int tmr_id;
-    tmr_id = metal_cpu_timer_get_interrupt_id(cpu);
-    rc = metal_interrupt_register_handler(tmr_intr, tmr_id, _timer_irq_handler,
-                                          cpu);
-    TEST_ASSERT_FALSE_MESSAGE(rc, "Cannot register IRQ handler");
-
-    metal_cpu_set_mtimecmp(cpu, metal_cpu_get_mtime(cpu)+HEART_BEAT_TIME);
-    metal_interrupt_enable(tmr_intr, tmr_id);
     metal_interrupt_enable(cpu_intr, 0);
 }
 
@@ -451,9 +425,7 @@ _test_dma_irq(const uint8_t * ref_d, const uint8_t * ref_s, uint8_t * dst,
                   HCA_REGISTER_DMA_CR_START_OFFSET,
                   HCA_REGISTER_DMA_CR_START_MASK);
 
-    while( ! work->wk_dma_count ) {
-        __asm__ volatile ("wfi");
-    }
+    _hca_irq_count_wait(&work->wk_dma_count);
     _hca_dma_clear_irq();
 
     while ( _hca_aes_is_busy() ) {
@@ -511,9 +483,7 @@ _test_dma_irq(const uint8_t * ref_d, const uint8_t * ref_s, uint8_t * dst,
                   HCA_REGISTER_DMA_CR_START_OFFSET,
                   HCA_REGISTER_DMA_CR_START_MASK);
 
-    while( ! work->wk_dma_count ) {
-        __asm__ volatile ("wfi");
-    }
+    _hca_irq_count_wait(&work->wk_dma_count);
     _hca_dma_clear_irq();
 
     while ( _hca_aes_is_busy() ) {
@@ -542,32 +512,35 @@ TEST_GROUP(dma_aes_ecb_poll);
 TEST_SETUP(dma_aes_ecb_poll)
 {
     QEMU_IO_STATS(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(qemu_dma_long_buf_get(),
+                                 "Cannot allocate DMA buffer");
 }
 
 TEST_TEAR_DOWN(dma_aes_ecb_poll)
 {
+    qemu_dma_long_buf_put();
     QEMU_IO_STATS(1);
 }
 
 TEST(dma_aes_ecb_poll, short)
 {
-    memcpy(_long_buf, _PLAINTEXT_ECB, sizeof(_PLAINTEXT_ECB));
+    memcpy(dma_long_buf, _PLAINTEXT_ECB, sizeof(_PLAINTEXT_ECB));
     _test_dma_poll(_CIPHERTEXT_ECB, _PLAINTEXT_ECB, _dst_buf,
-                   _long_buf, sizeof(_PLAINTEXT_ECB), 1u);
+                   dma_long_buf, sizeof(_PLAINTEXT_ECB), 1u);
 }
 
 TEST(dma_aes_ecb_poll, long)
 {
     // test a long buffer, which is a repeated version of the short one.
     // also take the opportunity to test src == dst buffers
-    size_t repeat = sizeof(_long_buf)/sizeof(_PLAINTEXT_ECB);
-    uint8_t * ptr = _long_buf;
+    size_t repeat = DMA_LONG_BUF_SIZE/sizeof(_PLAINTEXT_ECB);
+    uint8_t * ptr = dma_long_buf;
     for (unsigned int ix=0; ix<repeat; ix++) {
         memcpy(ptr, _PLAINTEXT_ECB, sizeof(_PLAINTEXT_ECB));
         ptr += sizeof(_PLAINTEXT_ECB);
     }
-    _test_dma_poll(_CIPHERTEXT_ECB, _PLAINTEXT_ECB, _long_buf, _long_buf,
-                   sizeof(_long_buf), repeat);
+    _test_dma_poll(_CIPHERTEXT_ECB, _PLAINTEXT_ECB, dma_long_buf,
+                   dma_long_buf, DMA_LONG_BUF_SIZE, repeat);
 }
 
 TEST_GROUP_RUNNER(dma_aes_ecb_poll)
@@ -581,34 +554,37 @@ TEST_GROUP(dma_aes_ecb_irq);
 TEST_SETUP(dma_aes_ecb_irq)
 {
     QEMU_IO_STATS(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(qemu_dma_long_buf_get(),
+                                 "Cannot allocate DMA buffer");
     _hca_irq_init(&_work);
 }
 
 TEST_TEAR_DOWN(dma_aes_ecb_irq)
 {
     _hca_irq_fini();
+    qemu_dma_long_buf_put();
     QEMU_IO_STATS(1);
 }
 
 TEST(dma_aes_ecb_irq, short)
 {
-    memcpy(_long_buf, _PLAINTEXT_ECB, sizeof(_PLAINTEXT_ECB));
+    memcpy(dma_long_buf, _PLAINTEXT_ECB, sizeof(_PLAINTEXT_ECB));
     _test_dma_irq(_CIPHERTEXT_ECB, _PLAINTEXT_ECB, _dst_buf,
-                  _long_buf, sizeof(_PLAINTEXT_ECB), 1u, &_work);
+                  dma_long_buf, sizeof(_PLAINTEXT_ECB), 1u, &_work);
 }
 
 TEST(dma_aes_ecb_irq, long)
 {
     // test a long buffer, which is a repeated version of the short one.
     // also take the opportunity to test src == dst buffers
-    size_t repeat = sizeof(_long_buf)/sizeof(_PLAINTEXT_ECB);
-    uint8_t * ptr = _long_buf;
+    size_t repeat = DMA_LONG_BUF_SIZE/sizeof(_PLAINTEXT_ECB);
+    uint8_t * ptr = dma_long_buf;
     for (unsigned int ix=0; ix<repeat; ix++) {
         memcpy(ptr, _PLAINTEXT_ECB, sizeof(_PLAINTEXT_ECB));
         ptr += sizeof(_PLAINTEXT_ECB);
     }
-    _test_dma_irq(_CIPHERTEXT_ECB, _PLAINTEXT_ECB, _long_buf, _long_buf,
-                 sizeof(_long_buf), repeat, &_work);
+    _test_dma_irq(_CIPHERTEXT_ECB, _PLAINTEXT_ECB, dma_long_buf,
+                  dma_long_buf, DMA_LONG_BUF_SIZE, repeat, &_work);
 }
 
 TEST_GROUP_RUNNER(dma_aes_ecb_irq)
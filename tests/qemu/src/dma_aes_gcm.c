@@ -270,10 +270,7 @@ _test_dma_aligned(struct worker * work, uint8_t * dst, uint8_t * tag,
                 10u, dma_loop, "VM may have freeze guest code execution");
         }
     } else {
-        while( ! work->wk_dma_count ) {
-            TEST_TIMEOUT(timeout, "Stalled waiting for DMA IRQ");
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_dma_count);
         _hca_dma_clear_irq();
         TEST_ASSERT_FALSE_MESSAGE(_hca_dma_is_busy(), "DMA still busy");
     }
@@ -336,15 +333,10 @@ _test_dma_aligned(struct worker * work, uint8_t * dst, uint8_t * tag,
             // busy loop
         }
     } else {
-        while( ! work->wk_dma_count ) {
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_dma_count);
         _hca_dma_clear_irq();
 
-        while( ! work->wk_crypto_count ) {
-            TEST_TIMEOUT(timeout, "Stalled waiting for AES IRQ");
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_crypto_count);
         _hca_crypto_clear_irq();
 
         TEST_ASSERT_FALSE_MESSAGE(_hca_dma_is_busy(), "DMA still busy");
@@ -680,10 +672,7 @@ _test_dma_unaligned(struct worker * work, uint8_t * dst, uint8_t * tag,
                 10u, dma_loop, "VM may have freeze guest code execution");
         }
     } else {
-        while( ! work->wk_dma_count ) {
-            TEST_TIMEOUT(timeout, "Stalled waiting for DMA IRQ");
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_dma_count);
         _hca_dma_clear_irq();
     }
 
@@ -765,10 +754,7 @@ _test_dma_unaligned(struct worker * work, uint8_t * dst, uint8_t * tag,
                 10u, dma_loop, "VM may have freeze guest code execution");
         }
     } else {
-        while( ! work->wk_dma_count ) {
-            TEST_TIMEOUT(timeout, "Stalled waiting for DMA IRQ");
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_dma_count);
         _hca_dma_clear_irq();
         TEST_ASSERT_FALSE_MESSAGE(_hca_dma_is_busy(), "DMA still busy");
     }
@@ -791,10 +777,7 @@ _test_dma_unaligned(struct worker * work, uint8_t * dst, uint8_t * tag,
             TEST_TIMEOUT(timeout, "Stalled waiting for AES completion");
         }
     } else {
-        while( ! work->wk_crypto_count ) {
-            TEST_TIMEOUT(timeout, "Stalled waiting for AES IRQ");
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_crypto_count);
         _hca_crypto_clear_irq();
 
         TEST_ASSERT_FALSE_MESSAGE(_hca_aes_is_busy(), "AES still busy");
@@ -845,13 +828,6 @@ _hca_irq_handler(int id, void * opaque)
     }
 }
 
-static void
-_timer_irq_handler(int id, void * opaque) {
-    struct metal_cpu *cpu = (struct metal_cpu *)opaque;
-    metal_cpu_set_mtimecmp(cpu, metal_cpu_get_mtime(cpu)+HEART_BEAT_TIME);
-    // puts("^T\n");
-}
-
 static void
 _hca_irq_init(struct worker * work)
 {
@@ -881,24 +857,6 @@ _hca_irq_init(struct worker * work)
     metal_interrupt_set_threshold(plic, 1);
     metal_interrupt_set_priority(plic, HCA_ASD_IRQ_CHANNEL, 2);
 
-    // use a timer IRQ as an easier workaround for a time vulnarability
-    // issue between WFI instruction and ISR. To avoid being stuck in WFI,
-    // add an hearbeat.
-    struct metal_interrupt *tmr_intr;
-    tmr_intr = metal_cpu_timer_interrupt_controller(cpu);
-    if ( !tmr_intr ) {
-        return;
-    }
-    metal_interrupt_init(tmr_intr);
-
-    int tmr_id;
-    tmr_id = metal_cpu_timer_get_interrupt_id(cpu);
-    rc = metal_interrupt_register_handler(tmr_intr, tmr_id, _timer_irq_handler,
-                                          cpu);
-    TEST_ASSERT_FALSE_MESSAGE(rc, "Cannot register IRQ handler");
-
-    metal_cpu_set_mtimecmp(cpu, metal_cpu_get_mtime(cpu)+HEART_BEAT_TIME);
-    metal_interrupt_enable(tmr_intr, tmr_id);
     metal_interrupt_enable(cpu_intr, 0);
 }
 
@@ -936,10 +894,13 @@ TEST_GROUP(dma_aes_gcm_poll);
 TEST_SETUP(dma_aes_gcm_poll)
 {
     QEMU_IO_STATS(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(qemu_dma_long_buf_get(),
+                                 "Cannot allocate DMA buffer");
 }
 
 TEST_TEAR_DOWN(dma_aes_gcm_poll)
 {
+    qemu_dma_long_buf_put();
     QEMU_IO_STATS(1);
 }
 
@@ -1022,12 +983,15 @@ TEST_GROUP(dma_aes_gcm_irq);
 TEST_SETUP(dma_aes_gcm_irq)
 {
     QEMU_IO_STATS(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(qemu_dma_long_buf_get(),
+                                 "Cannot allocate DMA buffer");
     _hca_irq_init(&_work);
 }
 
 TEST_TEAR_DOWN(dma_aes_gcm_irq)
 {
     _hca_irq_fini();
+    qemu_dma_long_buf_put();
     QEMU_IO_STATS(1);
 }
 
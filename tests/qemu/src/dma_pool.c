@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "metal/machine.h"
+#include "metal/dma_pool.h"
+#include "unity_fixture.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define POOL_ARENA_SIZE      1024u  // bytes
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static uint8_t _arena[POOL_ARENA_SIZE] ALIGN(METAL_DMA_POOL_ALIGNMENT);
+static struct metal_dma_pool _pool;
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(dma_pool);
+
+TEST_SETUP(dma_pool)
+{
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_dma_pool_init(&_pool, _arena,
+                                                         sizeof(_arena)),
+                                  "Cannot initialize DMA pool");
+}
+
+TEST_TEAR_DOWN(dma_pool) {}
+
+TEST(dma_pool, alloc)
+{
+    uint8_t * blocks[4];
+    static const size_t sizes[] = { 1u, 48u, 100u, 256u };
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(sizes); ix++) {
+        blocks[ix] = metal_dma_pool_alloc(&_pool, sizes[ix]);
+        TEST_ASSERT_NOT_NULL_MESSAGE(blocks[ix], "Cannot allocate");
+        TEST_ASSERT_EQUAL_MESSAGE(((uintptr_t)blocks[ix]) &
+                                  ((METAL_DMA_POOL_ALIGNMENT) - 1u), 0,
+                                  "Block is not aligned");
+        memset(blocks[ix], (int)ix, sizes[ix]);
+    }
+
+    // blocks should not overlap
+    for (unsigned int ix=0; ix<ARRAY_SIZE(sizes); ix++) {
+        for (unsigned int pos=0; pos<sizes[ix]; pos++) {
+            TEST_ASSERT_EQUAL_UINT8(ix, blocks[ix][pos]);
+        }
+    }
+
+    // a released block is reused for the same size class
+    metal_dma_pool_free(&_pool, blocks[2u], sizes[2u]);
+    TEST_ASSERT_EQUAL_PTR(blocks[2u], metal_dma_pool_alloc(&_pool, 128u));
+
+    TEST_ASSERT_NULL(metal_dma_pool_alloc(&_pool, 0u));
+    TEST_ASSERT_NULL(metal_dma_pool_alloc(&_pool,
+                                          METAL_DMA_POOL_MAX_SIZE + 1u));
+}
+
+TEST(dma_pool, split)
+{
+    uint8_t * large = metal_dma_pool_alloc(&_pool, POOL_ARENA_SIZE/2u);
+    TEST_ASSERT_EQUAL_PTR(_arena, large);
+    TEST_ASSERT_NOT_NULL(metal_dma_pool_alloc(&_pool, POOL_ARENA_SIZE/2u));
+    // exhausted
+    TEST_ASSERT_NULL(metal_dma_pool_alloc(&_pool, 1u));
+
+    // the released block is split for smaller requests
+    metal_dma_pool_free(&_pool, large, POOL_ARENA_SIZE/2u);
+    size_t size = METAL_DMA_POOL_ALIGNMENT;
+    TEST_ASSERT_EQUAL_PTR(large, metal_dma_pool_alloc(&_pool, size));
+    for (; size<POOL_ARENA_SIZE/2u; size<<=1u) {
+        TEST_ASSERT_EQUAL_PTR(&large[size],
+                              metal_dma_pool_alloc(&_pool, size));
+    }
+    TEST_ASSERT_NULL(metal_dma_pool_alloc(&_pool, 1u));
+}
+
+TEST(dma_pool, coalesce)
+{
+    static const size_t sizes[] = { 1u, 48u, 100u, 256u, 32u };
+    uint8_t * blocks[ARRAY_SIZE(sizes)];
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(sizes); ix++) {
+        blocks[ix] = metal_dma_pool_alloc(&_pool, sizes[ix]);
+        TEST_ASSERT_NOT_NULL_MESSAGE(blocks[ix], "Cannot allocate");
+    }
+    // the whole arena is not available while any block is in use
+    TEST_ASSERT_NULL(metal_dma_pool_alloc(&_pool, POOL_ARENA_SIZE));
+
+    // released blocks are merged back w/ their buddies, whatever the order
+    for (unsigned int ix=0; ix<ARRAY_SIZE(sizes); ix++) {
+        metal_dma_pool_free(&_pool, blocks[ix], sizes[ix]);
+    }
+    uint8_t * whole = metal_dma_pool_alloc(&_pool, POOL_ARENA_SIZE);
+    TEST_ASSERT_EQUAL_PTR(_arena, whole);
+    metal_dma_pool_free(&_pool, whole, POOL_ARENA_SIZE);
+}
+
+TEST(dma_pool, invalid)
+{
+    struct metal_dma_pool pool;
+
+    TEST_ASSERT_EQUAL_INT(1, metal_dma_pool_init(&pool, NULL, PAGE_SIZE));
+    // smaller than a block once aligned
+    TEST_ASSERT_EQUAL_INT(1, metal_dma_pool_init(&pool, &_arena[1u],
+                                                 METAL_DMA_POOL_ALIGNMENT));
+    // not backed by any memory
+    TEST_ASSERT_EQUAL_INT(2, metal_dma_pool_init(&pool, (void *)0x100u,
+                                                 PAGE_SIZE));
+}
+
+TEST_GROUP_RUNNER(dma_pool)
+{
+    RUN_TEST_CASE(dma_pool, alloc);
+    RUN_TEST_CASE(dma_pool, split);
+    RUN_TEST_CASE(dma_pool, coalesce);
+    RUN_TEST_CASE(dma_pool, invalid);
+}
@@ -5,8 +5,8 @@
 #include <limits.h>
 #include "metal/machine.h"
 #include "metal/tty.h"
-#include "sifive_hca-0.5.x.h"
-#include "hca_macro.h"
+#include "hca/sifive_hca-0.5.x.h"
+#include "hca/hca_macro.h"
 #include "unity_fixture.h"
 #include "dma_test.h"
 
@@ -541,13 +541,6 @@ _hca_irq_handler(int id, void * opaque)
     }
 }
 
-static void
-_timer_irq_handler(int id, void * opaque) {
-    struct metal_cpu *cpu = (struct metal_cpu *)opaque;
-    metal_cpu_set_mtimecmp(cpu, metal_cpu_get_mtime(cpu)+HEART_BEAT_TIME);
-    // puts("^T\n");
-}
-
 static void
 _hca_irq_init(struct worker * work)
 {
@@ -577,24 +570,6 @@ _hca_irq_init(struct worker * work)
     metal_interrupt_set_threshold(plic, 1);
     metal_interrupt_set_priority(plic, HCA_ASD_IRQ_CHANNEL, 2);
 
-    // use a timer IRQ as an easier workaround for a time vulnarability
-    // issue between WFI instruction and ISR. To avoid being stuck in WFI,
-    // add an hearbeat.
-    struct metal_interrupt *tmr_intr;
-    tmr_intr = metal_cpu_timer_interrupt_controller(cpu);
-    if ( !tmr_intr ) {
-        return;
-    }
-    metal_interrupt_init(tmr_intr);
-
-    int tmr_id;
-    tmr_id = metal_cpu_timer_get_interrupt_id(cpu);
-    rc = metal_interrupt_register_handler(tmr_intr, tmr_id, _timer_irq_handler,
-                                          cpu);
-    TEST_ASSERT_FALSE_MESSAGE(rc, "Cannot register IRQ handler");
-
-    metal_cpu_set_mtimecmp(cpu, metal_cpu_get_mtime(cpu)+HEART_BEAT_TIME);
-    metal_interrupt_enable(tmr_intr, tmr_id);
     metal_interrupt_enable(cpu_intr, 0);
 }
 
@@ -734,9 +709,7 @@ _test_sha_dma_irq(const uint8_t * refh, const uint8_t * buf, size_t buflen,
                       HCA_REGISTER_DMA_CR_START_OFFSET,
                       HCA_REGISTER_DMA_CR_START_MASK);
 
-        while( ! work->wk_dma_count ) {
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_dma_count);
         _hca_dma_clear_irq();
 
         step |= 1<<1;
@@ -763,9 +736,7 @@ _test_sha_dma_irq(const uint8_t * refh, const uint8_t * buf, size_t buflen,
                        HCA_REGISTER_DMA_CR_START_OFFSET,
                        HCA_REGISTER_DMA_CR_START_MASK);
 
-        while( ! work->wk_dma_count ) {
-            __asm__ volatile ("wfi");
-        }
+        _hca_irq_count_wait(&work->wk_dma_count);
         _hca_dma_clear_irq();
 
         work->wk_dma_count = 0u;
@@ -4,8 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
-#include "sifive_hca-0.5.x.h"
-#include "hca_macro.h"
+#include "hca/sifive_hca-0.5.x.h"
+#include "hca/hca_macro.h"
 #include "qemu.h"
 
 //-----------------------------------------------------------------------------
@@ -26,6 +26,8 @@
 #define SHA2_SHA384          0x2u
 #define SHA2_SHA512          0x3u
 
+#define MSTATUS_MIE_BIT      (1u << 3u)
+
 //-----------------------------------------------------------------------------
 // Type definitions
 //-----------------------------------------------------------------------------
@@ -75,12 +77,6 @@ struct buf_desc {
 #define HCA_CR_OFIFO_FULL_BIT \
     (HCA_REGISTER_CR_OFIFOFULL_MASK << HCA_REGISTER_CR_OFIFOFULL_OFFSET)
 
-//-----------------------------------------------------------------------------
-// Global variables
-//-----------------------------------------------------------------------------
-
-extern uint8_t ALIGN(DMA_ALIGNMENT) dma_long_buf[4*PAGE_SIZE];
-
 //-----------------------------------------------------------------------------
 // Inline helpers
 //-----------------------------------------------------------------------------
@@ -207,6 +203,35 @@ _hca_set_aes_iv96(const uint8_t * iv)
         __builtin_bswap32(dwiv[2u]);
 }
 
+/**
+ * Wait for an IRQ counter, incremented from an ISR, to become non-zero.
+ *
+ * Machine interrupts are masked while the counter is checked and until WFI
+ * is executed. WFI still resumes on a pending interrupt even w/ MIE clear,
+ * and the ISR runs as soon as mstatus is restored, so an IRQ raised between
+ * the check and WFI cannot be missed. This should be called w/ machine
+ * interrupts enabled.
+ *
+ * @param count the counter to wait for
+ */
+static inline void
+_hca_irq_count_wait(const volatile size_t * count)
+{
+    for(;;) {
+        unsigned long mstatus;
+        __asm__ volatile ("csrrc %0, mstatus, %1" : "=r"(mstatus)
+                          : "r"(MSTATUS_MIE_BIT) : "memory");
+        bool done = *count != 0u;
+        if ( ! done ) {
+            __asm__ volatile ("wfi");
+        }
+        __asm__ volatile ("csrw mstatus, %0" :: "r"(mstatus) : "memory");
+        if ( done ) {
+            break;
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 // TRNG function
 //-----------------------------------------------------------------------------
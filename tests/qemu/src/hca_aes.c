@@ -0,0 +1,618 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "hca/aes.h"
+#include "unity_fixture.h"
+#include "dma_test.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+// NIST SP 800-38A, F.1.1
+static const uint8_t _KEY_SP800_38A[] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88,
+    0x09, 0xCF, 0x4F, 0x3C,
+};
+
+static const uint8_t _PLAINTEXT_SP800_38A[64u] = {
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11,
+    0x73, 0x93, 0x17, 0x2A, 0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C,
+    0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51, 0x30, 0xC8, 0x1C, 0x46,
+    0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+    0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B,
+    0xE6, 0x6C, 0x37, 0x10,
+};
+
+static const uint8_t _CIPHERTEXT_ECB[64u] = {
+    0x3A, 0xD7, 0x7B, 0xB4, 0x0D, 0x7A, 0x36, 0x60, 0xA8, 0x9E, 0xCA, 0xF3,
+    0x24, 0x66, 0xEF, 0x97, 0xF5, 0xD3, 0xD5, 0x85, 0x03, 0xB9, 0x69, 0x9D,
+    0xE7, 0x85, 0x89, 0x5A, 0x96, 0xFD, 0xBA, 0xAF, 0x43, 0xB1, 0xCD, 0x7F,
+    0x59, 0x8E, 0xCE, 0x23, 0x88, 0x1B, 0x00, 0xE3, 0xED, 0x03, 0x06, 0x88,
+    0x7B, 0x0C, 0x78, 0x5E, 0x27, 0xE8, 0xAD, 0x3F, 0x82, 0x23, 0x20, 0x71,
+    0x04, 0x72, 0x5D, 0xD4,
+};
+
+// NIST SP 800-38A, F.1.3
+static const uint8_t _KEY_SP800_38A_192[] = {
+    0x8E, 0x73, 0xB0, 0xF7, 0xDA, 0x0E, 0x64, 0x52, 0xC8, 0x10, 0xF3, 0x2B,
+    0x80, 0x90, 0x79, 0xE5, 0x62, 0xF8, 0xEA, 0xD2, 0x52, 0x2C, 0x6B, 0x7B,
+};
+
+static const uint8_t _CIPHERTEXT_ECB_192[64u] = {
+    0xBD, 0x33, 0x4F, 0x1D, 0x6E, 0x45, 0xF2, 0x5F, 0xF7, 0x12, 0xA2, 0x14,
+    0x57, 0x1F, 0xA5, 0xCC, 0x97, 0x41, 0x04, 0x84, 0x6D, 0x0A, 0xD3, 0xAD,
+    0x77, 0x34, 0xEC, 0xB3, 0xEC, 0xEE, 0x4E, 0xEF, 0xEF, 0x7A, 0xFD, 0x22,
+    0x70, 0xE2, 0xE6, 0x0A, 0xDC, 0xE0, 0xBA, 0x2F, 0xAC, 0xE6, 0x44, 0x4E,
+    0x9A, 0x4B, 0x41, 0xBA, 0x73, 0x8D, 0x6C, 0x72, 0xFB, 0x16, 0x69, 0x16,
+    0x03, 0xC1, 0x8E, 0x0E,
+};
+
+// NIST SP 800-38A, F.1.5
+static const uint8_t _KEY_SP800_38A_256[] = {
+    0x60, 0x3D, 0xEB, 0x10, 0x15, 0xCA, 0x71, 0xBE, 0x2B, 0x73, 0xAE, 0xF0,
+    0x85, 0x7D, 0x77, 0x81, 0x1F, 0x35, 0x2C, 0x07, 0x3B, 0x61, 0x08, 0xD7,
+    0x2D, 0x98, 0x10, 0xA3, 0x09, 0x14, 0xDF, 0xF4,
+};
+
+static const uint8_t _CIPHERTEXT_ECB_256[64u] = {
+    0xF3, 0xEE, 0xD1, 0xBD, 0xB5, 0xD2, 0xA0, 0x3C, 0x06, 0x4B, 0x5A, 0x7E,
+    0x3D, 0xB1, 0x81, 0xF8, 0x59, 0x1C, 0xCB, 0x10, 0xD4, 0x10, 0xED, 0x26,
+    0xDC, 0x5B, 0xA7, 0x4A, 0x31, 0x36, 0x28, 0x70, 0xB6, 0xED, 0x21, 0xB9,
+    0x9C, 0xA6, 0xF4, 0xF9, 0xF1, 0x53, 0xE7, 0xB1, 0xBE, 0xAF, 0xED, 0x1D,
+    0x23, 0x30, 0x4B, 0x7A, 0x39, 0xF9, 0xF3, 0xFF, 0x06, 0x7D, 0x8D, 0x8F,
+    0x9E, 0x24, 0xEC, 0xC7,
+};
+
+// NIST SP 800-38A, F.2.1
+static const uint8_t _IV_CBC[HCA_AES_BLOCK_SIZE] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+    0x0C, 0x0D, 0x0E, 0x0F,
+};
+
+static const uint8_t _CIPHERTEXT_CBC[64u] = {
+    0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46, 0xCE, 0xE9, 0x8E, 0x9B,
+    0x12, 0xE9, 0x19, 0x7D, 0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72, 0x19, 0xEE,
+    0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2, 0x73, 0xBE, 0xD6, 0xB8,
+    0xE3, 0xC1, 0x74, 0x3B, 0x71, 0x16, 0xE6, 0x9E, 0x22, 0x22, 0x95, 0x16,
+    0x3F, 0xF1, 0xCA, 0xA1, 0x68, 0x1F, 0xAC, 0x09, 0x12, 0x0E, 0xCA, 0x30,
+    0x75, 0x86, 0xE1, 0xA7,
+};
+
+// NIST SP 800-38A, F.5.1
+static const uint8_t _CTR_CTR[HCA_AES_BLOCK_SIZE] = {
+    0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB,
+    0xFC, 0xFD, 0xFE, 0xFF,
+};
+
+static const uint8_t _CIPHERTEXT_CTR[64u] = {
+    0x87, 0x4D, 0x61, 0x91, 0xB6, 0x20, 0xE3, 0x26, 0x1B, 0xEF, 0x68, 0x64,
+    0x99, 0x0D, 0xB6, 0xCE, 0x98, 0x06, 0xF6, 0x6B, 0x79, 0x70, 0xFD, 0xFF,
+    0x86, 0x17, 0x18, 0x7B, 0xB9, 0xFF, 0xFD, 0xFF, 0x5A, 0xE4, 0xDF, 0x3E,
+    0xDB, 0xD5, 0xD3, 0x5E, 0x5B, 0x4F, 0x09, 0x02, 0x0D, 0xB0, 0x3E, 0xAB,
+    0x1E, 0x03, 0x1D, 0xDA, 0x2F, 0xBE, 0x03, 0xD1, 0x79, 0x21, 0x70, 0xA0,
+    0xF3, 0x00, 0x9C, 0xEE,
+};
+
+static const uint8_t _KEY_GCM[] = {
+    0x48, 0xB7, 0xF3, 0x37, 0xCD, 0xF9, 0x25, 0x26, 0x87, 0xEC, 0xC7, 0x60,
+    0xBD, 0x8E, 0xC1, 0x84,
+};
+
+static const uint8_t _IV_GCM[] = {
+    0x3E, 0x89, 0x4E, 0xBB, 0x16, 0xCE, 0x82, 0xA5, 0x3C, 0x3E, 0x05, 0xB2,
+};
+
+static const uint8_t _AAD_GCM[48u] = {
+    0x7D, 0x92, 0x4C, 0xFD, 0x37, 0xB3, 0xD0, 0x46, 0xA9, 0x6E, 0xB5, 0xE1,
+    0x32, 0x04, 0x24, 0x05, 0xC8, 0x73, 0x1E, 0x06, 0x50, 0x97, 0x87, 0xBB,
+    0xEB, 0x41, 0xF2, 0x58, 0x27, 0x57, 0x46, 0x49, 0x5E, 0x88, 0x4D, 0x69,
+    0x87, 0x1F, 0x77, 0x63, 0x4C, 0x58, 0x4B, 0xB0, 0x07, 0x31, 0x22, 0x34,
+};
+
+static const uint8_t _PLAINTEXT_GCM[32u] = {
+    0xBB, 0x2B, 0xAC, 0x67, 0xA4, 0x70, 0x94, 0x30, 0xC3, 0x9C, 0x2E, 0xB9,
+    0xAC, 0xFA, 0xBC, 0x0D, 0x45, 0x6C, 0x80, 0xD3, 0x0A, 0xA1, 0x73, 0x4E,
+    0x57, 0x99, 0x7D, 0x54, 0x8A, 0x8F, 0x06, 0x03,
+};
+
+static const uint8_t _CIPHERTEXT_GCM[32u] = {
+    0xD2, 0x63, 0x22, 0x8B, 0x8C, 0xE0, 0x51, 0xF6, 0x7E, 0x9B, 0xAF, 0x1C,
+    0xE7, 0xDF, 0x97, 0xD1, 0x0C, 0xD5, 0xF3, 0xBC, 0x97, 0x23, 0x62, 0x05,
+    0x51, 0x30, 0xC7, 0xD1, 0x3C, 0x3A, 0xB2, 0xE7,
+};
+
+static const uint8_t _TAG_GCM[HCA_AES_GCM_TAG_SIZE] = {
+    0x71, 0x44, 0x67, 0x37, 0xCA, 0x1F, 0xA9, 0x2E, 0x6D, 0x02, 0x6D, 0x7D,
+    0x2E, 0xD1, 0xAA, 0x9C,
+};
+
+// same key and IV, AAD is a 0x80-based index sequence of 20 bytes and
+// plaintext is a 0-based index sequence of 37 bytes
+static const uint8_t _CIPHERTEXT_GCM_PARTIAL[37u] = {
+    0x69, 0x49, 0x8C, 0xEF, 0x2C, 0x95, 0xC3, 0xC1, 0xB5, 0x0E, 0x8B, 0xAE,
+    0x47, 0x28, 0x25, 0xD3, 0x59, 0xA8, 0x61, 0x7C, 0x89, 0x97, 0x07, 0x5C,
+    0x1E, 0xB0, 0xA0, 0x9E, 0xAA, 0xA8, 0xAA, 0xFB, 0x42, 0x49, 0x30, 0xA4,
+    0xAD,
+};
+
+static const uint8_t _TAG_GCM_PARTIAL[HCA_AES_GCM_TAG_SIZE] = {
+    0x6F, 0x85, 0xB8, 0x98, 0x86, 0x6C, 0x19, 0x06, 0x37, 0xEC, 0xC4, 0x49,
+    0x9B, 0x03, 0xF0, 0x7B,
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static struct hca_aes_session _aes_session;
+static uint8_t _src_buf[128u] ALIGN(DMA_ALIGNMENT);
+static uint8_t _dst_buf[128u] ALIGN(DMA_ALIGNMENT);
+static uint8_t _aad_buf[64u] ALIGN(DMA_ALIGNMENT);
+static uint8_t _tag_buf[HCA_AES_GCM_TAG_SIZE];
+
+//-----------------------------------------------------------------------------
+// HCA AES library test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_test_ecb(enum hca_aes_process proc, const uint8_t * ref,
+          const uint8_t * in, size_t length,
+          size_t src_off, size_t dst_off)
+{
+    int rc;
+
+    rc = hca_aes_init(&_aes_session, _KEY_SP800_38A, sizeof(_KEY_SP800_38A));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize AES session");
+
+    memcpy(&_src_buf[src_off], in, length);
+    memset(_dst_buf, 0, sizeof(_dst_buf));
+
+    rc = hca_aes_ecb(&_aes_session, proc, &_dst_buf[dst_off],
+                     &_src_buf[src_off], length);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES ECB failed");
+
+    if ( memcmp(&_dst_buf[dst_off], ref, length) ) {
+        DUMP_HEX("Invalid output:", &_dst_buf[dst_off], length);
+        DUMP_HEX("Ref:           ", ref, length);
+        TEST_FAIL_MESSAGE("Output mismatch");
+    }
+}
+
+/**
+ * Run an ECB request w/ an already initialized session.
+ */
+static void
+_test_ecb_session(struct hca_aes_session * as, enum hca_aes_process proc,
+                  const uint8_t * ref, const uint8_t * in, size_t length)
+{
+    memcpy(_src_buf, in, length);
+    memset(_dst_buf, 0, sizeof(_dst_buf));
+
+    int rc = hca_aes_ecb(as, proc, _dst_buf, _src_buf, length);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES ECB failed");
+
+    if ( memcmp(_dst_buf, ref, length) ) {
+        DUMP_HEX("Invalid output:", _dst_buf, length);
+        DUMP_HEX("Ref:           ", ref, length);
+        TEST_FAIL_MESSAGE("Output mismatch");
+    }
+}
+
+static void
+_test_chained(enum hca_aes_mode mode, enum hca_aes_process proc,
+              const uint8_t * ref, const uint8_t * in, size_t length,
+              const uint8_t * iv, size_t first, size_t src_off,
+              size_t dst_off)
+{
+    uint8_t chain[HCA_AES_BLOCK_SIZE];
+    int rc;
+
+    rc = hca_aes_init(&_aes_session, _KEY_SP800_38A, sizeof(_KEY_SP800_38A));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize AES session");
+
+    memcpy(&_src_buf[src_off], in, length);
+    memset(_dst_buf, 0, sizeof(_dst_buf));
+    memcpy(chain, iv, sizeof(chain));
+
+    // process the message in two calls, chaining the IV/counter
+    size_t lengths[] = { first, length - first };
+    size_t pos = 0;
+    for (unsigned int ix=0; ix<ARRAY_SIZE(lengths); ix++) {
+        if ( mode == HCA_AES_CBC ) {
+            rc = hca_aes_cbc(&_aes_session, proc, &_dst_buf[dst_off+pos],
+                             &_src_buf[src_off+pos], lengths[ix], chain);
+        } else {
+            rc = hca_aes_ctr(&_aes_session, &_dst_buf[dst_off+pos],
+                             &_src_buf[src_off+pos], lengths[ix], chain);
+        }
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES failed");
+        pos += lengths[ix];
+    }
+
+    if ( memcmp(&_dst_buf[dst_off], ref, length) ) {
+        DUMP_HEX("Invalid output:", &_dst_buf[dst_off], length);
+        DUMP_HEX("Ref:           ", ref, length);
+        TEST_FAIL_MESSAGE("Output mismatch");
+    }
+}
+
+static void
+_test_gcm(enum hca_aes_process proc, const uint8_t * ref,
+          const uint8_t * reftag, const uint8_t * in, size_t length,
+          const uint8_t * aad, size_t aad_len,
+          size_t src_off, size_t dst_off, size_t aad_off)
+{
+    int rc;
+
+    rc = hca_aes_init(&_aes_session, _KEY_GCM, sizeof(_KEY_GCM));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize AES session");
+
+    memcpy(&_src_buf[src_off], in, length);
+    memcpy(&_aad_buf[aad_off], aad, aad_len);
+    memset(_dst_buf, 0, sizeof(_dst_buf));
+
+    rc = hca_aes_gcm(&_aes_session, proc, &_dst_buf[dst_off], _tag_buf,
+                     _IV_GCM, &_src_buf[src_off], length,
+                     &_aad_buf[aad_off], aad_len);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES GCM failed");
+
+    if ( memcmp(&_dst_buf[dst_off], ref, length) ) {
+        DUMP_HEX("Invalid output:", &_dst_buf[dst_off], length);
+        DUMP_HEX("Ref:           ", ref, length);
+        TEST_FAIL_MESSAGE("Output mismatch");
+    }
+
+    if ( memcmp(_tag_buf, reftag, HCA_AES_GCM_TAG_SIZE) ) {
+        DUMP_HEX("Invalid tag:", _tag_buf, HCA_AES_GCM_TAG_SIZE);
+        DUMP_HEX("Ref:        ", reftag, HCA_AES_GCM_TAG_SIZE);
+        TEST_FAIL_MESSAGE("Tag mismatch");
+    }
+}
+
+static void
+_test_gcm_stream(enum hca_aes_process proc, const uint8_t * ref,
+                 const uint8_t * reftag, const uint8_t * in, size_t length,
+                 const uint8_t * aad, size_t aad_len, size_t chunk,
+                 size_t dst_off)
+{
+    struct hca_aes_gcm_context gc;
+    size_t out_len;
+    int rc;
+
+    rc = hca_aes_init(&_aes_session, _KEY_GCM, sizeof(_KEY_GCM));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize AES session");
+
+    memcpy(_src_buf, in, length);
+    memcpy(_aad_buf, aad, aad_len);
+    memset(_dst_buf, 0, sizeof(_dst_buf));
+
+    rc = hca_aes_gcm_start(&gc, &_aes_session, proc, _IV_GCM, aad_len,
+                           length);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot start AES GCM");
+
+    // chunks do not match AES blocks, nor DMA alignment
+    for (size_t pos=0; pos<aad_len; pos+=chunk) {
+        rc = hca_aes_gcm_aad_update(&gc, &_aad_buf[pos],
+                                    MIN(chunk, aad_len-pos));
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES GCM AAD failed");
+    }
+
+    uint8_t * dst = &_dst_buf[dst_off];
+    for (size_t pos=0; pos<length; pos+=chunk) {
+        rc = hca_aes_gcm_update(&gc, dst, &_src_buf[pos],
+                                MIN(chunk, length-pos), &out_len);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES GCM update failed");
+        dst += out_len;
+    }
+
+    rc = hca_aes_gcm_finish(&gc, dst, &out_len, _tag_buf);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES GCM finish failed");
+    dst += out_len;
+
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(length,
+                                     (size_t)(dst - &_dst_buf[dst_off]),
+                                     "Output length mismatch");
+
+    if ( memcmp(&_dst_buf[dst_off], ref, length) ) {
+        DUMP_HEX("Invalid output:", &_dst_buf[dst_off], length);
+        DUMP_HEX("Ref:           ", ref, length);
+        TEST_FAIL_MESSAGE("Output mismatch");
+    }
+
+    if ( memcmp(_tag_buf, reftag, HCA_AES_GCM_TAG_SIZE) ) {
+        DUMP_HEX("Invalid tag:", _tag_buf, HCA_AES_GCM_TAG_SIZE);
+        DUMP_HEX("Ref:        ", reftag, HCA_AES_GCM_TAG_SIZE);
+        TEST_FAIL_MESSAGE("Tag mismatch");
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(hca_aes);
+
+TEST_SETUP(hca_aes)
+{
+    QEMU_IO_STATS(0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_init(), "HCA is not available");
+}
+
+TEST_TEAR_DOWN(hca_aes)
+{
+    QEMU_IO_STATS(1);
+}
+
+TEST(hca_aes, ecb_aligned)
+{
+    _test_ecb(HCA_AES_ENCRYPT, _CIPHERTEXT_ECB, _PLAINTEXT_SP800_38A,
+              sizeof(_PLAINTEXT_SP800_38A), 0u, 0u);
+    _test_ecb(HCA_AES_DECRYPT, _PLAINTEXT_SP800_38A, _CIPHERTEXT_ECB,
+              sizeof(_CIPHERTEXT_ECB), 0u, 0u);
+}
+
+TEST(hca_aes, ecb_unaligned_src)
+{
+    _test_ecb(HCA_AES_ENCRYPT, _CIPHERTEXT_ECB, _PLAINTEXT_SP800_38A,
+              sizeof(_PLAINTEXT_SP800_38A), 5u, 0u);
+    _test_ecb(HCA_AES_DECRYPT, _PLAINTEXT_SP800_38A, _CIPHERTEXT_ECB,
+              sizeof(_CIPHERTEXT_ECB), 20u, 0u);
+}
+
+TEST(hca_aes, ecb_unaligned_dst)
+{
+    _test_ecb(HCA_AES_ENCRYPT, _CIPHERTEXT_ECB, _PLAINTEXT_SP800_38A,
+              sizeof(_PLAINTEXT_SP800_38A), 0u, 3u);
+    _test_ecb(HCA_AES_DECRYPT, _PLAINTEXT_SP800_38A, _CIPHERTEXT_ECB,
+              sizeof(_CIPHERTEXT_ECB), 7u, 1u);
+}
+
+TEST(hca_aes, ecb_word_offsets)
+{
+    // every misalignment within a FIFO word, on both sides
+    for (size_t src_off=0; src_off<=sizeof(uint64_t); src_off++) {
+        for (size_t dst_off=0; dst_off<=sizeof(uint64_t); dst_off++) {
+            _test_ecb(HCA_AES_ENCRYPT, _CIPHERTEXT_ECB, _PLAINTEXT_SP800_38A,
+                      sizeof(_PLAINTEXT_SP800_38A), src_off, dst_off);
+        }
+    }
+}
+
+TEST(hca_aes, ecb_aes192)
+{
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_init(&_aes_session, _KEY_SP800_38A_192,
+                                          sizeof(_KEY_SP800_38A_192)));
+    _test_ecb_session(&_aes_session, HCA_AES_ENCRYPT, _CIPHERTEXT_ECB_192,
+                      _PLAINTEXT_SP800_38A, sizeof(_PLAINTEXT_SP800_38A));
+    _test_ecb_session(&_aes_session, HCA_AES_DECRYPT, _PLAINTEXT_SP800_38A,
+                      _CIPHERTEXT_ECB_192, sizeof(_CIPHERTEXT_ECB_192));
+}
+
+TEST(hca_aes, ecb_aes256)
+{
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_init(&_aes_session, _KEY_SP800_38A_256,
+                                          sizeof(_KEY_SP800_38A_256)));
+    _test_ecb_session(&_aes_session, HCA_AES_ENCRYPT, _CIPHERTEXT_ECB_256,
+                      _PLAINTEXT_SP800_38A, sizeof(_PLAINTEXT_SP800_38A));
+    _test_ecb_session(&_aes_session, HCA_AES_DECRYPT, _PLAINTEXT_SP800_38A,
+                      _CIPHERTEXT_ECB_256, sizeof(_CIPHERTEXT_ECB_256));
+}
+
+TEST(hca_aes, key_switch)
+{
+    static struct hca_aes_session sessions[3u];
+    static const uint8_t * const keys[ARRAY_SIZE(sessions)] = {
+        _KEY_SP800_38A, _KEY_SP800_38A_192, _KEY_SP800_38A_256,
+    };
+    static const size_t key_lens[ARRAY_SIZE(sessions)] = {
+        sizeof(_KEY_SP800_38A), sizeof(_KEY_SP800_38A_192),
+        sizeof(_KEY_SP800_38A_256),
+    };
+    static const uint8_t * const refs[ARRAY_SIZE(sessions)] = {
+        _CIPHERTEXT_ECB, _CIPHERTEXT_ECB_192, _CIPHERTEXT_ECB_256,
+    };
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(sessions); ix++) {
+        TEST_ASSERT_EQUAL_INT(0, hca_aes_init(&sessions[ix], keys[ix],
+                                              key_lens[ix]));
+    }
+
+    // same session twice in a row, then switch to the next one
+    for (unsigned int loop=0; loop<2u*ARRAY_SIZE(sessions); loop++) {
+        unsigned int ix = (loop/2u) % ARRAY_SIZE(sessions);
+        _test_ecb_session(&sessions[ix], HCA_AES_ENCRYPT, refs[ix],
+                          _PLAINTEXT_SP800_38A,
+                          sizeof(_PLAINTEXT_SP800_38A));
+    }
+
+    // a session initialized again should not reuse its former, loaded key
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_init(&sessions[2u], keys[0u],
+                                          key_lens[0u]));
+    _test_ecb_session(&sessions[2u], HCA_AES_ENCRYPT, refs[0u],
+                      _PLAINTEXT_SP800_38A, sizeof(_PLAINTEXT_SP800_38A));
+}
+
+TEST(hca_aes, cbc_chained)
+{
+    _test_chained(HCA_AES_CBC, HCA_AES_ENCRYPT, _CIPHERTEXT_CBC,
+                  _PLAINTEXT_SP800_38A, sizeof(_PLAINTEXT_SP800_38A),
+                  _IV_CBC, 16u, 0u, 0u);
+    _test_chained(HCA_AES_CBC, HCA_AES_ENCRYPT, _CIPHERTEXT_CBC,
+                  _PLAINTEXT_SP800_38A, sizeof(_PLAINTEXT_SP800_38A),
+                  _IV_CBC, 32u, 5u, 3u);
+    _test_chained(HCA_AES_CBC, HCA_AES_DECRYPT, _PLAINTEXT_SP800_38A,
+                  _CIPHERTEXT_CBC, sizeof(_CIPHERTEXT_CBC),
+                  _IV_CBC, 48u, 0u, 0u);
+
+    // in place decryption should not lose the chaining block
+    uint8_t iv[HCA_AES_BLOCK_SIZE];
+    memcpy(iv, _IV_CBC, sizeof(iv));
+    memcpy(_src_buf, _CIPHERTEXT_CBC, sizeof(_CIPHERTEXT_CBC));
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_cbc(&_aes_session, HCA_AES_DECRYPT,
+                                         _src_buf, _src_buf, 32u, iv));
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_cbc(&_aes_session, HCA_AES_DECRYPT,
+                                         &_src_buf[32u], &_src_buf[32u],
+                                         32u, iv));
+    TEST_ASSERT_EQUAL_MEMORY(_PLAINTEXT_SP800_38A, _src_buf,
+                             sizeof(_PLAINTEXT_SP800_38A));
+}
+
+TEST(hca_aes, ctr_chained)
+{
+    _test_chained(HCA_AES_CTR, HCA_AES_ENCRYPT, _CIPHERTEXT_CTR,
+                  _PLAINTEXT_SP800_38A, sizeof(_PLAINTEXT_SP800_38A),
+                  _CTR_CTR, 32u, 0u, 0u);
+    _test_chained(HCA_AES_CTR, HCA_AES_DECRYPT, _PLAINTEXT_SP800_38A,
+                  _CIPHERTEXT_CTR, sizeof(_CIPHERTEXT_CTR),
+                  _CTR_CTR, 16u, 7u, 0u);
+    // last call w/ an incomplete block
+    _test_chained(HCA_AES_CTR, HCA_AES_ENCRYPT, _CIPHERTEXT_CTR,
+                  _PLAINTEXT_SP800_38A, sizeof(_PLAINTEXT_SP800_38A) - 3u,
+                  _CTR_CTR, 48u, 0u, 1u);
+}
+
+TEST(hca_aes, gcm_aligned)
+{
+    _test_gcm(HCA_AES_ENCRYPT, _CIPHERTEXT_GCM, _TAG_GCM,
+              _PLAINTEXT_GCM, sizeof(_PLAINTEXT_GCM),
+              _AAD_GCM, sizeof(_AAD_GCM), 0u, 0u, 0u);
+    _test_gcm(HCA_AES_DECRYPT, _PLAINTEXT_GCM, _TAG_GCM,
+              _CIPHERTEXT_GCM, sizeof(_CIPHERTEXT_GCM),
+              _AAD_GCM, sizeof(_AAD_GCM), 0u, 0u, 0u);
+}
+
+TEST(hca_aes, gcm_unaligned)
+{
+    _test_gcm(HCA_AES_ENCRYPT, _CIPHERTEXT_GCM, _TAG_GCM,
+              _PLAINTEXT_GCM, sizeof(_PLAINTEXT_GCM),
+              _AAD_GCM, sizeof(_AAD_GCM), 9u, 0u, 3u);
+    _test_gcm(HCA_AES_DECRYPT, _PLAINTEXT_GCM, _TAG_GCM,
+              _CIPHERTEXT_GCM, sizeof(_CIPHERTEXT_GCM),
+              _AAD_GCM, sizeof(_AAD_GCM), 0u, 4u, 0u);
+}
+
+TEST(hca_aes, gcm_partial)
+{
+    uint8_t plaintext[sizeof(_CIPHERTEXT_GCM_PARTIAL)];
+    uint8_t aad[20u];
+
+    for (unsigned int ix=0; ix<sizeof(plaintext); ix++) {
+        plaintext[ix] = (uint8_t)ix;
+    }
+    for (unsigned int ix=0; ix<sizeof(aad); ix++) {
+        aad[ix] = (uint8_t)(0x80u + ix);
+    }
+
+    _test_gcm(HCA_AES_ENCRYPT, _CIPHERTEXT_GCM_PARTIAL, _TAG_GCM_PARTIAL,
+              plaintext, sizeof(plaintext), aad, sizeof(aad), 0u, 0u, 0u);
+    _test_gcm(HCA_AES_DECRYPT, plaintext, _TAG_GCM_PARTIAL,
+              _CIPHERTEXT_GCM_PARTIAL, sizeof(_CIPHERTEXT_GCM_PARTIAL),
+              aad, sizeof(aad), 3u, 0u, 1u);
+}
+
+TEST(hca_aes, gcm_stream)
+{
+    static const size_t chunks[] = { 1u, 5u, 16u, 21u, 64u };
+    uint8_t plaintext[sizeof(_CIPHERTEXT_GCM_PARTIAL)];
+    uint8_t aad[20u];
+
+    for (unsigned int ix=0; ix<sizeof(plaintext); ix++) {
+        plaintext[ix] = (uint8_t)ix;
+    }
+    for (unsigned int ix=0; ix<sizeof(aad); ix++) {
+        aad[ix] = (uint8_t)(0x80u + ix);
+    }
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(chunks); ix++) {
+        _test_gcm_stream(HCA_AES_ENCRYPT, _CIPHERTEXT_GCM, _TAG_GCM,
+                         _PLAINTEXT_GCM, sizeof(_PLAINTEXT_GCM),
+                         _AAD_GCM, sizeof(_AAD_GCM), chunks[ix], 0u);
+        _test_gcm_stream(HCA_AES_DECRYPT, _PLAINTEXT_GCM, _TAG_GCM,
+                         _CIPHERTEXT_GCM, sizeof(_CIPHERTEXT_GCM),
+                         _AAD_GCM, sizeof(_AAD_GCM), chunks[ix], 7u);
+        _test_gcm_stream(HCA_AES_ENCRYPT, _CIPHERTEXT_GCM_PARTIAL,
+                         _TAG_GCM_PARTIAL, plaintext, sizeof(plaintext),
+                         aad, sizeof(aad), chunks[ix], 0u);
+        _test_gcm_stream(HCA_AES_DECRYPT, plaintext, _TAG_GCM_PARTIAL,
+                         _CIPHERTEXT_GCM_PARTIAL,
+                         sizeof(_CIPHERTEXT_GCM_PARTIAL),
+                         aad, sizeof(aad), chunks[ix], 3u);
+    }
+}
+
+TEST(hca_aes, config_resync)
+{
+    // same configuration twice: the second request skips the CR writes
+    _test_ecb(HCA_AES_ENCRYPT, _CIPHERTEXT_ECB, _PLAINTEXT_SP800_38A,
+              sizeof(_PLAINTEXT_SP800_38A), 0u, 0u);
+    _test_ecb(HCA_AES_ENCRYPT, _CIPHERTEXT_ECB, _PLAINTEXT_SP800_38A,
+              sizeof(_PLAINTEXT_SP800_38A), 0u, 0u);
+
+    // program the engine behind the driver, which hca_init should detect
+    _hca_updreg32(METAL_SIFIVE_HCA_AES_CR, 1u,
+                  HCA_REGISTER_AES_CR_PROCESS_OFFSET,
+                  HCA_REGISTER_AES_CR_PROCESS_MASK);
+    _hca_updreg32(METAL_SIFIVE_HCA_CR, 0u,
+                  HCA_REGISTER_CR_ENDIANNESS_OFFSET,
+                  HCA_REGISTER_CR_ENDIANNESS_MASK);
+    TEST_ASSERT_EQUAL_INT(0, hca_init());
+
+    _test_ecb(HCA_AES_ENCRYPT, _CIPHERTEXT_ECB, _PLAINTEXT_SP800_38A,
+              sizeof(_PLAINTEXT_SP800_38A), 0u, 0u);
+}
+
+TEST(hca_aes, invalid)
+{
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_aes_init(&_aes_session, _KEY_GCM, 8u));
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_init(&_aes_session, _KEY_GCM,
+                                          sizeof(_KEY_GCM)));
+    // ECB length should be a multiple of the block size
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+                          hca_aes_ecb(&_aes_session, HCA_AES_ENCRYPT,
+                                      _dst_buf, _src_buf, 15u));
+
+    // the AES engine is reserved by a streaming context
+    struct hca_aes_gcm_context gc;
+    size_t out_len;
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_gcm_start(&gc, &_aes_session,
+                                               HCA_AES_ENCRYPT, _IV_GCM,
+                                               4u, 0u));
+    TEST_ASSERT_EQUAL_INT(-EBUSY,
+                          hca_aes_ecb(&_aes_session, HCA_AES_ENCRYPT,
+                                      _dst_buf, _src_buf, 16u));
+    // payload cannot be fed before the whole AAD
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+                          hca_aes_gcm_update(&gc, _dst_buf, _src_buf, 1u,
+                                             &out_len));
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+                          hca_aes_gcm_aad_update(&gc, _aad_buf, 5u));
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_gcm_aad_update(&gc, _aad_buf, 4u));
+    TEST_ASSERT_EQUAL_INT(0, hca_aes_gcm_finish(&gc, _dst_buf, &out_len,
+                                                _tag_buf));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_aes_gcm_finish(&gc, _dst_buf,
+                                                      &out_len, _tag_buf));
+}
+
+TEST_GROUP_RUNNER(hca_aes)
+{
+    RUN_TEST_CASE(hca_aes, ecb_aligned);
+    RUN_TEST_CASE(hca_aes, ecb_unaligned_src);
+    RUN_TEST_CASE(hca_aes, ecb_unaligned_dst);
+    RUN_TEST_CASE(hca_aes, ecb_word_offsets);
+    RUN_TEST_CASE(hca_aes, ecb_aes192);
+    RUN_TEST_CASE(hca_aes, ecb_aes256);
+    RUN_TEST_CASE(hca_aes, key_switch);
+    RUN_TEST_CASE(hca_aes, cbc_chained);
+    RUN_TEST_CASE(hca_aes, ctr_chained);
+    RUN_TEST_CASE(hca_aes, gcm_aligned);
+    RUN_TEST_CASE(hca_aes, gcm_unaligned);
+    RUN_TEST_CASE(hca_aes, gcm_partial);
+    RUN_TEST_CASE(hca_aes, gcm_stream);
+    RUN_TEST_CASE(hca_aes, config_resync);
+    RUN_TEST_CASE(hca_aes, invalid);
+}
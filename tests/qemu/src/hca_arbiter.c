@@ -0,0 +1,205 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "metal/cpu.h"
+#include "hca/aes.h"
+#include "hca/arbiter.h"
+#include "unity_fixture.h"
+#include "dma_test.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define ARBITER_LOOPS   32u
+#define ARBITER_TIMEOUT (2u*TIME_BASE)
+
+// NIST SP 800-38A, F.1.1
+static const uint8_t _KEY_ECB[] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88,
+    0x09, 0xCF, 0x4F, 0x3C,
+};
+
+static const uint8_t _PLAINTEXT_ECB[64u] = {
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11,
+    0x73, 0x93, 0x17, 0x2A, 0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C,
+    0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51, 0x30, 0xC8, 0x1C, 0x46,
+    0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+    0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B,
+    0xE6, 0x6C, 0x37, 0x10,
+};
+
+static const uint8_t _CIPHERTEXT_ECB[64u] = {
+    0x3A, 0xD7, 0x7B, 0xB4, 0x0D, 0x7A, 0x36, 0x60, 0xA8, 0x9E, 0xCA, 0xF3,
+    0x24, 0x66, 0xEF, 0x97, 0xF5, 0xD3, 0xD5, 0x85, 0x03, 0xB9, 0x69, 0x9D,
+    0xE7, 0x85, 0x89, 0x5A, 0x96, 0xFD, 0xBA, 0xAF, 0x43, 0xB1, 0xCD, 0x7F,
+    0x59, 0x8E, 0xCE, 0x23, 0x88, 0x1B, 0x00, 0xE3, 0xED, 0x03, 0x06, 0x88,
+    0x7B, 0x0C, 0x78, 0x5E, 0x27, 0xE8, 0xAD, 0x3F, 0x82, 0x23, 0x20, 0x71,
+    0x04, 0x72, 0x5D, 0xD4,
+};
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** Per-hart work, as Unity assertions may only be used from hart #0 */
+struct hart_work {
+    uint8_t hw_src[64u] ALIGN(DMA_ALIGNMENT);
+    uint8_t hw_dst[64u] ALIGN(DMA_ALIGNMENT);
+    struct hca_aes_session hw_aes;
+    enum hca_aes_process hw_process;
+    const uint8_t * hw_ref;
+    int hw_rc;                  /**< First error */
+    unsigned int hw_mismatches; /**< Count of invalid results */
+    unsigned int hw_contended;  /**< Count of requests which waited */
+    volatile bool hw_done;
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static struct hart_work _works[2u];
+
+//-----------------------------------------------------------------------------
+// HCA arbiter test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_arbiter_init_work(struct hart_work * work, enum hca_aes_process process,
+                   const uint8_t * in, const uint8_t * ref)
+{
+    memset(work, 0, sizeof(*work));
+    memcpy(work->hw_src, in, sizeof(work->hw_src));
+    work->hw_process = process;
+    work->hw_ref = ref;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_aes_init(&work->hw_aes, _KEY_ECB,
+                                                  sizeof(_KEY_ECB)),
+                                  "Cannot initialize AES session");
+}
+
+static void
+_arbiter_run(struct hart_work * work)
+{
+    for (unsigned int ix=0; ix<ARBITER_LOOPS; ix++) {
+        int rc = hca_arbiter_try_acquire();
+        if ( rc == -EBUSY ) {
+            work->hw_contended += 1u;
+            rc = hca_arbiter_acquire();
+        }
+        if ( ! rc ) {
+            memset(work->hw_dst, 0, sizeof(work->hw_dst));
+            rc = hca_aes_ecb(&work->hw_aes, work->hw_process, work->hw_dst,
+                             work->hw_src, sizeof(work->hw_src));
+            int xrc = hca_arbiter_release();
+            if ( ! rc ) {
+                rc = xrc;
+            }
+        }
+        if ( rc ) {
+            work->hw_rc = rc;
+            break;
+        }
+        if ( memcmp(work->hw_dst, work->hw_ref, sizeof(work->hw_dst)) ) {
+            work->hw_mismatches += 1u;
+        }
+    }
+
+    work->hw_done = true;
+}
+
+static void
+_arbiter_main_hart_1(void)
+{
+    // acknowledge the wake up request
+    qemu_signal_hart(1u, false);
+
+    _arbiter_run(&_works[1u]);
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(hca_arbiter);
+
+TEST_SETUP(hca_arbiter)
+{
+    QEMU_IO_STATS(0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_init(), "HCA is not available");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_arbiter_init(),
+                                  "Cannot initialize HCA arbiter");
+}
+
+TEST_TEAR_DOWN(hca_arbiter)
+{
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_arbiter_fini(),
+                                  "Cannot release HCA arbiter");
+    QEMU_IO_STATS(1);
+}
+
+TEST(hca_arbiter, dual_hart)
+{
+    if ( metal_cpu_get_num_harts() < 2 ) {
+        TEST_IGNORE_MESSAGE("Single hart platform");
+    }
+
+    // hart #0 encrypts while hart #1 decrypts: any register clobbering
+    // from the other hart would corrupt the result
+    _arbiter_init_work(&_works[0u], HCA_AES_ENCRYPT, _PLAINTEXT_ECB,
+                       _CIPHERTEXT_ECB);
+    _arbiter_init_work(&_works[1u], HCA_AES_DECRYPT, _CIPHERTEXT_ECB,
+                       _PLAINTEXT_ECB);
+
+    qemu_register_hart_task(1u, &_arbiter_main_hart_1);
+    qemu_signal_hart(1u, true);
+
+    _arbiter_run(&_works[0u]);
+
+    uint64_t timeout = now() + ARBITER_TIMEOUT;
+    while ( ! _works[1u].hw_done ) {
+        TEST_ASSERT_TRUE_MESSAGE(now() < timeout, "Hart #1 timed out");
+    }
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_works); ix++) {
+        const struct hart_work * work = &_works[ix];
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, work->hw_rc, "Request failed");
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, work->hw_mismatches,
+                                       "AES mismatch");
+        printf("Hart #%u: %u/%u contended requests\n", ix,
+               work->hw_contended, ARBITER_LOOPS);
+    }
+
+    TEST_ASSERT_EQUAL_INT(HCA_ARBITER_NO_OWNER, hca_arbiter_owner());
+}
+
+TEST(hca_arbiter, invalid)
+{
+    int hartid = metal_cpu_get_current_hartid();
+
+    TEST_ASSERT_EQUAL_INT(-EPERM, hca_arbiter_release());
+
+    TEST_ASSERT_EQUAL_INT(0, hca_arbiter_acquire());
+    TEST_ASSERT_EQUAL_INT(hartid, hca_arbiter_owner());
+    // requests do not nest
+    TEST_ASSERT_EQUAL_INT(-EDEADLK, hca_arbiter_acquire());
+    TEST_ASSERT_EQUAL_INT(-EDEADLK, hca_arbiter_try_acquire());
+    // cannot be released while owned
+    TEST_ASSERT_EQUAL_INT(-EBUSY, hca_arbiter_fini());
+    TEST_ASSERT_EQUAL_INT(-EBUSY, hca_arbiter_init());
+
+    TEST_ASSERT_EQUAL_INT(0, hca_arbiter_release());
+    TEST_ASSERT_EQUAL_INT(HCA_ARBITER_NO_OWNER, hca_arbiter_owner());
+    TEST_ASSERT_EQUAL_INT(0, hca_arbiter_try_acquire());
+    TEST_ASSERT_EQUAL_INT(0, hca_arbiter_release());
+}
+
+TEST_GROUP_RUNNER(hca_arbiter)
+{
+    RUN_TEST_CASE(hca_arbiter, dual_hart);
+    RUN_TEST_CASE(hca_arbiter, invalid);
+}
@@ -0,0 +1,219 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "hca/drbg.h"
+#include "hca/trng.h"
+#include "unity_fixture.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define TRNG_POOL_SIZE 64u  // words
+#define OUT_BUF_SIZE (2u*PAGE_SIZE)  // bytes
+
+// AES-128 CTR_DRBG, no derivation function, no prediction resistance:
+// instantiate, reseed, then generate twice; only the second output is
+// checked, as for the NIST CAVP vectors
+static const uint8_t _ENTROPY[] = {
+    0x76, 0x50, 0x63, 0x9B, 0x08, 0x94, 0xD7, 0x20, 0x98, 0xC7, 0x28, 0x0B,
+    0x34, 0xD2, 0x38, 0xEF, 0x82, 0x52, 0xBA, 0x24, 0x0B, 0xBC, 0xE4, 0xF5,
+    0xF4, 0x72, 0x88, 0x50, 0x9A, 0xB6, 0xF6, 0x80,
+};
+
+static const uint8_t _PERSO[] = {
+    0x12, 0x43, 0x60, 0xC3, 0xA5, 0x1B, 0x3A, 0x42, 0xB5, 0x9C, 0xAD, 0x90,
+    0xD6, 0x65, 0xF6, 0xE5, 0xE9, 0xCD, 0xC7, 0xC5,
+};
+
+static const uint8_t _ENTROPY_RESEED[] = {
+    0x3E, 0x1E, 0x6E, 0xAA, 0x34, 0xB3, 0xDC, 0xCE, 0xD9, 0xCB, 0x8C, 0xCD,
+    0x16, 0x39, 0xE2, 0x0B, 0xFE, 0x83, 0x06, 0xB4, 0xF5, 0xC4, 0x7C, 0xCB,
+    0x89, 0xBE, 0xC3, 0xF3, 0xA1, 0xB8, 0x7B, 0x46,
+};
+
+static const uint8_t _ADD_RESEED[] = {
+    0x74, 0xD6, 0x4A, 0x2A, 0x32, 0xFC, 0x24, 0xEA, 0xF8, 0x2B, 0x5E, 0xB8,
+    0x2B, 0x6D, 0x46, 0x64, 0x15, 0xE5, 0x2C, 0x74, 0xE7, 0x71, 0x01, 0x98,
+    0x8C, 0x5E, 0x3C, 0x0D, 0xA6, 0xA9, 0x1B, 0x69,
+};
+
+static const uint8_t _ADD_1[] = {
+    0xF7, 0x02, 0x3F, 0xFC, 0x70, 0xCE, 0x0E, 0xC0, 0xBF, 0x38, 0x9D, 0xCC,
+    0x78, 0x3E, 0x5D, 0xF5, 0x81, 0x3F, 0x49, 0xE2, 0x2D, 0xDC, 0x97, 0x50,
+    0x57, 0x61, 0xDF, 0x6F, 0xC9, 0xCF, 0x72, 0x64,
+};
+
+static const uint8_t _ADD_2[] = {
+    0x54, 0x21, 0x7D, 0xB1, 0xFF, 0x66, 0x7E, 0x50, 0xF0, 0x12, 0x47, 0xBD,
+    0x16, 0x59, 0x5C, 0xC6, 0x07, 0xCC, 0x2C, 0x65, 0xCB, 0xA6, 0xCB, 0x77,
+    0x17, 0x6B, 0x86, 0xD5, 0xE6, 0x71, 0x42, 0x02,
+};
+
+static const uint8_t _OUTPUT[] = {
+    0xFC, 0xE7, 0x23, 0x5D, 0xD4, 0x7C, 0x21, 0x13, 0x5A, 0x51, 0xB3, 0xAC,
+    0xB0, 0x2A, 0xB4, 0x86, 0xDF, 0x57, 0x04, 0xB3, 0xFF, 0x9A, 0x64, 0xA5,
+    0x75, 0x04, 0x1B, 0xE3, 0xF8, 0x47, 0xAC, 0x1D, 0x57, 0x6F, 0x7E, 0xF5,
+    0x05, 0x19, 0x36, 0x59, 0x1C, 0xB9, 0x2E, 0x62, 0x14, 0xE3, 0xF7, 0x01,
+    0x0A, 0xB7, 0xE8, 0x09, 0x5F, 0xF5, 0x6A, 0xD1, 0xC5, 0x96, 0x1F, 0xB9,
+    0xAA, 0xBD, 0xEE, 0xC4,
+};
+
+// same entropy input, no personalization nor additional input
+static const uint8_t _OUTPUT_NO_ADD[] = {
+    0x15, 0x0A, 0x95, 0x34, 0xE9, 0x4E, 0x43, 0x7B, 0x0F, 0x2B, 0x8B, 0x04,
+    0xAF, 0x1B, 0x9C, 0x08, 0x44, 0x8F, 0x62, 0xB2, 0x0A, 0xC5, 0xEE, 0xB8,
+    0xB4, 0x23, 0xEF, 0x9C, 0x47, 0xE1, 0x37, 0xD8, 0xA7, 0xB0, 0x59, 0x95,
+    0xD7, 0x05, 0x8A, 0xAD, 0x79, 0x00, 0x81, 0x22, 0x4A, 0x14, 0x3E, 0x69,
+    0xAB, 0x1F, 0xA5, 0x1D, 0xB3, 0xC7, 0xFE, 0x50, 0x10, 0x2D, 0xEB, 0x51,
+    0x68, 0xF5, 0x05, 0x31,
+};
+
+// reseed entropy input as entropy input, incomplete last block
+static const uint8_t _OUTPUT_SHORT[] = {
+    0xDA, 0xCD, 0x06, 0x1A, 0xC1, 0xC7, 0x09, 0x4E, 0x20, 0x1E, 0x3F, 0x63,
+    0x62, 0x1A, 0x08, 0x72, 0xE2, 0xF5, 0x88, 0x52, 0x0C, 0xF1, 0x95, 0x0F,
+    0x20, 0xEE, 0x75, 0x25, 0xC6, 0x44, 0xA8, 0x11, 0x1C, 0x93, 0x1B, 0x93,
+    0xD0,
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static struct hca_drbg _drbg;
+static struct hca_trng _trng;
+static uint32_t _trng_words[TRNG_POOL_SIZE];
+static uint8_t * _out;
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(hca_drbg);
+
+TEST_SETUP(hca_drbg)
+{
+    QEMU_IO_STATS(0);
+    _out = metal_dma_pool_alloc(&dma_pool, OUT_BUF_SIZE);
+    TEST_ASSERT_NOT_NULL_MESSAGE(_out, "Cannot allocate DMA buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_init(), "HCA is not available");
+}
+
+TEST_TEAR_DOWN(hca_drbg)
+{
+    hca_drbg_fini(&_drbg);
+    metal_dma_pool_free(&dma_pool, _out, OUT_BUF_SIZE);
+    _out = NULL;
+    QEMU_IO_STATS(1);
+}
+
+TEST(hca_drbg, kat)
+{
+    int rc;
+
+    rc = hca_drbg_init(&_drbg, _ENTROPY, _PERSO, sizeof(_PERSO));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot instantiate DRBG");
+    rc = hca_drbg_reseed(&_drbg, _ENTROPY_RESEED, _ADD_RESEED,
+                         sizeof(_ADD_RESEED));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot reseed DRBG");
+    rc = hca_drbg_generate(&_drbg, _out, sizeof(_OUTPUT), _ADD_1,
+                           sizeof(_ADD_1));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot generate");
+    rc = hca_drbg_generate(&_drbg, _out, sizeof(_OUTPUT), _ADD_2,
+                           sizeof(_ADD_2));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot generate");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(_OUTPUT, _out, sizeof(_OUTPUT),
+                                         "DRBG output mismatch");
+}
+
+TEST(hca_drbg, kat_no_add)
+{
+    int rc;
+
+    rc = hca_drbg_init(&_drbg, _ENTROPY, NULL, 0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot instantiate DRBG");
+    for (unsigned int ix=0; ix<2u; ix++) {
+        // not DMA-aligned output
+        rc = hca_drbg_generate(&_drbg, &_out[4u], sizeof(_OUTPUT_NO_ADD),
+                               NULL, 0);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot generate");
+    }
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(_OUTPUT_NO_ADD, &_out[4u],
+                                         sizeof(_OUTPUT_NO_ADD),
+                                         "DRBG output mismatch");
+
+    rc = hca_drbg_init(&_drbg, _ENTROPY_RESEED, NULL, 0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot instantiate DRBG");
+    rc = hca_drbg_generate(&_drbg, _out, sizeof(_OUTPUT_SHORT), NULL, 0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot generate");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(_OUTPUT_SHORT, _out,
+                                         sizeof(_OUTPUT_SHORT),
+                                         "DRBG output mismatch");
+}
+
+TEST(hca_drbg, trng_seeded)
+{
+    int rc;
+
+    rc = hca_trng_init(&_trng, _trng_words, ARRAY_SIZE(_trng_words), true);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot init TRNG pool");
+
+    rc = hca_drbg_init(&_drbg, NULL, NULL, 0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot instantiate DRBG");
+
+    // many counter blocks in a single DMA request
+    size_t half = OUT_BUF_SIZE/2u;
+    rc = hca_drbg_generate(&_drbg, _out, half, NULL, 0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot generate");
+    rc = hca_drbg_reseed(&_drbg, NULL, NULL, 0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot reseed DRBG");
+    rc = hca_drbg_generate(&_drbg, &_out[half], half, NULL, 0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot generate");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_trng_fini(&_trng),
+                                  "Cannot release TRNG pool");
+
+    TEST_ASSERT_TRUE_MESSAGE(memcmp(_out, &_out[half], half),
+                             "DRBG output repeated");
+    for (unsigned int ix=0; ix<OUT_BUF_SIZE; ix+=HCA_AES_BLOCK_SIZE) {
+        static const uint8_t zero[HCA_AES_BLOCK_SIZE];
+        TEST_ASSERT_TRUE_MESSAGE(memcmp(&_out[ix], zero, sizeof(zero)),
+                                 "Zero block found");
+    }
+
+    // no entropy source left
+    rc = hca_drbg_reseed(&_drbg, NULL, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(-ENODEV, rc);
+}
+
+TEST(hca_drbg, invalid)
+{
+    uint8_t add[HCA_DRBG_SEED_SIZE+1u];
+
+    memset(add, 0, sizeof(add));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_drbg_init(&_drbg, _ENTROPY, add,
+                                                 sizeof(add)));
+    TEST_ASSERT_EQUAL_INT(0, hca_drbg_init(&_drbg, _ENTROPY, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+                          hca_drbg_generate(&_drbg, _out,
+                                            HCA_DRBG_MAX_REQUEST+1u, NULL,
+                                            0));
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+                          hca_drbg_generate(&_drbg, _out, 16u, add,
+                                            sizeof(add)));
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+                          hca_drbg_reseed(&_drbg, _ENTROPY, NULL, 1u));
+}
+
+TEST_GROUP_RUNNER(hca_drbg)
+{
+    RUN_TEST_CASE(hca_drbg, kat);
+    RUN_TEST_CASE(hca_drbg, kat_no_add);
+    RUN_TEST_CASE(hca_drbg, trng_seeded);
+    RUN_TEST_CASE(hca_drbg, invalid);
+}
@@ -0,0 +1,204 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "hca/etm.h"
+#include "unity_fixture.h"
+#include "dma_test.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define QUEUE_SIZE  4u  // jobs
+
+/** Several segments, the last one being a partial one */
+#define ETM_LENGTH  (3u*HCA_ETM_SEGMENT_SIZE + 64u)  // bytes
+
+/** Source, destination and reference buffers share the long DMA buffer */
+#define ETM_BUF_SIZE (DMA_LONG_BUF_SIZE/4u)
+
+#if ETM_LENGTH > ETM_BUF_SIZE
+# error "ETM buffers do not fit in the long DMA buffer"
+#endif
+
+// NIST SP 800-38A, F.2.1
+static const uint8_t _KEY[] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88,
+    0x09, 0xCF, 0x4F, 0x3C,
+};
+
+static const uint8_t _IV[HCA_AES_BLOCK_SIZE] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+    0x0C, 0x0D, 0x0E, 0x0F,
+};
+
+/** Message prefix hashed before the ciphertext, e.g. a HMAC key block */
+static const uint8_t _PREFIX[HCA_SHA256_BLOCK_SIZE] = {
+    0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static struct hca_queue _queue;
+static struct hca_job _jobs[QUEUE_SIZE];
+static struct hca_aes_session _aes;
+static struct hca_sha_session _sha;
+static struct hca_etm _etm;
+static uint8_t * _src_buf;
+static uint8_t * _dst_buf;
+static uint8_t * _ref_buf;
+
+//-----------------------------------------------------------------------------
+// HCA encrypt-then-MAC test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_check_buf(const char * msg, const uint8_t * buf, const uint8_t * ref,
+           size_t length)
+{
+    if ( memcmp(buf, ref, length) ) {
+        for (size_t pos=0; pos<length; pos+=HCA_AES_BLOCK_SIZE) {
+            if ( memcmp(&buf[pos], &ref[pos], HCA_AES_BLOCK_SIZE) ) {
+                printf("Mismatch @ %zu\n", pos);
+                DUMP_HEX("Invalid:", &buf[pos], HCA_AES_BLOCK_SIZE);
+                DUMP_HEX("Ref:    ", &ref[pos], HCA_AES_BLOCK_SIZE);
+                break;
+            }
+        }
+        TEST_FAIL_MESSAGE(msg);
+    }
+}
+
+static void
+_test_etm(enum hca_aes_mode mode)
+{
+    uint8_t ref_iv[HCA_AES_BLOCK_SIZE];
+    uint8_t ref_hash[HCA_SHA_MAX_DIGEST_SIZE];
+    uint8_t iv[HCA_AES_BLOCK_SIZE];
+    uint8_t hash[HCA_SHA_MAX_DIGEST_SIZE];
+    size_t hash_len = hca_sha_digest_size(HCA_SHA256);
+    int rc;
+
+    for (unsigned int ix=0; ix<ETM_LENGTH; ix++) {
+        _src_buf[ix] = (uint8_t)(ix * 13u + 7u);
+    }
+
+    // reference: encrypt, then hash the ciphertext in a second pass
+    memcpy(ref_iv, _IV, sizeof(ref_iv));
+    if ( mode == HCA_AES_CTR ) {
+        rc = hca_aes_ctr(&_aes, _ref_buf, _src_buf, ETM_LENGTH, ref_iv);
+    } else {
+        rc = hca_aes_cbc(&_aes, HCA_AES_ENCRYPT, _ref_buf, _src_buf,
+                         ETM_LENGTH, ref_iv);
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "AES failed");
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_init(&_sha, HCA_SHA256));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_update(&_sha, _PREFIX,
+                                            sizeof(_PREFIX)));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_update(&_sha, _ref_buf, ETM_LENGTH));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_final(&_sha, ref_hash,
+                                           sizeof(ref_hash)));
+
+    // chained encryption
+    TEST_ASSERT_EQUAL_INT(0, hca_etm_init(&_etm, &_queue, &_aes, mode,
+                                          &_sha));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_update(&_sha, _PREFIX,
+                                            sizeof(_PREFIX)));
+    memcpy(iv, _IV, sizeof(iv));
+    memset(_dst_buf, 0, ETM_LENGTH);
+    rc = hca_etm_encrypt(&_etm, _dst_buf, _src_buf, ETM_LENGTH, iv);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "ETM encryption failed");
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_final(&_sha, hash, sizeof(hash)));
+    _check_buf("Ciphertext mismatch", _dst_buf, _ref_buf, ETM_LENGTH);
+    _check_buf("Hash mismatch", hash, ref_hash, hash_len);
+    _check_buf("IV mismatch", iv, ref_iv, sizeof(iv));
+
+    // chained decryption, in place
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_update(&_sha, _PREFIX,
+                                            sizeof(_PREFIX)));
+    memcpy(iv, _IV, sizeof(iv));
+    rc = hca_etm_decrypt(&_etm, _dst_buf, _dst_buf, ETM_LENGTH, iv);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "ETM decryption failed");
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_final(&_sha, hash, sizeof(hash)));
+    _check_buf("Plaintext mismatch", _dst_buf, _src_buf, ETM_LENGTH);
+    _check_buf("Hash mismatch", hash, ref_hash, hash_len);
+    _check_buf("IV mismatch", iv, ref_iv, sizeof(iv));
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(hca_etm);
+
+TEST_SETUP(hca_etm)
+{
+    QEMU_IO_STATS(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(qemu_dma_long_buf_get(),
+                                 "Cannot allocate DMA buffer");
+    _src_buf = dma_long_buf;
+    _dst_buf = &dma_long_buf[ETM_BUF_SIZE];
+    _ref_buf = &dma_long_buf[2u*ETM_BUF_SIZE];
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_init(), "HCA is not available");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_aes_init(&_aes, _KEY,
+                                                  sizeof(_KEY)),
+                                  "Cannot initialize AES session");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_queue_init(&_queue, _jobs,
+                                                    ARRAY_SIZE(_jobs)),
+                                  "Cannot initialize HCA queue");
+}
+
+TEST_TEAR_DOWN(hca_etm)
+{
+    int rc = hca_queue_fini(&_queue);
+    qemu_dma_long_buf_put();
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot release HCA queue");
+    QEMU_IO_STATS(1);
+}
+
+TEST(hca_etm, cbc)
+{
+    _test_etm(HCA_AES_CBC);
+}
+
+TEST(hca_etm, ctr)
+{
+    _test_etm(HCA_AES_CTR);
+}
+
+TEST(hca_etm, invalid)
+{
+    uint8_t iv[HCA_AES_BLOCK_SIZE];
+
+    memcpy(iv, _IV, sizeof(iv));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_etm_init(&_etm, &_queue, &_aes,
+                                                HCA_AES_ECB, &_sha));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_init(&_sha, HCA_SHA256));
+    TEST_ASSERT_EQUAL_INT(0, hca_etm_init(&_etm, &_queue, &_aes,
+                                          HCA_AES_CBC, &_sha));
+    // not a multiple of the AES block size
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_etm_encrypt(&_etm, _dst_buf,
+                                                   _src_buf, 15u, iv));
+    // not DMA-aligned
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_etm_encrypt(&_etm, _dst_buf,
+                                                   &_src_buf[16u], 64u,
+                                                   iv));
+    // the hashed message does not end on a DMA block
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_update(&_sha, _PREFIX, 5u));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_etm_encrypt(&_etm, _dst_buf,
+                                                   _src_buf, 64u, iv));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_init(&_sha, HCA_SHA256));
+}
+
+TEST_GROUP_RUNNER(hca_etm)
+{
+    RUN_TEST_CASE(hca_etm, cbc);
+    RUN_TEST_CASE(hca_etm, ctr);
+    RUN_TEST_CASE(hca_etm, invalid);
+}
@@ -0,0 +1,195 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "hca/hmac.h"
+#include "unity_fixture.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+// RFC 4231 test cases; TC1 and TC6 messages are short enough to be copied
+// after the inner key block, TC7 message is streamed
+
+#define TC1_KEY_SIZE  20u   // bytes
+#define TC6_KEY_SIZE  131u  // bytes, longer than any SHA-2 block
+
+static const char _TC1_MSG[] = "Hi There";
+
+static const char _TC6_MSG[] =
+    "Test Using Larger Than Block-Size Key - Hash Key First";
+
+static const char _TC7_MSG[] =
+    "This is a test using a larger than block-size key and a larger than "
+    "block-size data. The key needs to be hashed before being used by the "
+    "HMAC algorithm.";
+
+static const uint8_t _TC1_HMAC_SHA256[] = {
+    0xb0, 0x34, 0x4c, 0x61, 0xd8, 0xdb, 0x38, 0x53, 0x5c, 0xa8, 0xaf, 0xce,
+    0xaf, 0x0b, 0xf1, 0x2b, 0x88, 0x1d, 0xc2, 0x00, 0xc9, 0x83, 0x3d, 0xa7,
+    0x26, 0xe9, 0x37, 0x6c, 0x2e, 0x32, 0xcf, 0xf7,
+};
+
+static const uint8_t _TC1_HMAC_SHA384[] = {
+    0xaf, 0xd0, 0x39, 0x44, 0xd8, 0x48, 0x95, 0x62, 0x6b, 0x08, 0x25, 0xf4,
+    0xab, 0x46, 0x90, 0x7f, 0x15, 0xf9, 0xda, 0xdb, 0xe4, 0x10, 0x1e, 0xc6,
+    0x82, 0xaa, 0x03, 0x4c, 0x7c, 0xeb, 0xc5, 0x9c, 0xfa, 0xea, 0x9e, 0xa9,
+    0x07, 0x6e, 0xde, 0x7f, 0x4a, 0xf1, 0x52, 0xe8, 0xb2, 0xfa, 0x9c, 0xb6,
+};
+
+static const uint8_t _TC1_HMAC_SHA512[] = {
+    0x87, 0xaa, 0x7c, 0xde, 0xa5, 0xef, 0x61, 0x9d, 0x4f, 0xf0, 0xb4, 0x24,
+    0x1a, 0x1d, 0x6c, 0xb0, 0x23, 0x79, 0xf4, 0xe2, 0xce, 0x4e, 0xc2, 0x78,
+    0x7a, 0xd0, 0xb3, 0x05, 0x45, 0xe1, 0x7c, 0xde, 0xda, 0xa8, 0x33, 0xb7,
+    0xd6, 0xb8, 0xa7, 0x02, 0x03, 0x8b, 0x27, 0x4e, 0xae, 0xa3, 0xf4, 0xe4,
+    0xbe, 0x9d, 0x91, 0x4e, 0xeb, 0x61, 0xf1, 0x70, 0x2e, 0x69, 0x6c, 0x20,
+    0x3a, 0x12, 0x68, 0x54,
+};
+
+static const uint8_t _TC6_HMAC_SHA256[] = {
+    0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f, 0x0d, 0x8a, 0x26, 0xaa,
+    0xcb, 0xf5, 0xb7, 0x7f, 0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14,
+    0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54,
+};
+
+static const uint8_t _TC6_HMAC_SHA512[] = {
+    0x80, 0xb2, 0x42, 0x63, 0xc7, 0xc1, 0xa3, 0xeb, 0xb7, 0x14, 0x93, 0xc1,
+    0xdd, 0x7b, 0xe8, 0xb4, 0x9b, 0x46, 0xd1, 0xf4, 0x1b, 0x4a, 0xee, 0xc1,
+    0x12, 0x1b, 0x01, 0x37, 0x83, 0xf8, 0xf3, 0x52, 0x6b, 0x56, 0xd0, 0x37,
+    0xe0, 0x5f, 0x25, 0x98, 0xbd, 0x0f, 0xd2, 0x21, 0x5d, 0x6a, 0x1e, 0x52,
+    0x95, 0xe6, 0x4f, 0x73, 0xf6, 0x3f, 0x0a, 0xec, 0x8b, 0x91, 0x5a, 0x98,
+    0x5d, 0x78, 0x65, 0x98,
+};
+
+static const uint8_t _TC7_HMAC_SHA256[] = {
+    0x9b, 0x09, 0xff, 0xa7, 0x1b, 0x94, 0x2f, 0xcb, 0x27, 0x63, 0x5f, 0xbc,
+    0xd5, 0xb0, 0xe9, 0x44, 0xbf, 0xdc, 0x63, 0x64, 0x4f, 0x07, 0x13, 0x93,
+    0x8a, 0x7f, 0x51, 0x53, 0x5c, 0x3a, 0x35, 0xe2,
+};
+
+static const uint8_t _TC7_HMAC_SHA512[] = {
+    0xe3, 0x7b, 0x6a, 0x77, 0x5d, 0xc8, 0x7d, 0xba, 0xa4, 0xdf, 0xa9, 0xf9,
+    0x6e, 0x5e, 0x3f, 0xfd, 0xde, 0xbd, 0x71, 0xf8, 0x86, 0x72, 0x89, 0x86,
+    0x5d, 0xf5, 0xa3, 0x2d, 0x20, 0xcd, 0xc9, 0x44, 0xb6, 0x02, 0x2c, 0xac,
+    0x3c, 0x49, 0x82, 0xb1, 0x0d, 0x5e, 0xeb, 0x55, 0xc3, 0xe4, 0xde, 0x15,
+    0x13, 0x46, 0x76, 0xfb, 0x6d, 0xe0, 0x44, 0x60, 0x65, 0xc9, 0x74, 0x40,
+    0xfa, 0x8c, 0x6a, 0x58,
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static struct hca_hmac _hmac;
+static uint8_t _mac_buf[HCA_SHA_MAX_DIGEST_SIZE];
+
+//-----------------------------------------------------------------------------
+// HCA HMAC test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_test_hmac(enum hca_sha_mode mode, uint8_t key_byte, size_t key_len,
+           const char * msg, const uint8_t * refm)
+{
+    uint8_t key[TC6_KEY_SIZE];
+    size_t mac_len = hca_sha_digest_size(mode);
+    int rc;
+
+    memset(key, key_byte, key_len);
+    TEST_ASSERT_EQUAL_INT(0, hca_hmac_init(&_hmac, mode, key, key_len));
+
+    // the key blocks are reused from one message to the next
+    for (unsigned int ix=0; ix<2u; ix++) {
+        memset(_mac_buf, 0, sizeof(_mac_buf));
+        rc = hca_hmac_digest(&_hmac, _mac_buf, sizeof(_mac_buf),
+                             (const uint8_t *)msg, strlen(msg));
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "HMAC failed");
+        if ( memcmp(_mac_buf, refm, mac_len) ) {
+            DUMP_HEX("Invalid MAC:", _mac_buf, mac_len);
+            DUMP_HEX("Ref MAC:    ", refm, mac_len);
+            TEST_FAIL_MESSAGE("MAC mismatch");
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(hca_hmac);
+
+TEST_SETUP(hca_hmac)
+{
+    QEMU_IO_STATS(0);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_init(), "HCA is not available");
+}
+
+TEST_TEAR_DOWN(hca_hmac)
+{
+    QEMU_IO_STATS(1);
+}
+
+TEST(hca_hmac, sha256_short)
+{
+    _test_hmac(HCA_SHA256, 0x0bu, TC1_KEY_SIZE, _TC1_MSG, _TC1_HMAC_SHA256);
+}
+
+TEST(hca_hmac, sha384_short)
+{
+    _test_hmac(HCA_SHA384, 0x0bu, TC1_KEY_SIZE, _TC1_MSG, _TC1_HMAC_SHA384);
+}
+
+TEST(hca_hmac, sha512_short)
+{
+    _test_hmac(HCA_SHA512, 0x0bu, TC1_KEY_SIZE, _TC1_MSG, _TC1_HMAC_SHA512);
+}
+
+TEST(hca_hmac, sha256_long_key)
+{
+    _test_hmac(HCA_SHA256, 0xaau, TC6_KEY_SIZE, _TC6_MSG, _TC6_HMAC_SHA256);
+}
+
+TEST(hca_hmac, sha512_long_key)
+{
+    _test_hmac(HCA_SHA512, 0xaau, TC6_KEY_SIZE, _TC6_MSG, _TC6_HMAC_SHA512);
+}
+
+TEST(hca_hmac, sha256_long_msg)
+{
+    _test_hmac(HCA_SHA256, 0xaau, TC6_KEY_SIZE, _TC7_MSG, _TC7_HMAC_SHA256);
+}
+
+TEST(hca_hmac, sha512_long_msg)
+{
+    _test_hmac(HCA_SHA512, 0xaau, TC6_KEY_SIZE, _TC7_MSG, _TC7_HMAC_SHA512);
+}
+
+TEST(hca_hmac, invalid)
+{
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_hmac_init(&_hmac, HCA_SHA256, NULL,
+                                                 TC1_KEY_SIZE));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_hmac_init(&_hmac,
+                                                 (enum hca_sha_mode)4,
+                                                 NULL, 0u));
+    TEST_ASSERT_EQUAL_INT(0, hca_hmac_init(&_hmac, HCA_SHA512, NULL, 0u));
+    // MAC buffer shorter than the digest
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_hmac_digest(&_hmac, _mac_buf, 32u,
+                                                   (const uint8_t *)_TC1_MSG,
+                                                   strlen(_TC1_MSG)));
+}
+
+TEST_GROUP_RUNNER(hca_hmac)
+{
+    RUN_TEST_CASE(hca_hmac, sha256_short);
+    RUN_TEST_CASE(hca_hmac, sha384_short);
+    RUN_TEST_CASE(hca_hmac, sha512_short);
+    RUN_TEST_CASE(hca_hmac, sha256_long_key);
+    RUN_TEST_CASE(hca_hmac, sha512_long_key);
+    RUN_TEST_CASE(hca_hmac, sha256_long_msg);
+    RUN_TEST_CASE(hca_hmac, sha512_long_msg);
+    RUN_TEST_CASE(hca_hmac, invalid);
+}
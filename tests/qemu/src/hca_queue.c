@@ -0,0 +1,368 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "metal/cache.h"
+#include "metal/cpu.h"
+#include "hca/queue.h"
+#include "hca/sha.h"
+#include "unity_fixture.h"
+#include "dma_test.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define QUEUE_SIZE 8u  // jobs
+#define DST_BUF_SIZE (4u*PAGE_SIZE)  // bytes
+#define QUEUE_TIMEOUT (2u*TIME_BASE)
+
+/** Machine software interrupt pending bit of mip */
+#define MIP_MSIP (1u << 3u)
+/** Machine interrupt enable bit of mstatus */
+#define MSTATUS_MIE (1u << 3u)
+
+// NIST SP 800-38A, F.1.1
+static const uint8_t _KEY_ECB[] ALIGN(sizeof(uint32_t)) = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88,
+    0x09, 0xCF, 0x4F, 0x3C,
+};
+
+static const uint8_t _PLAINTEXT_ECB[64u] = {
+    0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11,
+    0x73, 0x93, 0x17, 0x2A, 0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C,
+    0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51, 0x30, 0xC8, 0x1C, 0x46,
+    0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+    0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B,
+    0xE6, 0x6C, 0x37, 0x10,
+};
+
+static const uint8_t _CIPHERTEXT_ECB[64u] = {
+    0x3A, 0xD7, 0x7B, 0xB4, 0x0D, 0x7A, 0x36, 0x60, 0xA8, 0x9E, 0xCA, 0xF3,
+    0x24, 0x66, 0xEF, 0x97, 0xF5, 0xD3, 0xD5, 0x85, 0x03, 0xB9, 0x69, 0x9D,
+    0xE7, 0x85, 0x89, 0x5A, 0x96, 0xFD, 0xBA, 0xAF, 0x43, 0xB1, 0xCD, 0x7F,
+    0x59, 0x8E, 0xCE, 0x23, 0x88, 0x1B, 0x00, 0xE3, 0xED, 0x03, 0x06, 0x88,
+    0x7B, 0x0C, 0x78, 0x5E, 0x27, 0xE8, 0xAD, 0x3F, 0x82, 0x23, 0x20, 0x71,
+    0x04, 0x72, 0x5D, 0xD4,
+};
+
+/** Scatter list: offset and size of each segment, in bytes */
+static const size_t _SEGMENTS[][2u] = {
+    { 0u, 64u },
+    { 256u, 1024u },
+    { 4096u, 2048u },
+    { 8192u, 4096u },
+    { 12800u, 192u },
+};
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** Work of hart #1, as Unity assertions may only be used from hart #0 */
+struct hart_work {
+    int hw_rc;                  /**< First error */
+    size_t hw_jobs;             /**< Count of completed jobs */
+    unsigned int hw_mismatches; /**< Count of invalid results */
+    bool hw_pending_ipi;        /**< Whether MSIP was left raised */
+    volatile bool hw_done;
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static struct hca_queue _queue;
+static struct hca_job _jobs[QUEUE_SIZE];
+static uint8_t * _dst_buf;
+static struct hart_work _work;
+
+//-----------------------------------------------------------------------------
+// HCA queue test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_setup_aes_ecb(uint32_t process)
+{
+    // FIFO endianess: natural order
+    _hca_updreg32(METAL_SIFIVE_HCA_CR, 1,
+                  HCA_REGISTER_CR_ENDIANNESS_OFFSET,
+                  HCA_REGISTER_CR_ENDIANNESS_MASK);
+
+    // AES mode: ECB
+    _hca_updreg32(METAL_SIFIVE_HCA_AES_CR, 0u,
+                  HCA_REGISTER_AES_CR_MODE_OFFSET,
+                  HCA_REGISTER_AES_CR_MODE_MASK);
+    // AES key size: 128 bits
+    _hca_updreg32(METAL_SIFIVE_HCA_AES_CR, 0u,
+                  HCA_REGISTER_AES_CR_KEYSZ_OFFSET,
+                  HCA_REGISTER_AES_CR_KEYSZ_MASK);
+    _hca_updreg32(METAL_SIFIVE_HCA_AES_CR, process,
+                  HCA_REGISTER_AES_CR_PROCESS_OFFSET,
+                  HCA_REGISTER_AES_CR_PROCESS_MASK);
+    // AES init: no need
+    _hca_updreg32(METAL_SIFIVE_HCA_AES_CR, 0u,
+                  HCA_REGISTER_AES_CR_INIT_OFFSET,
+                  HCA_REGISTER_AES_CR_INIT_MASK);
+
+    _hca_set_aes_key128(_KEY_ECB);
+}
+
+static void
+_fill_pattern(uint8_t * buf, size_t length, const uint8_t * pattern,
+              size_t pat_len)
+{
+    for (size_t pos=0; pos<length; pos+=pat_len) {
+        memcpy(&buf[pos], pattern, pat_len);
+    }
+}
+
+static void
+_check_pattern(const uint8_t * buf, size_t length, const uint8_t * pattern,
+               size_t pat_len)
+{
+    for (size_t pos=0; pos<length; pos+=pat_len) {
+        if ( memcmp(&buf[pos], pattern, pat_len) ) {
+            DUMP_HEX("Invalid AES:", &buf[pos], pat_len);
+            DUMP_HEX("Ref:        ", pattern, pat_len);
+            TEST_FAIL_MESSAGE("AES mismatch");
+        }
+    }
+}
+
+static void
+_test_scatter(uint32_t process, uint8_t * src, uint8_t * dst,
+              const uint8_t * in, const uint8_t * ref)
+{
+    int rc;
+
+    _setup_aes_ecb(process);
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_SEGMENTS); ix++) {
+        _fill_pattern(&src[_SEGMENTS[ix][0u]], _SEGMENTS[ix][1u], in, 64u);
+        memset(&dst[_SEGMENTS[ix][0u]], 0, _SEGMENTS[ix][1u]);
+    }
+
+    size_t done = _queue.hq_done;
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_SEGMENTS); ix++) {
+        struct hca_job job = {
+            .hj_src = &src[_SEGMENTS[ix][0u]],
+            .hj_dst = &dst[_SEGMENTS[ix][0u]],
+            .hj_count = _SEGMENTS[ix][1u]/DMA_BLOCK_SIZE,
+            .hj_target = HCA_JOB_AES,
+        };
+        rc = hca_queue_submit(&_queue, &job);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot submit job");
+    }
+
+    // no CPU involvement between segments
+    rc = hca_queue_wait(&_queue);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Job failed");
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(ARRAY_SIZE(_SEGMENTS),
+                                   _queue.hq_done - done,
+                                   "Missing job completion");
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_SEGMENTS); ix++) {
+        _check_pattern(&dst[_SEGMENTS[ix][0u]], _SEGMENTS[ix][1u], ref, 64u);
+    }
+}
+
+static void
+_queue_run(struct hart_work * work, uint8_t * src, uint8_t * dst)
+{
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_SEGMENTS); ix++) {
+        _fill_pattern(&src[_SEGMENTS[ix][0u]], _SEGMENTS[ix][1u],
+                      _PLAINTEXT_ECB, 64u);
+        memset(&dst[_SEGMENTS[ix][0u]], 0, _SEGMENTS[ix][1u]);
+    }
+
+    size_t done = _queue.hq_done;
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_SEGMENTS); ix++) {
+        struct hca_job job = {
+            .hj_src = &src[_SEGMENTS[ix][0u]],
+            .hj_dst = &dst[_SEGMENTS[ix][0u]],
+            .hj_count = _SEGMENTS[ix][1u]/DMA_BLOCK_SIZE,
+            .hj_target = HCA_JOB_AES,
+        };
+        work->hw_rc = hca_queue_submit(&_queue, &job);
+        if ( work->hw_rc ) {
+            return;
+        }
+    }
+
+    // the HCA IRQ is routed to hart #0: sleep until its completion IPI
+    work->hw_rc = hca_queue_wait(&_queue);
+    work->hw_jobs = _queue.hq_done - done;
+
+    unsigned long mip;
+    __asm__ volatile ("csrr %0, mip" : "=r"(mip));
+    work->hw_pending_ipi = (mip & MIP_MSIP) != 0u;
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_SEGMENTS); ix++) {
+        const uint8_t * buf = &dst[_SEGMENTS[ix][0u]];
+        for (size_t pos=0; pos<_SEGMENTS[ix][1u]; pos+=64u) {
+            if ( memcmp(&buf[pos], _CIPHERTEXT_ECB, 64u) ) {
+                work->hw_mismatches += 1u;
+            }
+        }
+    }
+}
+
+static void
+_queue_main_hart_1(void)
+{
+    // acknowledge the wake up request
+    qemu_signal_hart(1u, false);
+
+    _queue_run(&_work, dma_long_buf, _dst_buf);
+
+    _work.hw_done = true;
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(hca_queue);
+
+TEST_SETUP(hca_queue)
+{
+    QEMU_IO_STATS(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(qemu_dma_long_buf_get(),
+                                 "Cannot allocate DMA buffer");
+    _dst_buf = metal_dma_pool_alloc(&dma_pool, DST_BUF_SIZE);
+    TEST_ASSERT_NOT_NULL_MESSAGE(_dst_buf, "Cannot allocate DMA buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_init(), "HCA is not available");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_queue_init(&_queue, _jobs,
+                                                    ARRAY_SIZE(_jobs)),
+                                  "Cannot initialize HCA queue");
+}
+
+TEST_TEAR_DOWN(hca_queue)
+{
+    int rc = hca_queue_fini(&_queue);
+    metal_dma_pool_free(&dma_pool, _dst_buf, DST_BUF_SIZE);
+    _dst_buf = NULL;
+    qemu_dma_long_buf_put();
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot release HCA queue");
+    QEMU_IO_STATS(1);
+}
+
+TEST(hca_queue, ecb_scatter)
+{
+    _test_scatter(0u, dma_long_buf, _dst_buf, _PLAINTEXT_ECB,
+                  _CIPHERTEXT_ECB);
+    // decrypt back, in place
+    _test_scatter(1u, _dst_buf, _dst_buf, _CIPHERTEXT_ECB, _PLAINTEXT_ECB);
+}
+
+TEST(hca_queue, one_shot_irq)
+{
+    struct hca_sha_session ss;
+    uint8_t hash[HCA_SHA_MAX_DIGEST_SIZE];
+    uint8_t ref[HCA_SHA_MAX_DIGEST_SIZE];
+    int rc;
+
+    _fill_pattern(dma_long_buf, DMA_LONG_BUF_SIZE, _PLAINTEXT_ECB, 64u);
+
+    // while the queue handles the ASD IRQ, one-shot requests sleep until
+    // their DMA done IRQ
+    rc = hca_sha_init(&ss, HCA_SHA256);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize SHA session");
+    rc = hca_sha_digest(&ss, hash, sizeof(hash), dma_long_buf,
+                        DMA_LONG_BUF_SIZE);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "SHA digest failed");
+    TEST_ASSERT_TRUE_MESSAGE(METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_CR) &
+                             (HCA_REGISTER_CR_DMADIE_MASK <<
+                              HCA_REGISTER_CR_DMADIE_OFFSET),
+                             "DMA done IRQ not enabled");
+
+    rc = hca_sha_sw_digest(HCA_SHA256, ref, sizeof(ref), dma_long_buf,
+                           DMA_LONG_BUF_SIZE);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "SW SHA digest failed");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(ref, hash,
+                                         hca_sha_digest_size(HCA_SHA256),
+                                         "SHA mismatch");
+}
+
+TEST(hca_queue, dual_hart)
+{
+    if ( metal_cpu_get_num_harts() < 2 ) {
+        TEST_IGNORE_MESSAGE("Single hart platform");
+    }
+
+    memset(&_work, 0, sizeof(_work));
+    _setup_aes_ecb(0u);
+
+    // hand the buffers over to hart #1
+    int hartid = metal_cpu_get_current_hartid();
+    metal_dcache_l1_flush_range(hartid, (uintptr_t)dma_long_buf,
+                                DMA_LONG_BUF_SIZE);
+    metal_dcache_l1_flush_range(hartid, (uintptr_t)_dst_buf, DST_BUF_SIZE);
+
+    qemu_register_hart_task(1u, &_queue_main_hart_1);
+    qemu_signal_hart(1u, true);
+
+    // hart #1 submits and waits, while hart #0 handles the HCA IRQ; the
+    // IRQ is held pending until hart #1 sleeps on the queue, so that only
+    // the completion IPI may wake it up
+    uint64_t timeout = now() + QUEUE_TIMEOUT;
+    unsigned long mstatus;
+    __asm__ volatile ("csrrc %0, mstatus, %1" : "=r"(mstatus)
+                      : "r"(MSTATUS_MIE) : "memory");
+    bool registered = false;
+    while ( ! _work.hw_done && (now() < timeout) ) {
+        if ( _queue.hq_waiters & (1ul << 1u) ) {
+            registered = true;
+            break;
+        }
+    }
+    __asm__ volatile ("csrw mstatus, %0" :: "r"(mstatus) : "memory");
+    TEST_ASSERT_TRUE_MESSAGE(registered, "Hart #1 did not wait on the queue");
+
+    while ( ! _work.hw_done ) {
+        TEST_ASSERT_TRUE_MESSAGE(now() < timeout, "Hart #1 timed out");
+    }
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, _work.hw_rc, "Job failed");
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(ARRAY_SIZE(_SEGMENTS), _work.hw_jobs,
+                                   "Missing job completion");
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, _work.hw_mismatches, "AES mismatch");
+    // hart #1 has unregistered and acknowledged the completion IPI
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, _queue.hq_waiters,
+                                   "Stale queue waiter");
+    TEST_ASSERT_FALSE_MESSAGE(_work.hw_pending_ipi, "Stale completion IPI");
+}
+
+TEST(hca_queue, invalid)
+{
+    struct hca_job job = {
+        .hj_src = &dma_long_buf[16u],
+        .hj_dst = _dst_buf,
+        .hj_count = 1u,
+        .hj_target = HCA_JOB_AES,
+    };
+    // source not aligned on a DMA boundary
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_queue_submit(&_queue, &job));
+    job.hj_src = dma_long_buf;
+    job.hj_count = 0u;
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_queue_submit(&_queue, &job));
+
+    // only one active queue, ring size should be a power of 2
+    static struct hca_queue other;
+    TEST_ASSERT_EQUAL_INT(-EBUSY, hca_queue_init(&other, _jobs, 4u));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_queue_init(&other, _jobs, 6u));
+}
+
+TEST_GROUP_RUNNER(hca_queue)
+{
+    RUN_TEST_CASE(hca_queue, ecb_scatter);
+    RUN_TEST_CASE(hca_queue, one_shot_irq);
+    RUN_TEST_CASE(hca_queue, dual_hart);
+    RUN_TEST_CASE(hca_queue, invalid);
+}
@@ -0,0 +1,450 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "metal/machine.h"
+#include "metal/cpu.h"
+#include "hca/sha.h"
+#include "unity_fixture.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define LONG_MSG_SIZE 1000u  // bytes
+#define BATCH_COUNT   64u    // records
+
+static const uint8_t _MSG_ABC[] = { 'a', 'b', 'c' };
+
+static const uint8_t _MSG_ABC_SHA224[] = {
+    0x23, 0x09, 0x7d, 0x22, 0x34, 0x05, 0xd8, 0x22, 0x86, 0x42, 0xa4, 0x77,
+    0xbd, 0xa2, 0x55, 0xb3, 0x2a, 0xad, 0xbc, 0xe4, 0xbd, 0xa0, 0xb3, 0xf7,
+    0xe3, 0x6c, 0x9d, 0xa7,
+};
+
+static const uint8_t _MSG_ABC_SHA256[] = {
+    0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde,
+    0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+    0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+static const uint8_t _MSG_ABC_SHA384[] = {
+    0xcb, 0x00, 0x75, 0x3f, 0x45, 0xa3, 0x5e, 0x8b, 0xb5, 0xa0, 0x3d, 0x69,
+    0x9a, 0xc6, 0x50, 0x07, 0x27, 0x2c, 0x32, 0xab, 0x0e, 0xde, 0xd1, 0x63,
+    0x1a, 0x8b, 0x60, 0x5a, 0x43, 0xff, 0x5b, 0xed, 0x80, 0x86, 0x07, 0x2b,
+    0xa1, 0xe7, 0xcc, 0x23, 0x58, 0xba, 0xec, 0xa1, 0x34, 0xc8, 0x25, 0xa7,
+};
+
+static const uint8_t _MSG_ABC_SHA512[] = {
+    0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41, 0x73, 0x49,
+    0xae, 0x20, 0x41, 0x31, 0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2,
+    0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a, 0x21, 0x92, 0x99, 0x2a,
+    0x27, 0x4f, 0xc1, 0xa8, 0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+    0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f,
+    0xa5, 0x4c, 0xa4, 0x9f,
+};
+
+static const uint8_t _MSG_EMPTY_SHA256[] = {
+    0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8,
+    0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+    0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55,
+};
+
+// message is a (uint8_t)index sequence of LONG_MSG_SIZE bytes
+static const uint8_t _MSG_LONG_SHA256[] = {
+    0xa8, 0xaf, 0x09, 0x9b, 0xf2, 0xe8, 0x78, 0x60, 0x95, 0x58, 0xdb, 0xf6,
+    0x9d, 0x8f, 0x88, 0xf4, 0xa3, 0x10, 0x40, 0xa8, 0xcf, 0x84, 0xb5, 0x49,
+    0xa0, 0xcf, 0xa9, 0x12, 0xf1, 0x2f, 0xfc, 0x3f,
+};
+
+static const uint8_t _MSG_LONG_SHA512[] = {
+    0x6c, 0xd2, 0xed, 0xa9, 0xbf, 0x9c, 0x05, 0x97, 0x12, 0x90, 0x29, 0xb0,
+    0x05, 0x4b, 0x81, 0xe4, 0x33, 0xf6, 0xb8, 0xb7, 0xb4, 0x99, 0xa7, 0x5e,
+    0xb7, 0x05, 0xef, 0xd7, 0x4b, 0xac, 0x19, 0x41, 0x49, 0x83, 0x5b, 0x1d,
+    0x1a, 0x14, 0xc4, 0x8b, 0xe6, 0x96, 0xe4, 0xd5, 0x88, 0x45, 0x6d, 0x51,
+    0x2a, 0x22, 0xea, 0xe7, 0xaa, 0x1b, 0x57, 0xbe, 0x2b, 0x56, 0xea, 0xe7,
+    0xd3, 0x5e, 0x08, 0xcb,
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static struct hca_sha_session _sha_session;
+static uint8_t _hash_buf[HCA_SHA_MAX_DIGEST_SIZE];
+
+//-----------------------------------------------------------------------------
+// HCA SHA library test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_test_sha(enum hca_sha_mode mode, const uint8_t * refh, const uint8_t * buf,
+          size_t buflen)
+{
+    size_t hash_len = hca_sha_digest_size(mode);
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0u, hash_len, "Invalid SHA mode");
+
+    int rc;
+
+    rc = hca_sha_init(&_sha_session, mode);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize SHA session");
+
+    memset(_hash_buf, 0, sizeof(_hash_buf));
+    rc = hca_sha_digest(&_sha_session, _hash_buf, sizeof(_hash_buf),
+                        buf, buflen);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digest");
+
+    if ( memcmp(_hash_buf, refh, hash_len) ) {
+        DUMP_HEX("Invalid hash:", _hash_buf, hash_len);
+        DUMP_HEX("Ref:         ", refh, hash_len);
+        TEST_FAIL_MESSAGE("Hash mismatch");
+    }
+}
+
+static void
+_test_sha_stream(enum hca_sha_mode mode, const uint8_t * refh,
+                 const uint8_t * buf, size_t buflen, size_t chunk)
+{
+    size_t hash_len = hca_sha_digest_size(mode);
+    int rc;
+
+    rc = hca_sha_init(&_sha_session, mode);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize SHA session");
+
+    // vary the chunk size, so that chunks start on all kinds of alignment
+    size_t size = chunk;
+    while ( buflen ) {
+        size_t length = MIN(size, buflen);
+        rc = hca_sha_update(&_sha_session, buf, length);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot update digest");
+        buf += length;
+        buflen -= length;
+        size = (size == chunk) ? chunk + 5u : chunk;
+    }
+
+    memset(_hash_buf, 0, sizeof(_hash_buf));
+    rc = hca_sha_final(&_sha_session, _hash_buf, sizeof(_hash_buf));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot finalize digest");
+
+    if ( memcmp(_hash_buf, refh, hash_len) ) {
+        DUMP_HEX("Invalid hash:", _hash_buf, hash_len);
+        DUMP_HEX("Ref:         ", refh, hash_len);
+        TEST_FAIL_MESSAGE("Hash mismatch");
+    }
+}
+
+static void
+_fill_long_msg(uint8_t * buf, size_t length)
+{
+    for (unsigned int ix=0; ix<length; ix++) {
+        buf[ix] = (uint8_t)ix;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(hca_sha);
+
+TEST_SETUP(hca_sha)
+{
+    QEMU_IO_STATS(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(qemu_dma_long_buf_get(),
+                                 "Cannot allocate DMA buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, hca_init(), "HCA is not available");
+    // exercise the SHA engine whatever the message length
+    for (unsigned int mode=HCA_SHA224; mode<=HCA_SHA512; mode++) {
+        hca_sha_set_sw_threshold((enum hca_sha_mode)mode, 0u);
+    }
+}
+
+TEST_TEAR_DOWN(hca_sha)
+{
+    for (unsigned int mode=HCA_SHA224; mode<=HCA_SHA512; mode++) {
+        hca_sha_set_sw_threshold((enum hca_sha_mode)mode,
+                                 HCA_SHA_SW_THRESHOLD);
+    }
+    qemu_dma_long_buf_put();
+    QEMU_IO_STATS(1);
+}
+
+TEST(hca_sha, sha224_abc)
+{
+    _test_sha(HCA_SHA224, _MSG_ABC_SHA224, _MSG_ABC, sizeof(_MSG_ABC));
+}
+
+TEST(hca_sha, sha256_abc)
+{
+    _test_sha(HCA_SHA256, _MSG_ABC_SHA256, _MSG_ABC, sizeof(_MSG_ABC));
+}
+
+TEST(hca_sha, sha384_abc)
+{
+    _test_sha(HCA_SHA384, _MSG_ABC_SHA384, _MSG_ABC, sizeof(_MSG_ABC));
+}
+
+TEST(hca_sha, sha512_abc)
+{
+    _test_sha(HCA_SHA512, _MSG_ABC_SHA512, _MSG_ABC, sizeof(_MSG_ABC));
+}
+
+TEST(hca_sha, sha256_long)
+{
+    // test all source alignments, to exercise prolog and epilog handling
+    for (unsigned int off=0; off<DMA_ALIGNMENT; off+=3u) {
+        _fill_long_msg(&dma_long_buf[off], LONG_MSG_SIZE);
+        _test_sha(HCA_SHA256, _MSG_LONG_SHA256, &dma_long_buf[off],
+                  LONG_MSG_SIZE);
+    }
+}
+
+TEST(hca_sha, sha512_long)
+{
+    for (unsigned int off=0; off<DMA_ALIGNMENT; off+=3u) {
+        _fill_long_msg(&dma_long_buf[off], LONG_MSG_SIZE);
+        _test_sha(HCA_SHA512, _MSG_LONG_SHA512, &dma_long_buf[off],
+                  LONG_MSG_SIZE);
+    }
+}
+
+TEST(hca_sha, sha256_empty)
+{
+    _test_sha(HCA_SHA256, _MSG_EMPTY_SHA256, NULL, 0u);
+    _test_sha_stream(HCA_SHA256, _MSG_EMPTY_SHA256, NULL, 0u, 1u);
+}
+
+TEST(hca_sha, sha256_stream)
+{
+    static const size_t chunks[] = { 1u, 7u, 16u, 33u, 100u, 512u };
+
+    _fill_long_msg(&dma_long_buf[1u], LONG_MSG_SIZE);
+    for (unsigned int ix=0; ix<ARRAY_SIZE(chunks); ix++) {
+        _test_sha_stream(HCA_SHA256, _MSG_LONG_SHA256, &dma_long_buf[1u],
+                         LONG_MSG_SIZE, chunks[ix]);
+    }
+}
+
+TEST(hca_sha, sha512_stream)
+{
+    static const size_t chunks[] = { 3u, 15u, 32u, 65u, 300u };
+
+    _fill_long_msg(dma_long_buf, LONG_MSG_SIZE);
+    for (unsigned int ix=0; ix<ARRAY_SIZE(chunks); ix++) {
+        _test_sha_stream(HCA_SHA512, _MSG_LONG_SHA512, dma_long_buf,
+                         LONG_MSG_SIZE, chunks[ix]);
+    }
+}
+
+TEST(hca_sha, sha256_pipeline)
+{
+    static uint8_t hashes[4u][HCA_SHA_MAX_DIGEST_SIZE];
+    int rc;
+
+    _fill_long_msg(&dma_long_buf[5u], LONG_MSG_SIZE);
+    memset(hashes, 0, sizeof(hashes));
+
+    rc = hca_sha_init(&_sha_session, HCA_SHA256);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize SHA session");
+    rc = hca_sha_set_pipeline(&_sha_session, true);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot enable pipeline");
+
+    // back-to-back messages, each digest being only stored on the next call
+    rc = hca_sha_digest(&_sha_session, hashes[0u], sizeof(hashes[0u]),
+                        _MSG_ABC, sizeof(_MSG_ABC));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digest");
+    rc = hca_sha_digest(&_sha_session, hashes[1u], sizeof(hashes[1u]),
+                        &dma_long_buf[5u], LONG_MSG_SIZE);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digest");
+    for (unsigned int pos=0; pos<LONG_MSG_SIZE; pos+=100u) {
+        rc = hca_sha_update(&_sha_session, &dma_long_buf[5u+pos], 100u);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot update digest");
+    }
+    rc = hca_sha_final(&_sha_session, hashes[2u], sizeof(hashes[2u]));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot finalize digest");
+    rc = hca_sha_digest(&_sha_session, hashes[3u], sizeof(hashes[3u]),
+                        NULL, 0u);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digest");
+
+    rc = hca_sha_sync(&_sha_session);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot complete digest");
+
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_ABC_SHA256, hashes[0u],
+                             sizeof(_MSG_ABC_SHA256));
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_LONG_SHA256, hashes[1u],
+                             sizeof(_MSG_LONG_SHA256));
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_LONG_SHA256, hashes[2u],
+                             sizeof(_MSG_LONG_SHA256));
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_EMPTY_SHA256, hashes[3u],
+                             sizeof(_MSG_EMPTY_SHA256));
+
+    rc = hca_sha_set_pipeline(&_sha_session, false);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot disable pipeline");
+}
+
+TEST(hca_sha, sha256_many)
+{
+    static struct hca_sha_record records[BATCH_COUNT];
+    static uint8_t refs[BATCH_COUNT][256u/8u];
+    static uint8_t digests[BATCH_COUNT][256u/8u];
+    struct metal_cpu * cpu = metal_cpu_get(metal_cpu_get_current_hartid());
+    int rc;
+
+    // 32..256 byte records, w/ all kinds of alignment
+    _fill_long_msg(dma_long_buf, DMA_LONG_BUF_SIZE);
+    size_t pos = 0;
+    for (unsigned int ix=0; ix<BATCH_COUNT; ix++) {
+        records[ix].sr_data = &dma_long_buf[pos];
+        records[ix].sr_length = 32u + ((ix * 37u) % 225u);
+        pos += records[ix].sr_length + 1u;
+    }
+
+    rc = hca_sha_init(&_sha_session, HCA_SHA256);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize SHA session");
+
+    unsigned long long start = metal_cpu_get_timer(cpu);
+    for (unsigned int ix=0; ix<BATCH_COUNT; ix++) {
+        rc = hca_sha_digest(&_sha_session, refs[ix], sizeof(refs[ix]),
+                            records[ix].sr_data, records[ix].sr_length);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digest");
+    }
+    unsigned long long single = metal_cpu_get_timer(cpu) - start;
+
+    start = metal_cpu_get_timer(cpu);
+    rc = hca_sha_hash_many(&_sha_session, records, BATCH_COUNT,
+                           &digests[0][0], sizeof(digests));
+    unsigned long long batch = metal_cpu_get_timer(cpu) - start;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digests");
+
+    TEST_ASSERT_EQUAL_MEMORY(refs, digests, sizeof(refs));
+
+    PRINTF("SHA-256 per message: single %llu cycles, batch %llu cycles",
+           single/BATCH_COUNT, batch/BATCH_COUNT);
+
+    // batching is not possible while a message is in progress
+    rc = hca_sha_update(&_sha_session, _MSG_ABC, sizeof(_MSG_ABC));
+    TEST_ASSERT_EQUAL_INT(0, rc);
+    TEST_ASSERT_EQUAL_INT(-EBUSY,
+                          hca_sha_hash_many(&_sha_session, records, 1u,
+                                            &digests[0][0],
+                                            sizeof(digests)));
+    rc = hca_sha_final(&_sha_session, _hash_buf, sizeof(_hash_buf));
+    TEST_ASSERT_EQUAL_INT(0, rc);
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_ABC_SHA256, _hash_buf,
+                             sizeof(_MSG_ABC_SHA256));
+}
+
+TEST(hca_sha, sw_dispatch)
+{
+    static uint8_t sw_hash[HCA_SHA_MAX_DIGEST_SIZE];
+    int rc;
+
+    _fill_long_msg(dma_long_buf, LONG_MSG_SIZE+1u);
+
+    for (unsigned int mode=HCA_SHA224; mode<=HCA_SHA512; mode++) {
+        enum hca_sha_mode sha_mode = (enum hca_sha_mode)mode;
+        size_t hash_len = hca_sha_digest_size(sha_mode);
+
+        rc = hca_sha_init(&_sha_session, sha_mode);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot initialize SHA session");
+
+        // padding on one or two blocks, w/ any alignment
+        for (size_t length=0; length<=300u; length+=7u) {
+            const uint8_t * msg = &dma_long_buf[length & 3u];
+
+            // SHA engine reference
+            rc = hca_sha_set_sw_threshold(sha_mode, 0u);
+            TEST_ASSERT_EQUAL_INT(0, rc);
+            rc = hca_sha_digest(&_sha_session, _hash_buf, sizeof(_hash_buf),
+                                msg, length);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digest");
+
+            rc = hca_sha_sw_digest(sha_mode, sw_hash, sizeof(sw_hash), msg,
+                                   length);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute SW digest");
+            TEST_ASSERT_EQUAL_MEMORY(_hash_buf, sw_hash, hash_len);
+
+            // dispatched to software
+            rc = hca_sha_set_sw_threshold(sha_mode, length+1u);
+            TEST_ASSERT_EQUAL_INT(0, rc);
+            memset(sw_hash, 0, sizeof(sw_hash));
+            rc = hca_sha_digest(&_sha_session, sw_hash, sizeof(sw_hash), msg,
+                                length);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot compute digest");
+            TEST_ASSERT_EQUAL_MEMORY(_hash_buf, sw_hash, hash_len);
+        }
+    }
+
+    // software digests do not need the engine
+    static struct hca_sha_session other;
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_init(&other, HCA_SHA256));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_set_sw_threshold(HCA_SHA256, 64u));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_update(&other, _MSG_ABC,
+                                            sizeof(_MSG_ABC)));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_init(&_sha_session, HCA_SHA256));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_digest(&_sha_session, sw_hash,
+                                            sizeof(sw_hash), _MSG_ABC,
+                                            sizeof(_MSG_ABC)));
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_ABC_SHA256, sw_hash,
+                             sizeof(_MSG_ABC_SHA256));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_final(&other, _hash_buf,
+                                           sizeof(_hash_buf)));
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_ABC_SHA256, _hash_buf,
+                             sizeof(_MSG_ABC_SHA256));
+}
+
+TEST(hca_sha, sw_calibrate)
+{
+    size_t threshold = ~0u;
+
+    int rc = hca_sha_calibrate(HCA_SHA256, &threshold);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot calibrate");
+    TEST_ASSERT_LESS_OR_EQUAL_UINT(HCA_SHA_CALIBRATE_MAX, threshold);
+    TEST_ASSERT_EQUAL_UINT(threshold, hca_sha_get_sw_threshold(HCA_SHA256));
+
+    PRINTF("SHA-256 software threshold: %zu bytes", threshold);
+}
+
+TEST(hca_sha, invalid)
+{
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_sha_init(&_sha_session,
+                                                (enum hca_sha_mode)4));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_init(&_sha_session, HCA_SHA512));
+    // digest buffer is too small
+    TEST_ASSERT_EQUAL_INT(-EINVAL,
+                          hca_sha_digest(&_sha_session, _hash_buf,
+                                         256u/8u, _MSG_ABC,
+                                         sizeof(_MSG_ABC)));
+
+    // only one session at a time may own the SHA engine
+    static struct hca_sha_session other;
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_init(&other, HCA_SHA256));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_update(&_sha_session, _MSG_ABC,
+                                            sizeof(_MSG_ABC)));
+    TEST_ASSERT_EQUAL_INT(-EBUSY, hca_sha_update(&other, _MSG_ABC,
+                                                 sizeof(_MSG_ABC)));
+    TEST_ASSERT_EQUAL_INT(0, hca_sha_final(&_sha_session, _hash_buf,
+                                           sizeof(_hash_buf)));
+    TEST_ASSERT_EQUAL_MEMORY(_MSG_ABC_SHA512, _hash_buf,
+                             sizeof(_MSG_ABC_SHA512));
+}
+
+TEST_GROUP_RUNNER(hca_sha)
+{
+    RUN_TEST_CASE(hca_sha, sha224_abc);
+    RUN_TEST_CASE(hca_sha, sha256_abc);
+    RUN_TEST_CASE(hca_sha, sha384_abc);
+    RUN_TEST_CASE(hca_sha, sha512_abc);
+    RUN_TEST_CASE(hca_sha, sha256_long);
+    RUN_TEST_CASE(hca_sha, sha512_long);
+    RUN_TEST_CASE(hca_sha, sha256_empty);
+    RUN_TEST_CASE(hca_sha, sha256_stream);
+    RUN_TEST_CASE(hca_sha, sha512_stream);
+    RUN_TEST_CASE(hca_sha, sha256_pipeline);
+    RUN_TEST_CASE(hca_sha, sha256_many);
+    RUN_TEST_CASE(hca_sha, sw_dispatch);
+    RUN_TEST_CASE(hca_sha, sw_calibrate);
+    RUN_TEST_CASE(hca_sha, invalid);
+}
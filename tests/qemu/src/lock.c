@@ -0,0 +1,334 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "metal/machine.h"
+#include "metal/cpu.h"
+#include "metal/lock.h"
+#include "unity_fixture.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define LOCK_LOOPS   256u
+/** Busy loops w/in a critical section, to widen the race window */
+#define LOCK_HOLD    16u
+#define LOCK_TIMEOUT (2u*TIME_BASE)
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+enum lock_kind {
+    LOCK_TICKET,
+    LOCK_MCS,
+    LOCK_RWLOCK,
+};
+
+/** Per-hart work, as Unity assertions may only be used from hart #0 */
+struct hart_work {
+    int hw_rc;                  /**< First error */
+    unsigned int hw_writes;     /**< Count of exclusive sections */
+    unsigned int hw_violations; /**< Count of overlapping sections */
+    volatile bool hw_done;
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static METAL_TICKET_LOCK_DECLARE(_ticket_lock);
+static METAL_MCS_LOCK_DECLARE(_mcs_lock);
+static METAL_MCS_LOCK_DECLARE(_mcs_lock2);
+static METAL_RWLOCK_DECLARE(_rwlock);
+static METAL_SEQLOCK_DECLARE(_seqlock);
+#ifdef METAL_LOCK_STATS
+static METAL_LOCK_DECLARE(_stats_lock);
+#endif // METAL_LOCK_STATS
+
+static enum lock_kind _lock_kind;
+/** Whether a hart is in an exclusive section */
+static volatile bool _lock_writer;
+/** Incremented w/ a non-atomic read-modify-write in exclusive sections */
+static volatile unsigned int _lock_count;
+static struct hart_work _works[2u];
+
+//-----------------------------------------------------------------------------
+// Dual hart test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_lock_hold(void)
+{
+    for (unsigned int ix=0; ix<LOCK_HOLD; ix++) {
+        __asm__ volatile ("nop");
+    }
+}
+
+static int
+_lock_take(struct metal_mcs_node * node, bool read)
+{
+    switch ( _lock_kind ) {
+        case LOCK_TICKET:
+            return metal_ticket_lock_take(&_ticket_lock);
+        case LOCK_MCS:
+            return metal_mcs_lock_take(&_mcs_lock, node);
+        default:
+            return read ? metal_rwlock_read_take(&_rwlock) :
+                          metal_rwlock_write_take(&_rwlock);
+    }
+}
+
+static int
+_lock_give(struct metal_mcs_node * node, bool read)
+{
+    switch ( _lock_kind ) {
+        case LOCK_TICKET:
+            return metal_ticket_lock_give(&_ticket_lock);
+        case LOCK_MCS:
+            return metal_mcs_lock_give(&_mcs_lock, node);
+        default:
+            return read ? metal_rwlock_read_give(&_rwlock) :
+                          metal_rwlock_write_give(&_rwlock);
+    }
+}
+
+static void
+_lock_run(struct hart_work * work)
+{
+    struct metal_mcs_node node;
+
+    for (unsigned int ix=0; ix<LOCK_LOOPS; ix++) {
+        // every other reader-writer lock section is shared
+        bool read = (_lock_kind == LOCK_RWLOCK) && (ix & 1u);
+        int rc = _lock_take(&node, read);
+        if ( rc ) {
+            work->hw_rc = rc;
+            break;
+        }
+        if ( _lock_writer ) {
+            work->hw_violations += 1u;
+        }
+        if ( read ) {
+            _lock_hold();
+            if ( _lock_writer ) {
+                work->hw_violations += 1u;
+            }
+        } else {
+            _lock_writer = true;
+            unsigned int count = _lock_count;
+            _lock_hold();
+            _lock_count = count + 1u;
+            _lock_writer = false;
+            work->hw_writes += 1u;
+        }
+        rc = _lock_give(&node, read);
+        if ( rc ) {
+            work->hw_rc = rc;
+            break;
+        }
+    }
+
+    work->hw_done = true;
+}
+
+static void
+_lock_main_hart_1(void)
+{
+    // acknowledge the wake up request
+    qemu_signal_hart(1u, false);
+
+    _lock_run(&_works[1u]);
+}
+
+static void
+_test_lock_dual_hart(enum lock_kind kind)
+{
+    if ( metal_cpu_get_num_harts() < 2 ) {
+        TEST_IGNORE_MESSAGE("Single hart platform");
+    }
+
+    _lock_kind = kind;
+    _lock_writer = false;
+    _lock_count = 0u;
+    memset(_works, 0, sizeof(_works));
+
+    qemu_register_hart_task(1u, &_lock_main_hart_1);
+    qemu_signal_hart(1u, true);
+
+    _lock_run(&_works[0u]);
+
+    uint64_t timeout = now() + LOCK_TIMEOUT;
+    while ( ! _works[1u].hw_done ) {
+        TEST_ASSERT_TRUE_MESSAGE(now() < timeout, "Hart #1 timed out");
+    }
+
+    unsigned int writes = 0u;
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_works); ix++) {
+        const struct hart_work * work = &_works[ix];
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, work->hw_rc, "Lock failed");
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, work->hw_violations,
+                                       "Mutual exclusion violated");
+        writes += work->hw_writes;
+    }
+    // a lost update means both harts were in an exclusive section
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(writes, _lock_count, "Lost update");
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(lock);
+
+TEST_SETUP(lock)
+{
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_ticket_lock_init(&_ticket_lock),
+                                  "Cannot initialize ticket lock");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_mcs_lock_init(&_mcs_lock),
+                                  "Cannot initialize MCS lock");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_mcs_lock_init(&_mcs_lock2),
+                                  "Cannot initialize MCS lock");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_rwlock_init(&_rwlock),
+                                  "Cannot initialize reader-writer lock");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_seqlock_init(&_seqlock),
+                                  "Cannot initialize sequence lock");
+}
+
+TEST_TEAR_DOWN(lock) {}
+
+TEST(lock, ticket)
+{
+    for (unsigned int ix=0; ix<4u; ix++) {
+        TEST_ASSERT_EQUAL_INT(0, metal_ticket_lock_take(&_ticket_lock));
+        // tickets are served in order
+        TEST_ASSERT_EQUAL_UINT(ix + 1u, _ticket_lock._next);
+        TEST_ASSERT_EQUAL_UINT(ix, _ticket_lock._owner);
+        TEST_ASSERT_EQUAL_INT(0, metal_ticket_lock_give(&_ticket_lock));
+    }
+    TEST_ASSERT_EQUAL_UINT(_ticket_lock._next, _ticket_lock._owner);
+}
+
+TEST(lock, mcs)
+{
+    struct metal_mcs_node node;
+    struct metal_mcs_node node2;
+
+    TEST_ASSERT_EQUAL_INT(0, ((uintptr_t)&node) &
+                             (METAL_LOCK_LINE_SIZE - 1u));
+
+    for (unsigned int ix=0; ix<4u; ix++) {
+        TEST_ASSERT_EQUAL_INT(0, metal_mcs_lock_take(&_mcs_lock, &node));
+        TEST_ASSERT_EQUAL_PTR(&node, _mcs_lock._tail);
+        // nested locks use distinct nodes
+        TEST_ASSERT_EQUAL_INT(0, metal_mcs_lock_take(&_mcs_lock2, &node2));
+        TEST_ASSERT_EQUAL_PTR(&node2, _mcs_lock2._tail);
+        TEST_ASSERT_EQUAL_INT(0, metal_mcs_lock_give(&_mcs_lock2, &node2));
+        TEST_ASSERT_NULL(_mcs_lock2._tail);
+        TEST_ASSERT_EQUAL_INT(0, metal_mcs_lock_give(&_mcs_lock, &node));
+        TEST_ASSERT_NULL(_mcs_lock._tail);
+    }
+}
+
+TEST(lock, rwlock)
+{
+    // readers share the lock
+    for (unsigned int ix=0; ix<3u; ix++) {
+        TEST_ASSERT_EQUAL_INT(0, metal_rwlock_read_take(&_rwlock));
+    }
+    TEST_ASSERT_EQUAL_UINT(3u, _rwlock._state);
+    for (unsigned int ix=0; ix<3u; ix++) {
+        TEST_ASSERT_EQUAL_INT(0, metal_rwlock_read_give(&_rwlock));
+    }
+    TEST_ASSERT_EQUAL_UINT(0u, _rwlock._state);
+
+    TEST_ASSERT_EQUAL_INT(0, metal_rwlock_write_take(&_rwlock));
+    TEST_ASSERT_NOT_EQUAL(0u, _rwlock._state);
+    TEST_ASSERT_EQUAL_INT(0, metal_rwlock_write_give(&_rwlock));
+    TEST_ASSERT_EQUAL_UINT(0u, _rwlock._state);
+}
+
+TEST(lock, ticket_dual_hart)
+{
+    _test_lock_dual_hart(LOCK_TICKET);
+    TEST_ASSERT_EQUAL_UINT(_ticket_lock._next, _ticket_lock._owner);
+}
+
+TEST(lock, mcs_dual_hart)
+{
+    _test_lock_dual_hart(LOCK_MCS);
+    TEST_ASSERT_NULL(_mcs_lock._tail);
+}
+
+TEST(lock, rwlock_dual_hart)
+{
+    _test_lock_dual_hart(LOCK_RWLOCK);
+    TEST_ASSERT_EQUAL_UINT(0u, _rwlock._state);
+}
+
+TEST(lock, seqlock)
+{
+    unsigned int seq = metal_seqlock_read_begin(&_seqlock);
+    TEST_ASSERT_FALSE(metal_seqlock_read_retry(&_seqlock, seq));
+
+    // an update invalidates the on-going read
+    TEST_ASSERT_EQUAL_INT(0, metal_seqlock_write_begin(&_seqlock));
+    TEST_ASSERT_TRUE(_seqlock._seq & 1u);
+    TEST_ASSERT_EQUAL_INT(0, metal_seqlock_write_end(&_seqlock));
+    TEST_ASSERT_TRUE(metal_seqlock_read_retry(&_seqlock, seq));
+
+    seq = metal_seqlock_read_begin(&_seqlock);
+    TEST_ASSERT_FALSE(metal_seqlock_read_retry(&_seqlock, seq));
+}
+
+#ifdef METAL_LOCK_STATS
+TEST(lock, stats)
+{
+    struct metal_lock * locks[METAL_LOCK_STATS_DUMP_MAX];
+
+    TEST_ASSERT_EQUAL_INT(0, metal_lock_init(&_stats_lock));
+    // the lock is never taken: it is not listed
+    size_t count = metal_lock_stats_top(locks, ARRAY_SIZE(locks));
+    for (unsigned int ix=0; ix<count; ix++) {
+        TEST_ASSERT_TRUE(locks[ix] != &_stats_lock);
+    }
+
+    for (unsigned int ix=0; ix<3u; ix++) {
+        TEST_ASSERT_EQUAL_INT(0, metal_lock_take(&_stats_lock));
+        TEST_ASSERT_EQUAL_INT(0, metal_lock_give(&_stats_lock));
+    }
+    TEST_ASSERT_TRUE(_stats_lock._stats._acquisitions == 3u);
+    TEST_ASSERT_TRUE(_stats_lock._stats._spins == 0u);
+    TEST_ASSERT_TRUE(_stats_lock._stats._wait_max <=
+                     _stats_lock._stats._wait_total);
+    TEST_ASSERT_TRUE(_stats_lock._stats._hold_max <=
+                     _stats_lock._stats._hold_total);
+
+    bool found = false;
+    count = metal_lock_stats_top(locks, ARRAY_SIZE(locks));
+    for (unsigned int ix=0; ix<count; ix++) {
+        found |= (locks[ix] == &_stats_lock);
+        if ( ix ) {
+            TEST_ASSERT_TRUE(locks[ix-1u]->_stats._wait_total >=
+                             locks[ix]->_stats._wait_total);
+        }
+    }
+    TEST_ASSERT_TRUE(found || (count == ARRAY_SIZE(locks)));
+    metal_lock_stats_dump(4u);
+}
+#endif // METAL_LOCK_STATS
+
+TEST_GROUP_RUNNER(lock)
+{
+    RUN_TEST_CASE(lock, ticket);
+    RUN_TEST_CASE(lock, mcs);
+    RUN_TEST_CASE(lock, rwlock);
+    RUN_TEST_CASE(lock, ticket_dual_hart);
+    RUN_TEST_CASE(lock, mcs_dual_hart);
+    RUN_TEST_CASE(lock, rwlock_dual_hart);
+    RUN_TEST_CASE(lock, seqlock);
+    #ifdef METAL_LOCK_STATS
+    RUN_TEST_CASE(lock, stats);
+    #endif // METAL_LOCK_STATS
+}
@@ -7,7 +7,9 @@
 // Variable
 //-----------------------------------------------------------------------------
 
-uint8_t ALIGN(DMA_ALIGNMENT) dma_long_buf[4*PAGE_SIZE];
+static uint8_t ALIGN(DMA_ALIGNMENT) _dma_pool_arena[DMA_POOL_SIZE];
+struct metal_dma_pool dma_pool;
+uint8_t * dma_long_buf;
 qemu_hart_task_t _metal_exec_array[MAX_HARTS];
 
 int hca_qemu_io_stat_enabled;
@@ -50,6 +52,26 @@ qemu_register_hart_task(unsigned int hartid, qemu_hart_task_t task)
     }
 }
 
+void
+qemu_signal_hart(unsigned int hartid, bool enable)
+{
+    hca_ipi_signal((int)hartid, enable);
+}
+
+uint8_t *
+qemu_dma_long_buf_get(void)
+{
+    dma_long_buf = metal_dma_pool_alloc(&dma_pool, DMA_LONG_BUF_SIZE);
+    return dma_long_buf;
+}
+
+void
+qemu_dma_long_buf_put(void)
+{
+    metal_dma_pool_free(&dma_pool, dma_long_buf, DMA_LONG_BUF_SIZE);
+    dma_long_buf = NULL;
+}
+
 void
 hca_qemu_io_stats_init(void)
 {
@@ -71,6 +93,10 @@ _ut_run(void)
 
     // RUN_TEST_GROUP(time_irq);
     RUN_TEST_GROUP(trng);
+    RUN_TEST_GROUP(dma_pool);
+    RUN_TEST_GROUP(atomic);
+    RUN_TEST_GROUP(lock);
+    RUN_TEST_GROUP(ring);
     RUN_TEST_GROUP(dma_sha256_poll);
     RUN_TEST_GROUP(dma_sha256_irq);
     RUN_TEST_GROUP(dma_sha512_poll);
@@ -79,6 +105,13 @@ _ut_run(void)
     RUN_TEST_GROUP(dma_aes_ecb_irq);
     RUN_TEST_GROUP(dma_aes_gcm_poll);
     RUN_TEST_GROUP(dma_aes_gcm_irq);
+    RUN_TEST_GROUP(hca_sha);
+    RUN_TEST_GROUP(hca_aes);
+    RUN_TEST_GROUP(hca_queue);
+    RUN_TEST_GROUP(hca_drbg);
+    RUN_TEST_GROUP(hca_arbiter);
+    RUN_TEST_GROUP(hca_etm);
+    RUN_TEST_GROUP(hca_hmac);
 }
 
 int main(int argc, const char *argv[])
@@ -92,5 +125,11 @@ int main(int argc, const char *argv[])
         exit(1);
     }
 
+    if ( metal_dma_pool_init(&dma_pool, _dma_pool_arena,
+                             sizeof(_dma_pool_arena)) ) {
+        puts("Cannot initialize DMA pool");
+        exit(1);
+    }
+
     return UnityMain(argc, argv, _ut_run);
 }
@@ -4,8 +4,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
-#include "sifive_hca-0.5.x.h"
-#include "hca_macro.h"
+#include "metal/dma_pool.h"
+#include "hca/hca.h"
+#include "hca/sifive_hca-0.5.x.h"
+#include "hca/hca_macro.h"
 
 //-----------------------------------------------------------------------------
 // Type definitions
@@ -18,16 +20,18 @@ typedef void (* qemu_hart_task_t)(void);
 // Constants
 //-----------------------------------------------------------------------------
 
-#define HCA_BASE             (METAL_SIFIVE_HCA_0_BASE_ADDRESS)
-#define HCA_ASD_IRQ_CHANNEL  52u
-#define HCA_TRNG_IRQ_CHANNEL 53u
-
 #define TIME_BASE            32768u // cannot rely on metal API for now
-#define HEART_BEAT_FREQUENCY 32u
-#define HEART_BEAT_TIME      ((TIME_BASE)/(HEART_BEAT_FREQUENCY))
 
 #define PAGE_SIZE            4096  // bytes
 
+#define DMA_LONG_BUF_SIZE    (4u*PAGE_SIZE)  // bytes
+
+/**
+ * Size of the DMA pool arena: the largest test group, hca_queue, borrows
+ * two long buffers at once
+ */
+#define DMA_POOL_SIZE        (2u*DMA_LONG_BUF_SIZE)  // bytes
+
 #define MAX_HARTS            16u
 
 //-----------------------------------------------------------------------------
@@ -92,15 +96,17 @@ typedef void (* qemu_hart_task_t)(void);
 # define QEMU_IO_STATS(_s_)
 #endif
 
-// this is HCA-specific, should be moved...
-#define DMA_ALIGNMENT        32u   // bytes
-#define DMA_BLOCK_SIZE       16u   // bytes
+#define DMA_ALIGNMENT        (HCA_DMA_ALIGNMENT)
+#define DMA_BLOCK_SIZE       (HCA_DMA_BLOCK_SIZE)
 
 //-----------------------------------------------------------------------------
 // Global variables
 //-----------------------------------------------------------------------------
 
-extern uint8_t ALIGN(DMA_ALIGNMENT) dma_long_buf[4*PAGE_SIZE];
+/** DMA buffers shared by the test groups */
+extern struct metal_dma_pool dma_pool;
+/** Long DMA buffer, only valid while borrowed by a test group */
+extern uint8_t * dma_long_buf;
 
 //-----------------------------------------------------------------------------
 // Helpers
@@ -111,6 +117,15 @@ void qemu_hexdump(const char * func, int line, const char * msg,
 
 void qemu_register_hart_task(unsigned int hartid, qemu_hart_task_t task);
 
+/** Borrow #dma_long_buf from the DMA pool, from a test group setup */
+uint8_t * qemu_dma_long_buf_get(void);
+
+/** Give #dma_long_buf back to the DMA pool, from a test group tear down */
+void qemu_dma_long_buf_put(void);
+
+/** Raise or clear the software interrupt (IPI) of a hart */
+void qemu_signal_hart(unsigned int hartid, bool enable);
+
 #ifdef ENABLE_QEMU_IO_STATS
 void hca_qemu_io_stats_init(void);
 #endif // ENABLE_QEMU_IO_STATS
@@ -0,0 +1,256 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "metal/machine.h"
+#include "metal/cpu.h"
+#include "metal/ring.h"
+#include "unity_fixture.h"
+#include "qemu.h"
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define RING_SIZE  8u   // slots
+#define BATCH_SIZE 3u   // objects, does not divide the ring size
+/** Objects each hart produces in the dual hart test */
+#define RING_OBJS    1024u
+#define RING_TIMEOUT (2u*TIME_BASE)
+
+//-----------------------------------------------------------------------------
+// Type definitions
+//-----------------------------------------------------------------------------
+
+/** Per-hart work, as Unity assertions may only be used from hart #0 */
+struct hart_work {
+    int hw_rc;                  /**< First error */
+    unsigned int hw_consumed;   /**< Count of dequeued objects */
+    unsigned int hw_duplicates; /**< Count of objects dequeued twice */
+    unsigned int hw_reorders;   /**< Count of objects out of order */
+    volatile bool hw_done;
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static void * _spsc_slots[RING_SIZE];
+static struct metal_spsc_ring _spsc;
+static struct metal_mpmc_slot _mpmc_slots[RING_SIZE];
+static struct metal_mpmc_ring _mpmc;
+/** Per-producer flags of the dequeued objects */
+static volatile bool _mpmc_seen[2u][RING_OBJS];
+static uint64_t _mpmc_deadline;
+static struct hart_work _works[2u];
+
+//-----------------------------------------------------------------------------
+// Ring test implementation
+//-----------------------------------------------------------------------------
+
+typedef size_t (* ring_enqueue_fn)(void * ring, void * const * objs,
+                                   size_t count);
+typedef size_t (* ring_dequeue_fn)(void * ring, void ** objs, size_t count);
+
+static void
+_test_ring(void * ring, ring_enqueue_fn enqueue, ring_dequeue_fn dequeue)
+{
+    void * objs[RING_SIZE + 1u];
+    void * outs[RING_SIZE + 1u];
+
+    for (uintptr_t ix=0; ix<ARRAY_SIZE(objs); ix++) {
+        objs[ix] = (void *)(ix + 1u);
+    }
+
+    // a full ring only takes the first objects of a batch
+    TEST_ASSERT_EQUAL_UINT(RING_SIZE, enqueue(ring, objs, ARRAY_SIZE(objs)));
+    TEST_ASSERT_EQUAL_UINT(0u, enqueue(ring, objs, 1u));
+    TEST_ASSERT_EQUAL_UINT(RING_SIZE, dequeue(ring, outs, ARRAY_SIZE(outs)));
+    TEST_ASSERT_EQUAL_MEMORY(objs, outs, RING_SIZE * sizeof(void *));
+    TEST_ASSERT_EQUAL_UINT(0u, dequeue(ring, outs, 1u));
+
+    // batches which wrap around the ring keep the object order
+    uintptr_t next_in = 1u;
+    uintptr_t next_out = 1u;
+    for (unsigned int loop=0; loop<4u*RING_SIZE; loop++) {
+        for (unsigned int ix=0; ix<BATCH_SIZE; ix++) {
+            objs[ix] = (void *)(next_in + ix);
+        }
+        next_in += enqueue(ring, objs, BATCH_SIZE);
+        size_t count = dequeue(ring, outs, BATCH_SIZE - (loop & 1u));
+        for (unsigned int ix=0; ix<count; ix++) {
+            TEST_ASSERT_EQUAL_PTR((void *)next_out++, outs[ix]);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT(next_in - next_out,
+                           dequeue(ring, outs, ARRAY_SIZE(outs)));
+}
+
+static size_t
+_spsc_enqueue(void * ring, void * const * objs, size_t count)
+{
+    return metal_spsc_ring_enqueue(ring, objs, count);
+}
+
+static size_t
+_spsc_dequeue(void * ring, void ** objs, size_t count)
+{
+    return metal_spsc_ring_dequeue(ring, objs, count);
+}
+
+static size_t
+_mpmc_enqueue(void * ring, void * const * objs, size_t count)
+{
+    return metal_mpmc_ring_enqueue(ring, objs, count);
+}
+
+static size_t
+_mpmc_dequeue(void * ring, void ** objs, size_t count)
+{
+    return metal_mpmc_ring_dequeue(ring, objs, count);
+}
+
+//-----------------------------------------------------------------------------
+// Dual hart test implementation
+//-----------------------------------------------------------------------------
+
+static void
+_mpmc_run(unsigned int hartid)
+{
+    struct hart_work * work = &_works[hartid];
+    void * objs[BATCH_SIZE];
+    void * outs[BATCH_SIZE];
+    // next sequence number expected from each producer
+    uintptr_t next[ARRAY_SIZE(_mpmc_seen)] = { 0u };
+    uintptr_t produced = 0u;
+
+    // objects are tagged w/ their producer and a sequence number; each hart
+    // consumes as many objects as it produces, so neither can starve
+    while ( (produced < RING_OBJS) || (work->hw_consumed < RING_OBJS) ) {
+        if ( now() > _mpmc_deadline ) {
+            work->hw_rc = -ETIMEDOUT;
+            break;
+        }
+        size_t count = MIN(BATCH_SIZE, RING_OBJS - produced);
+        for (unsigned int ix=0; ix<count; ix++) {
+            objs[ix] = (void *)((hartid << 16u) | (produced + ix));
+        }
+        produced += metal_mpmc_ring_enqueue(&_mpmc, objs, count);
+
+        count = MIN(BATCH_SIZE, RING_OBJS - work->hw_consumed);
+        count = metal_mpmc_ring_dequeue(&_mpmc, outs, count);
+        for (unsigned int ix=0; ix<count; ix++) {
+            uintptr_t producer = (uintptr_t)outs[ix] >> 16u;
+            uintptr_t seq = (uintptr_t)outs[ix] & 0xFFFFu;
+            if ( _mpmc_seen[producer][seq] ) {
+                work->hw_duplicates += 1u;
+            }
+            _mpmc_seen[producer][seq] = true;
+            // a producer's objects reach any consumer in order
+            if ( seq < next[producer] ) {
+                work->hw_reorders += 1u;
+            }
+            next[producer] = seq + 1u;
+        }
+        work->hw_consumed += count;
+    }
+
+    work->hw_done = true;
+}
+
+static void
+_mpmc_main_hart_1(void)
+{
+    // acknowledge the wake up request
+    qemu_signal_hart(1u, false);
+
+    _mpmc_run(1u);
+}
+
+//-----------------------------------------------------------------------------
+// Unity tests
+//-----------------------------------------------------------------------------
+
+TEST_GROUP(ring);
+
+TEST_SETUP(ring)
+{
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_spsc_ring_init(&_spsc,
+                                                          _spsc_slots,
+                                                          RING_SIZE),
+                                  "Cannot initialize SPSC ring");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, metal_mpmc_ring_init(&_mpmc,
+                                                          _mpmc_slots,
+                                                          RING_SIZE),
+                                  "Cannot initialize MPMC ring");
+}
+
+TEST_TEAR_DOWN(ring) {}
+
+TEST(ring, spsc)
+{
+    _test_ring(&_spsc, &_spsc_enqueue, &_spsc_dequeue);
+}
+
+TEST(ring, mpmc)
+{
+    _test_ring(&_mpmc, &_mpmc_enqueue, &_mpmc_dequeue);
+}
+
+TEST(ring, mpmc_dual_hart)
+{
+    if ( metal_cpu_get_num_harts() < 2 ) {
+        TEST_IGNORE_MESSAGE("Single hart platform");
+    }
+
+    memset((void *)_mpmc_seen, 0, sizeof(_mpmc_seen));
+    memset(_works, 0, sizeof(_works));
+    _mpmc_deadline = now() + RING_TIMEOUT;
+
+    qemu_register_hart_task(1u, &_mpmc_main_hart_1);
+    qemu_signal_hart(1u, true);
+
+    _mpmc_run(0u);
+
+    while ( ! _works[1u].hw_done ) {
+        TEST_ASSERT_TRUE_MESSAGE(now() < _mpmc_deadline + RING_TIMEOUT,
+                                 "Hart #1 timed out");
+    }
+
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_works); ix++) {
+        const struct hart_work * work = &_works[ix];
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, work->hw_rc, "Ring stalled");
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, work->hw_duplicates,
+                                       "Object dequeued twice");
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, work->hw_reorders,
+                                       "Object out of order");
+    }
+    for (unsigned int ix=0; ix<ARRAY_SIZE(_mpmc_seen); ix++) {
+        for (unsigned int seq=0; seq<RING_OBJS; seq++) {
+            TEST_ASSERT_TRUE_MESSAGE(_mpmc_seen[ix][seq], "Object lost");
+        }
+    }
+    void * out;
+    TEST_ASSERT_EQUAL_UINT(0u, metal_mpmc_ring_dequeue(&_mpmc, &out, 1u));
+}
+
+TEST(ring, invalid)
+{
+    struct metal_spsc_ring spsc;
+    struct metal_mpmc_ring mpmc;
+
+    // not a power of two
+    TEST_ASSERT_NOT_EQUAL(0, metal_spsc_ring_init(&spsc, _spsc_slots, 6u));
+    TEST_ASSERT_NOT_EQUAL(0, metal_mpmc_ring_init(&mpmc, _mpmc_slots, 6u));
+    // too small
+    TEST_ASSERT_NOT_EQUAL(0, metal_spsc_ring_init(&spsc, _spsc_slots, 1u));
+    TEST_ASSERT_NOT_EQUAL(0, metal_mpmc_ring_init(&mpmc, NULL, RING_SIZE));
+}
+
+TEST_GROUP_RUNNER(ring)
+{
+    RUN_TEST_CASE(ring, spsc);
+    RUN_TEST_CASE(ring, mpmc);
+    RUN_TEST_CASE(ring, mpmc_dual_hart);
+    RUN_TEST_CASE(ring, invalid);
+}
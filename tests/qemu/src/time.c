@@ -156,22 +156,7 @@ _time_irq_signal_hart(unsigned int hart_id, bool enable)
         PRINTF("Wake up hartid %u", hart_id);
     }
 
-    uintptr_t msip_base = 0;
-    /* Get the base address of the MSIP registers */
-    #ifdef __METAL_DT_RISCV_CLINT0_HANDLE
-    msip_base = __metal_driver_sifive_clint0_control_base(
-        __METAL_DT_RISCV_CLINT0_HANDLE);
-    msip_base += METAL_RISCV_CLINT0_MSIP_BASE;
-    #elif __METAL_DT_RISCV_CLIC0_HANDLE
-    msip_base =
-        __metal_driver_sifive_clic0_control_base(__METAL_DT_RISCV_CLIC0_HANDLE);
-    msip_base += METAL_RISCV_CLIC0_MSIP_BASE;
-    #else
-    # error "MSIP not available"
-    #endif
-
-    // there is no Metal API to set, only to get
-    METAL_REG32(msip_base, hart_id<<2u) = enable ? 1u : 0u;
+    qemu_signal_hart(hart_id, enable);
 }
 
 static void
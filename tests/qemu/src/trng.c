@@ -1,11 +1,13 @@
+#include <errno.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #include "metal/machine.h"
 #include "metal/tty.h"
-#include "sifive_hca-0.5.x.h"
-#include "hca_macro.h"
+#include "hca/sifive_hca-0.5.x.h"
+#include "hca/hca_macro.h"
+#include "hca/trng.h"
 #include "unity_fixture.h"
 #include "dma_test.h"
 
@@ -15,6 +17,7 @@
 //-----------------------------------------------------------------------------
 
 #define TRNG_MAX_RESULTS     8
+#define TRNG_POOL_SIZE       64    // words
 
 //-----------------------------------------------------------------------------
 // Type definitions
@@ -23,7 +26,7 @@
 struct trng_results
 {
     size_t   tr_count;
-    bool     tr_resume;
+    volatile size_t tr_done;
     uint32_t tr_values[TRNG_MAX_RESULTS];
  };
 
@@ -32,6 +35,9 @@ struct trng_results
 //-----------------------------------------------------------------------------
 
 static struct trng_results _trng_results;
+static struct hca_trng _trng_pool;
+static uint32_t _trng_words[TRNG_POOL_SIZE];
+static uint8_t _trng_buf[1027u];
 
 //-----------------------------------------------------------------------------
 // TRNG tests
@@ -103,7 +109,11 @@ void hca_irq_handler(int id, void * opaque)
         //PRINTF("RNG: 0x%08x", out);
         results->tr_values[results->tr_count++] = out;
     } else  {
-        results->tr_resume = false;
+        // the data is no longer read, so the IRQ would fire again right away
+        _hca_updreg32(METAL_SIFIVE_HCA_TRNG_CR, 0,
+                      HCA_REGISTER_TRNG_CR_RNDIRQEN_OFFSET,
+                      HCA_REGISTER_TRNG_CR_RNDIRQEN_MASK);
+        results->tr_done = 1u;
     }
 }
 
@@ -130,7 +140,6 @@ TEST(trng, irq)
     metal_interrupt_init(plic);
 
     memset(&_trng_results, 0, sizeof(_trng_results));
-    _trng_results.tr_resume = true;
 
     rc = metal_interrupt_register_handler(plic, HCA_TRNG_IRQ_CHANNEL,
                                           &hca_irq_handler, &_trng_results);
@@ -151,16 +160,16 @@ TEST(trng, irq)
                   HCA_REGISTER_TRNG_CR_RNDIRQEN_OFFSET,
                   HCA_REGISTER_TRNG_CR_RNDIRQEN_MASK);
 
-    while ( _trng_results.tr_resume ) {
-        // do not use WFI as there is a small time vulnerability window
-        // see DMA test for a workaround with the CLINT timer.
-    }
+    _hca_irq_count_wait(&_trng_results.tr_done);
 
     rc = metal_interrupt_disable(plic, HCA_TRNG_IRQ_CHANNEL);
     TEST_ASSERT_FALSE_MESSAGE(rc, "Cannot diable IRQ");
 
-    // clear interrupt
+    // clear interrupt, leave burst mode
     METAL_REG32(HCA_BASE, METAL_SIFIVE_HCA_TRNG_DATA);
+    _hca_updreg32(METAL_SIFIVE_HCA_TRNG_CR, 0,
+                  HCA_REGISTER_TRNG_CR_BURSTEN_OFFSET,
+                  HCA_REGISTER_TRNG_CR_BURSTEN_MASK);
 
     TEST_ASSERT_EQUAL_MESSAGE(_trng_results.tr_count, TRNG_MAX_RESULTS,
                               "Missing RNG values");
@@ -172,11 +181,48 @@ TEST(trng, irq)
     }
 }
 
+TEST(trng, pool)
+{
+    int rc;
+
+    rc = hca_trng_init(&_trng_pool, _trng_words, ARRAY_SIZE(_trng_words),
+                       true);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot init TRNG pool");
+
+    // only one pool
+    static struct hca_trng other;
+    rc = hca_trng_init(&other, _trng_words, ARRAY_SIZE(_trng_words), true);
+    TEST_ASSERT_EQUAL_INT(-EBUSY, rc);
+
+    // larger than the pool: pool then direct polling, w/ a partial word
+    memset(_trng_buf, 0, sizeof(_trng_buf));
+    rc = hca_getrandom(_trng_buf, sizeof(_trng_buf));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot get random bytes");
+    for (unsigned int ix=0; ix<sizeof(_trng_buf); ix+=sizeof(uint32_t)) {
+        uint32_t word = 0;
+        memcpy(&word, &_trng_buf[ix], MIN(sizeof(uint32_t),
+                                          sizeof(_trng_buf)-ix));
+        // same odds as above
+        TEST_ASSERT_TRUE_MESSAGE(word != 0, "Zero value found");
+    }
+
+    // small, unaligned requests
+    for (unsigned int ix=0; ix<16u; ix++) {
+        rc = hca_getrandom(&_trng_buf[1u+ix], 1u+ix);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot get random bytes");
+    }
+
+    rc = hca_trng_fini(&_trng_pool);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, rc, "Cannot release TRNG pool");
+
+    TEST_ASSERT_EQUAL_INT(-ENODEV, hca_getrandom(_trng_buf, 4u));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, hca_trng_init(&_trng_pool, _trng_words,
+                                                 3u, false));
+}
+
 TEST_GROUP_RUNNER(trng)
 {
     RUN_TEST_CASE(trng, poll);
-    #ifdef DEBUG
-    /// TODO: fix me
+    RUN_TEST_CASE(trng, pool);
     RUN_TEST_CASE(trng, irq);
-    #endif
 }